@@ -0,0 +1,185 @@
+#ifndef INSNET_BENCHMARK_H
+#define INSNET_BENCHMARK_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+#include "fmt/core.h"
+#include "insnet/insnet.h"
+#if USE_GPU
+#include <cuda_runtime.h>
+#endif
+
+namespace insnet {
+namespace benchmark {
+
+/// The command line options shared by the benchmarks, given as --name=value.
+struct Options {
+    std::string output;
+    std::string filter;
+    int warmup = 2;
+    int iterations = 10;
+
+    /// Whether to enable the profiler, printing its totals at the end, and the file to export the Chrome trace to, which implies profiling.
+    bool profile = false;
+    std::string trace;
+
+    /// Whether to sample the hardware counters of the executors, printing them to stderr at the end.
+    bool counters = false;
+
+    /// The values of the benchmark-specific options among *extra_names*.
+    std::map<std::string, std::string> extras;
+
+    Options(int argc, char *argv[], const std::string &usage,
+            const std::vector<std::string> &extra_names = {}) {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto value = [&](const std::string &name) {
+                return arg.substr(name.size() + 3);
+            };
+            auto is = [&](const std::string &name) {
+                return arg.compare(0, name.size() + 3, "--" + name + "=") == 0;
+            };
+            if (is("output")) {
+                output = value("output");
+            } else if (is("filter")) {
+                filter = value("filter");
+            } else if (is("warmup")) {
+                warmup = std::stoi(value("warmup"));
+            } else if (is("iterations")) {
+                iterations = std::stoi(value("iterations"));
+            } else if (is("trace")) {
+                trace = value("trace");
+                profile = true;
+            } else if (arg == "--profile") {
+                profile = true;
+            } else if (arg == "--counters") {
+                counters = true;
+            } else {
+                auto it = std::find_if(extra_names.begin(), extra_names.end(), is);
+                if (it == extra_names.end()) {
+                    std::cerr << usage;
+                    exit(1);
+                }
+                extras[*it] = value(*it);
+            }
+        }
+        if (warmup < 0 || iterations < 1) {
+            std::cerr << usage;
+            exit(1);
+        }
+        if (profile && output.empty()) {
+            std::cerr << "--profile and --trace require --output, since the profiler prints to "
+                "stdout\n";
+            exit(1);
+        }
+    }
+
+    int intOption(const std::string &name, int default_value) const {
+        auto it = extras.find(name);
+        return it == extras.end() ? default_value : std::stoi(it->second);
+    }
+
+    bool matches(const std::string &name) const {
+        return name.find(filter) != std::string::npos;
+    }
+};
+
+inline double now() {
+    return std::chrono::duration_cast<std::chrono::duration<double>>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// Wait for the launched kernels on GPU, so that the times include them.
+inline void synchronize() {
+#if USE_GPU
+    cudaDeviceSynchronize();
+#endif
+}
+
+/// Returns the *p*-th percentile of *values* by the nearest rank.
+inline double percentile(std::vector<double> values, double p) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    int rank = std::min<int>(values.size() - 1, std::max<int>(0, p / 100 * values.size()));
+    return values.at(rank);
+}
+
+/// Set the grads of *nodes* to 1, as if they were summed up by the loss.
+inline void seedGrads(std::vector<Node *> &nodes) {
+    initAndZeroGrads(nodes);
+    for (Node *node : nodes) {
+#if USE_GPU
+        cuda::Memset(node->grad().value, node->size(), 1.0f);
+#else
+        node->grad().vec().setConstant(1);
+#endif
+    }
+}
+
+/// Enable the profiler and the hardware counters if required by *options*.
+inline void beginProfiling(const Options &options) {
+    if (options.profile) {
+        Profiler::Ins().SetEnabled(true);
+    }
+    if (options.counters) {
+        PerfCounters::Ins().setEnabled(true);
+    }
+}
+
+/// Print the profiler's totals and the hardware counters, and export the Chrome trace if required by *options*.
+inline void endProfiling(const Options &options) {
+    if (PerfCounters::Ins().isEnabled()) {
+        std::cerr << PerfCounters::Ins().report();
+        PerfCounters::Ins().setEnabled(false);
+    }
+    if (options.profile) {
+        Profiler::Ins().Print();
+        Profiler::Ins().SetEnabled(false);
+    }
+    if (!options.trace.empty()) {
+        Profiler::exportChromeTrace(options.trace);
+    }
+}
+
+inline std::string device() {
+#if USE_GPU
+    return "gpu";
+#else
+    return "cpu";
+#endif
+}
+
+/// Write the JSON document of *results*, each of which is a JSON object, to the output file or stdout.
+inline void writeResults(const Options &options, const std::string &suite,
+        const std::vector<std::string> &results) {
+    std::string json = fmt::format("{{\"suite\":\"{}\",\"device\":\"{}\",\"dtype_size\":{},"
+            "\"warmup\":{},\"iterations\":{},\"results\":[", suite, device(), sizeof(dtype),
+            options.warmup, options.iterations);
+    for (int i = 0; i < results.size(); ++i) {
+        json += (i == 0 ? "\n" : ",\n") + results.at(i);
+    }
+    json += "\n]}\n";
+    if (options.output.empty()) {
+        std::cout << json;
+    } else {
+        std::ofstream out(options.output);
+        out << json;
+        if (!out) {
+            std::cerr << fmt::format("failed to write {}\n", options.output);
+            exit(1);
+        }
+    }
+}
+
+}
+}
+
+#endif
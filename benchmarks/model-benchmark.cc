@@ -0,0 +1,325 @@
+#include <functional>
+#include <memory>
+#include <random>
+#include "benchmark.h"
+
+using std::string;
+using std::vector;
+using std::unique_ptr;
+using std::function;
+using std::cerr;
+
+using namespace insnet;
+using namespace insnet::benchmark;
+
+namespace {
+
+const char *USAGE = "usage: model-benchmark [--output=<json-file>] [--filter=<substring>] "
+    "[--warmup=<count>] [--iterations=<count>] [--profile] [--trace=<json-file>] "
+    "[--counters] [--hidden=<dim>] [--layers=<count>] [--heads=<count>] [--vocab=<size>] "
+    "[--batch=<sentence-count>]\n";
+
+constexpr int MAX_SENTENCE_LEN = 64;
+constexpr dtype DROPOUT = 0.1;
+
+/// The synthetic sentence pair, whose lengths follow those of the open-domain conversation dataset in the Transformer benchmark, i.e., 14.8 +- 4.8 for sources and 11.2 +- 4.3 for targets.
+struct Instance {
+    vector<int> src;
+    vector<int> tgt;
+};
+
+vector<Instance> syntheticBatch(int batch_size, int vocab, std::default_random_engine &engine) {
+    std::normal_distribution<float> src_len(14.8, 4.8), tgt_len(11.2, 4.3);
+    std::uniform_int_distribution<int> word(1, vocab - 1);
+    auto sentence = [&](std::normal_distribution<float> &len) {
+        int n = std::min(MAX_SENTENCE_LEN - 1, std::max(2, static_cast<int>(len(engine))));
+        vector<int> ids;
+        for (int i = 0; i < n; ++i) {
+            ids.push_back(word(engine));
+        }
+        return ids;
+    };
+    vector<Instance> batch;
+    for (int i = 0; i < batch_size; ++i) {
+        batch.push_back({sentence(src_len), sentence(tgt_len)});
+    }
+    return batch;
+}
+
+/// The parameters of all the models, which share the embedding table and the output layer.
+struct ModelParams {
+    Param embedding{string("embedding")};
+    LinearParams output{"output"};
+    LSTMParams lstm{"lstm"};
+    GRUParams gru{"gru"};
+    TransformerEncoderParams encoder{"encoder"};
+    TransformerDecoderParams decoder{"decoder"};
+    int hidden;
+    int vocab;
+
+    void init(int hidden_dim, int layer, int head, int vocab_size) {
+        hidden = hidden_dim;
+        vocab = vocab_size;
+        embedding.init(hidden, vocab);
+        output.init(vocab, hidden);
+        lstm.init(hidden, hidden);
+        gru.init(hidden, hidden);
+        encoder.init(layer, hidden, head, MAX_SENTENCE_LEN);
+        decoder.init(layer, hidden, head, MAX_SENTENCE_LEN);
+    }
+};
+
+/// The language model targets, i.e., the next words with 0 as the end of sentence.
+vector<int> nextWords(const vector<int> &ids) {
+    vector<int> answers(ids.begin() + 1, ids.end());
+    answers.push_back(0);
+    return answers;
+}
+
+/// The tokens that a model built for a batch processes, and its output probabilities.
+struct Built {
+    int64_t tokens = 0;
+    vector<Node *> probs;
+    vector<vector<int>> answers;
+};
+
+Node *outputProbs(Node &hiddens, ModelParams &params) {
+    return softmax(*linear(hiddens, params.output), params.vocab);
+}
+
+/// Build the graph of a model for *batch* without running it, which the caller then runs forward.
+using Builder = function<Built(Graph &graph, const vector<Instance> &batch, ModelParams &params)>;
+
+struct Model {
+    string name;
+    Builder build;
+    function<vector<Tunable<BaseParam> *>(ModelParams &)> blocks;
+    bool trainable;
+};
+
+vector<Model> models() {
+    return {
+        {"lstm", [](Graph &graph, const vector<Instance> &batch, ModelParams &params) {
+            Built built;
+            LSTMState initial_state = {tensor(graph, params.hidden, 0), tensor(graph, params.hidden,
+                    0)};
+            for (const Instance &ins : batch) {
+                vector<Node *> inputs;
+                for (int id : ins.src) {
+                    inputs.push_back(embedding(graph, id, params.embedding));
+                }
+                vector<Node *> hiddens = lstm(initial_state, inputs, params.lstm, DROPOUT);
+                built.probs.push_back(outputProbs(*cat(hiddens), params));
+                built.answers.push_back(nextWords(ins.src));
+                built.tokens += ins.src.size();
+            }
+            return built;
+        }, [](ModelParams &params) {
+            return vector<Tunable<BaseParam> *>({&params.lstm});
+        }, true},
+        {"gru", [](Graph &graph, const vector<Instance> &batch, ModelParams &params) {
+            Built built;
+            Node *initial_state = tensor(graph, params.hidden, 0);
+            for (const Instance &ins : batch) {
+                vector<Node *> inputs;
+                for (int id : ins.src) {
+                    inputs.push_back(embedding(graph, id, params.embedding));
+                }
+                vector<Node *> hiddens = gru(*initial_state, inputs, params.gru, DROPOUT);
+                built.probs.push_back(outputProbs(*cat(hiddens), params));
+                built.answers.push_back(nextWords(ins.src));
+                built.tokens += ins.src.size();
+            }
+            return built;
+        }, [](ModelParams &params) {
+            return vector<Tunable<BaseParam> *>({&params.gru});
+        }, true},
+        {"transformerEncoder", [](Graph &graph, const vector<Instance> &batch,
+                ModelParams &params) {
+            Built built;
+            for (const Instance &ins : batch) {
+                Node *input = embedding(graph, ins.src, params.embedding);
+                Node *hiddens = transformerEncoder(*input, params.encoder, DROPOUT).back();
+                built.probs.push_back(outputProbs(*hiddens, params));
+                built.answers.push_back(nextWords(ins.src));
+                built.tokens += ins.src.size();
+            }
+            return built;
+        }, [](ModelParams &params) {
+            return vector<Tunable<BaseParam> *>({&params.encoder});
+        }, true},
+        {"transformerDecoder", [](Graph &graph, const vector<Instance> &batch,
+                ModelParams &params) {
+            Built built;
+            for (const Instance &ins : batch) {
+                Node *src = embedding(graph, ins.src, params.embedding);
+                Node *encoded = transformerEncoder(*src, params.encoder, DROPOUT).back();
+                TransformerDecoderBuilder decoder(params.decoder, *encoded, DROPOUT);
+                decoder.prepare();
+                vector<int> tgt_inputs = {0};
+                tgt_inputs.insert(tgt_inputs.end(), ins.tgt.begin(), ins.tgt.end() - 1);
+                decoder.connect(*embedding(graph, tgt_inputs, params.embedding));
+                built.probs.push_back(outputProbs(*decoder.hiddenLayers().back(), params));
+                built.answers.push_back(ins.tgt);
+                built.tokens += ins.tgt.size();
+            }
+            return built;
+        }, [](ModelParams &params) {
+            return vector<Tunable<BaseParam> *>({&params.encoder, &params.decoder});
+        }, true},
+        // The decoder cells step in lockstep across the batch, fed with the target words, i.e.,
+        // teacher forcing, and all the steps run in one forward pass. It thus measures the
+        // teacher-forced forward of TransformerDecoderCellBuilder, not the per-token latency of
+        // incremental decoding, since a forward pass releases the vals it has consumed, so the
+        // cached keys and values of the previous steps can not be used by a later forward pass.
+        {"transformerDecoderCellTeacherForced", [](Graph &graph, const vector<Instance> &batch,
+                ModelParams &params) {
+            Built built;
+            vector<unique_ptr<TransformerDecoderCellBuilder>> decoders;
+            int max_len = 0;
+            for (const Instance &ins : batch) {
+                Node *src = embedding(graph, ins.src, params.embedding);
+                Node *encoded = transformerEncoder(*src, params.encoder, 0).back();
+                decoders.emplace_back(new TransformerDecoderCellBuilder(params.decoder, *encoded,
+                            0));
+                decoders.back()->prepare();
+                max_len = std::max<int>(max_len, ins.tgt.size());
+            }
+            for (int t = 0; t < max_len; ++t) {
+                for (int i = 0; i < batch.size(); ++i) {
+                    const vector<int> &tgt = batch.at(i).tgt;
+                    if (t < tgt.size()) {
+                        TransformerDecoderCellBuilder &decoder = *decoders.at(i);
+                        decoder.step(*embedding(graph, t == 0 ? 0 : tgt.at(t - 1),
+                                    params.embedding));
+                    }
+                }
+            }
+            for (int i = 0; i < batch.size(); ++i) {
+                built.probs.push_back(outputProbs(*cat(decoders.at(i)->hiddenLayers().back()),
+                            params));
+                built.answers.push_back(batch.at(i).tgt);
+                built.tokens += batch.at(i).tgt.size();
+            }
+            return built;
+        }, [](ModelParams &params) {
+            return vector<Tunable<BaseParam> *>({&params.encoder, &params.decoder});
+        }, false},
+    };
+}
+
+/// Run the training or inference benchmark of *model*, returning the JSON object of the results.
+///
+/// An iteration builds and runs the graph of a synthetic batch, plus the loss, backward and the optimizer step in training, which is timed excluding the batch generation and the graph destruction. The peak memory is that of the tensors allocated in a separate untimed iteration before the warm-up ones, so that tracking affects none of the timed iterations even without warm-up.
+string run(const Options &options, const Model &model, bool training, ModelParams &params,
+        int batch_size) {
+    vector<BaseParam *> tunable_params = params.embedding.tunableParams();
+    for (Tunable<BaseParam> *block : model.blocks(params)) {
+        auto block_params = block->tunableParams();
+        tunable_params.insert(tunable_params.end(), block_params.begin(), block_params.end());
+    }
+    auto output_params = params.output.tunableParams();
+    tunable_params.insert(tunable_params.end(), output_params.begin(), output_params.end());
+    int64_t param_bytes = 0;
+    for (BaseParam *param : tunable_params) {
+        param_bytes += sizeof(dtype) * param->val().size;
+    }
+    AdamOptimizer optimizer(tunable_params, 1e-4);
+
+    std::default_random_engine engine(0);
+    MemoryTracker &tracker = MemoryTracker::Ins();
+    vector<double> latencies;
+    int64_t tokens = 0;
+    int64_t executor_count = 0;
+    int64_t iteration_tokens;
+    int iteration_executor_count;
+    // Returns the latency of an iteration on a new batch, generated before the clock starts,
+    // which stops before the graph is destroyed.
+    auto iterate = [&]() {
+        vector<Instance> batch = syntheticBatch(batch_size, params.vocab, engine);
+        double begin = now();
+        Graph graph(training ? ModelStage::TRAINING : ModelStage::INFERENCE);
+        Built built = model.build(graph, batch, params);
+        graph.forward();
+        if (training) {
+            NLLLoss(built.probs, params.vocab, built.answers,
+                    averageLossFactor(answerCount(built.answers)));
+            graph.backward();
+            optimizer.step();
+        } else {
+            argmax(built.probs, params.vocab);
+        }
+        synchronize();
+        double latency = now() - begin;
+        iteration_tokens = built.tokens;
+        iteration_executor_count = graph.getExecutorCount();
+        return latency;
+    };
+
+    tracker.setEnabled(true);
+    tracker.beginStep();
+    iterate();
+#if USE_GPU
+    int64_t peak_bytes = tracker.total(true).peak_bytes;
+#else
+    int64_t peak_bytes = tracker.total().peak_bytes;
+#endif
+    tracker.setEnabled(false);
+
+    for (int i = 0; i < options.warmup + options.iterations; ++i) {
+        double latency = iterate();
+        if (i >= options.warmup) {
+            latencies.push_back(latency);
+            tokens += iteration_tokens;
+            executor_count += iteration_executor_count;
+        }
+    }
+
+    double total_time = 0;
+    for (double latency : latencies) {
+        total_time += latency;
+    }
+    string mode = training ? "training" : "inference";
+    cerr << fmt::format("{} {} tokens/s:{:.1f} p50:{:.3f}ms peak:{:.1f}MB\n", model.name, mode,
+            tokens / total_time, percentile(latencies, 50) * 1e3, peak_bytes / 1048576.0);
+    return fmt::format("{{\"model\":\"{}\",\"mode\":\"{}\",\"batch_size\":{},\"hidden\":{},"
+            "\"layers\":{},\"vocab\":{},\"tokens_per_second\":{:.1f},\"latency_p50_ms\":{:.6f},"
+            "\"latency_p90_ms\":{:.6f},\"latency_p99_ms\":{:.6f},\"peak_memory_bytes\":{},"
+            "\"param_bytes\":{},\"executors_per_iteration\":{:.1f}}}", model.name, mode,
+            batch_size, params.hidden, params.encoder.layerCount(), params.vocab,
+            tokens / total_time, percentile(latencies, 50) * 1e3,
+            percentile(latencies, 90) * 1e3, percentile(latencies, 99) * 1e3, peak_bytes,
+            param_bytes, static_cast<double>(executor_count) / latencies.size());
+}
+
+}
+
+/// Measure the end-to-end training and inference throughput of the models in block/ on synthetic sentences, writing the results as JSON.
+int main(int argc, char *argv[]) {
+    Options options(argc, argv, USAGE, {"hidden", "layers", "heads", "vocab", "batch"});
+#if USE_GPU
+    cuda::initCuda(0);
+#endif
+    srand(0);
+    ModelParams params;
+    params.init(options.intOption("hidden", 256), options.intOption("layers", 2),
+            options.intOption("heads", 4), options.intOption("vocab", 4000));
+    int batch_size = options.intOption("batch", 32);
+    beginProfiling(options);
+
+    vector<string> results;
+    for (const Model &model : models()) {
+        for (bool training : {true, false}) {
+            if (training && !model.trainable) {
+                continue;
+            }
+            string name = fmt::format("{}/{}", model.name, training ? "training" : "inference");
+            if (options.matches(name)) {
+                results.push_back(run(options, model, training, params, batch_size));
+            }
+        }
+    }
+    endProfiling(options);
+    writeResults(options, "model", results);
+    return 0;
+}
@@ -0,0 +1,245 @@
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include "benchmark.h"
+
+using std::string;
+using std::vector;
+using std::map;
+using std::unique_ptr;
+using std::function;
+using std::cout;
+using std::cerr;
+
+using namespace insnet;
+using namespace insnet::benchmark;
+
+namespace {
+
+const char *USAGE = "usage: operator-benchmark [--output=<json-file>] [--filter=<substring>] "
+    "[--warmup=<count>] [--iterations=<count>] [--profile] [--trace=<json-file>] "
+    "[--counters]\n";
+
+constexpr int VOCABULARY_SIZE = 10000;
+constexpr int MEAN_COL = 16;
+
+std::default_random_engine &engine() {
+    static std::default_random_engine e(0);
+    return e;
+}
+
+Node *input(Graph &graph, int size) {
+    static vector<dtype> values;
+    if (values.size() < size) {
+        std::uniform_real_distribution<dtype> dist(-1, 1);
+        values.resize(size);
+        for (dtype &v : values) {
+            v = dist(engine());
+        }
+    }
+    return tensor(graph, vector<dtype>(values.begin(), values.begin() + size));
+}
+
+template <typename T>
+T &paramsOfDim(int dim, const function<void(T &)> &init) {
+    static map<int, unique_ptr<T>> params;
+    auto it = params.find(dim);
+    if (it == params.end()) {
+        it = params.insert(std::make_pair(dim, unique_ptr<T>(new T(fmt::format("p{}", dim)))))
+            .first;
+        init(*it->second);
+    }
+    return *it->second;
+}
+
+LinearParams &linearParams(int dim) {
+    return paramsOfDim<LinearParams>(dim, [dim](LinearParams &p) {
+        p.init(dim, dim);
+    });
+}
+
+LayerNormParams &layerNormParams(int dim) {
+    return paramsOfDim<LayerNormParams>(dim, [dim](LayerNormParams &p) {
+        p.init(dim);
+    });
+}
+
+Param &table(int dim) {
+    return paramsOfDim<Param>(dim, [dim](Param &p) {
+        p.init(dim, VOCABULARY_SIZE);
+    });
+}
+
+/// Build an operator instance whose input has *dim* rows and *col* columns, returning its output.
+using Builder = function<Node *(Graph &graph, int dim, int col)>;
+
+vector<std::pair<string, Builder>> operators() {
+    return {
+        {"linear", [](Graph &graph, int dim, int col) {
+            return linear(*input(graph, dim * col), linearParams(dim));
+        }},
+        {"matmul", [](Graph &graph, int dim, int col) {
+            return matmul(*input(graph, dim * col), *input(graph, dim * col), dim, true);
+        }},
+        {"softmax", [](Graph &graph, int dim, int col) {
+            return softmax(*input(graph, dim * col), dim);
+        }},
+        {"layerNorm", [](Graph &graph, int dim, int col) {
+            return layerNorm(*input(graph, dim * col), layerNormParams(dim));
+        }},
+        {"concat", [](Graph &graph, int dim, int col) {
+            return cat({input(graph, dim * col), input(graph, dim * col)}, col);
+        }},
+        {"split", [](Graph &graph, int dim, int col) {
+            return split(*input(graph, dim * col), dim / 2, dim / 4, col);
+        }},
+        {"maxPool", [](Graph &graph, int dim, int col) {
+            return maxPool(*input(graph, dim * col), dim);
+        }},
+        {"avgPool", [](Graph &graph, int dim, int col) {
+            return avgPool(*input(graph, dim * col), dim);
+        }},
+        {"lookup", [](Graph &graph, int dim, int col) {
+            std::uniform_int_distribution<int> dist(0, VOCABULARY_SIZE - 1);
+            vector<int> ids;
+            for (int i = 0; i < col; ++i) {
+                ids.push_back(dist(engine()));
+            }
+            return embedding(graph, ids, table(dim));
+        }},
+        {"dropout", [](Graph &graph, int dim, int col) {
+            return dropout(*input(graph, dim * col), 0.1);
+        }},
+        {"add", [](Graph &graph, int dim, int col) {
+            return add({input(graph, dim * col), input(graph, dim * col)});
+        }},
+        {"tanh", [](Graph &graph, int dim, int col) {
+            return tanh(*input(graph, dim * col));
+        }},
+        {"sigmoid", [](Graph &graph, int dim, int col) {
+            return sigmoid(*input(graph, dim * col));
+        }},
+        {"relu", [](Graph &graph, int dim, int col) {
+            return relu(*input(graph, dim * col));
+        }},
+        {"exp", [](Graph &graph, int dim, int col) {
+            return exp(*input(graph, dim * col));
+        }},
+    };
+}
+
+/// Returns the column numbers of *count* instances, all being MEAN_COL or uniformly distributed in [1, 2 * MEAN_COL - 1] if ragged.
+vector<int> columns(int count, bool ragged) {
+    if (!ragged) {
+        return vector<int>(count, MEAN_COL);
+    }
+    std::uniform_int_distribution<int> dist(1, 2 * MEAN_COL - 1);
+    vector<int> cols;
+    for (int i = 0; i < count; ++i) {
+        cols.push_back(dist(engine()));
+    }
+    return cols;
+}
+
+/// Run the benchmark of an operator configuration, returning the JSON object of the results.
+///
+/// The batching overhead is the time of Graph::forward not spent in the executors, i.e., the dynamic batching itself, and the achieved GFLOP/s and GB/s are those of the executors' forward passes. On GPU, the executors' times only include launching kernels unless profiling is enabled.
+string run(const Options &options, const string &name, const Builder &builder, int count,
+        int dim, bool ragged) {
+    vector<int> cols = columns(count, ragged);
+    int64_t elements = 0;
+    for (int col : cols) {
+        elements += static_cast<int64_t>(dim) * col;
+    }
+
+    vector<double> build_times, forward_times, backward_times, overheads, executor_times;
+    int executor_count = 0;
+    int64_t flops = 0, bytes = 0;
+    for (int i = 0; i < options.warmup + options.iterations; ++i) {
+        Graph graph;
+        graph.setCalculateBatchingStats(true);
+        double begin = now();
+        vector<Node *> outputs;
+        outputs.reserve(count);
+        for (int col : cols) {
+            outputs.push_back(builder(graph, dim, col));
+        }
+        double built = now();
+        graph.forward();
+        synchronize();
+        double forwarded = now();
+        seedGrads(outputs);
+        synchronize();
+        double seeded = now();
+        graph.backward();
+        synchronize();
+        double backwarded = now();
+
+        if (i < options.warmup) {
+            continue;
+        }
+        int64_t executor_time = 0;
+        flops = 0;
+        bytes = 0;
+        for (const auto &it : graph.getBatchingStats()) {
+            executor_time += it.second.forward_time_in_nanoseconds;
+            flops += it.second.flops;
+            bytes += it.second.bytes;
+        }
+        build_times.push_back(built - begin);
+        forward_times.push_back(forwarded - built);
+        backward_times.push_back(backwarded - seeded);
+        overheads.push_back(forwarded - built - executor_time * 1e-9);
+        executor_times.push_back(executor_time * 1e-9);
+        executor_count = graph.getExecutorCount();
+    }
+
+    double forward = percentile(forward_times, 50);
+    double backward = percentile(backward_times, 50);
+    double executor_time = percentile(executor_times, 50);
+    cerr << fmt::format("{} count:{} dim:{} cols:{} forward:{:.3f}ms backward:{:.3f}ms\n", name,
+            count, dim, ragged ? "ragged" : "fixed", forward * 1e3, backward * 1e3);
+    return fmt::format("{{\"operator\":\"{}\",\"count\":{},\"dim\":{},\"cols\":\"{}\","
+            "\"elements\":{},\"executors\":{},\"build_ms\":{:.6f},\"forward_ms\":{:.6f},"
+            "\"forward_p90_ms\":{:.6f},\"backward_ms\":{:.6f},\"backward_p90_ms\":{:.6f},"
+            "\"batching_overhead_ms\":{:.6f},\"forward_elements_per_second\":{:.1f},"
+            "\"backward_elements_per_second\":{:.1f},\"forward_flops\":{},\"forward_bytes\":{},"
+            "\"forward_gflops_per_second\":{:.3f},\"forward_gb_per_second\":{:.3f}}}", name,
+            count, dim, ragged ? "ragged" : "fixed", elements, executor_count,
+            percentile(build_times, 50) * 1e3, forward * 1e3,
+            percentile(forward_times, 90) * 1e3, backward * 1e3,
+            percentile(backward_times, 90) * 1e3, percentile(overheads, 50) * 1e3,
+            elements / forward, elements / backward, flops, bytes,
+            flops / executor_time * 1e-9, bytes / executor_time * 1e-9);
+}
+
+}
+
+/// Measure the forward and backward times of each operator across the batch counts, the dimensions and the fixed or ragged column distributions, writing the medians as JSON.
+int main(int argc, char *argv[]) {
+    Options options(argc, argv, USAGE);
+#if USE_GPU
+    cuda::initCuda(0);
+#endif
+    beginProfiling(options);
+
+    vector<string> results;
+    for (const auto &op : operators()) {
+        for (int count : {1, 32, 256}) {
+            for (int dim : {64, 512}) {
+                for (bool ragged : {false, true}) {
+                    string name = fmt::format("{}/count={}/dim={}/{}", op.first, count, dim,
+                            ragged ? "ragged" : "fixed");
+                    if (options.matches(name)) {
+                        results.push_back(run(options, op.first, op.second, count, dim,
+                                    ragged));
+                    }
+                }
+            }
+        }
+    }
+    endProfiling(options);
+    writeResults(options, "operator", results);
+    return 0;
+}
@@ -0,0 +1,47 @@
+#ifndef INSNET_BFLOAT16_H
+#define INSNET_BFLOAT16_H
+
+#include <cstdint>
+#include <cstring>
+#include "insnet/base/def.h"
+
+namespace insnet {
+
+/// \brief The bfloat16 number, i.e., the upper half of a float, which keeps the exponent range of float with 8 bits of precision.
+struct bfloat16 {
+    uint16_t bits;
+};
+
+/// Convert *f* to bfloat16, rounding to the nearest even.
+inline bfloat16 toBFloat16(float f) {
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    if ((bits & 0x7fffffff) > 0x7f800000) {
+        return {static_cast<uint16_t>((bits >> 16) | 0x40)};
+    }
+    bits += 0x7fff + ((bits >> 16) & 1);
+    return {static_cast<uint16_t>(bits >> 16)};
+}
+
+inline float toFloat(bfloat16 h) {
+    uint32_t bits = static_cast<uint32_t>(h.bits) << 16;
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+inline void toBFloat16(const dtype *src, int64_t size, bfloat16 *dst) {
+    for (int64_t i = 0; i < size; ++i) {
+        dst[i] = toBFloat16(static_cast<float>(src[i]));
+    }
+}
+
+inline void toFloat(const bfloat16 *src, int64_t size, dtype *dst) {
+    for (int64_t i = 0; i < size; ++i) {
+        dst[i] = toFloat(src[i]);
+    }
+}
+
+}
+
+#endif
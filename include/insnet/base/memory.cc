@@ -1,5 +1,6 @@
 #include "insnet/base/memory.h"
 #include "insnet/cuda/memory_pool.h"
+#include <algorithm>
 #include <cstdlib>
 #include <iostream>
 #include "fmt/core.h"
@@ -9,6 +10,10 @@ using std::cerr;
 using std::endl;
 using std::shared_ptr;
 using std::make_shared;
+using std::string;
+using std::map;
+using std::lock_guard;
+using std::mutex;
 
 namespace insnet {
 
@@ -42,12 +47,14 @@ public:
     CPUMemoryContainer() = default;
 
     ~CPUMemoryContainer() override {
+        MemoryTracker::Ins().recordFree(addr_);
         free(addr_);
     }
 
 protected:
     void initMemory() override {
         addr_ = malloc(size_in_bytes_);
+        MemoryTracker::Ins().recordAllocation(addr_, size_in_bytes_);
     }
 };
 
@@ -69,6 +76,171 @@ protected:
 };
 #endif
 
+namespace {
+
+thread_local MemoryCategory current_category = MemoryCategory::OTHER_MEMORY;
+thread_local const string *current_op_type = nullptr;
+
+void addBytes(MemoryStats &stats, int64_t size) {
+    stats.live_bytes += size;
+    stats.peak_bytes = std::max(stats.peak_bytes, stats.live_bytes);
+    ++stats.allocation_count;
+    stats.allocated_bytes += size;
+}
+
+}
+
+string memoryCategoryName(MemoryCategory category) {
+    switch (category) {
+        case MemoryCategory::OTHER_MEMORY:
+            return "other";
+        case MemoryCategory::ACTIVATION_MEMORY:
+            return "activation";
+        case MemoryCategory::GRADIENT_MEMORY:
+            return "gradient";
+        case MemoryCategory::PARAMETER_MEMORY:
+            return "parameter";
+        case MemoryCategory::OPTIMIZER_STATE_MEMORY:
+            return "optimizer_state";
+        default:
+            cerr << fmt::format("memoryCategoryName - unknown category:{}\n", category);
+            abort();
+    }
+}
+
+MemoryTracker &MemoryTracker::Ins() {
+    static MemoryTracker *tracker = new MemoryTracker;
+    return *tracker;
+}
+
+void MemoryTracker::track(const void *p, int64_t size_in_bytes, bool on_device) {
+    lock_guard<mutex> guard(mutex_);
+    int op_type = -1;
+    if (current_op_type != nullptr) {
+        auto it = op_type_ids_.find(*current_op_type);
+        if (it == op_type_ids_.end()) {
+            it = op_type_ids_.insert(std::make_pair(*current_op_type, op_types_.size())).first;
+            op_types_.push_back(*current_op_type);
+        }
+        op_type = it->second;
+    }
+    if (!allocations_.insert(std::make_pair(p, Allocation{size_in_bytes, current_category,
+                    op_type, on_device})).second) {
+        cerr << "MemoryTracker - the memory is allocated twice" << endl;
+        abort();
+    }
+    ++tracked_count_;
+
+    DeviceStats &stats = on_device ? device_stats_ : host_stats_;
+    addBytes(stats.total, size_in_bytes);
+    addBytes(stats.categories[current_category], size_in_bytes);
+    if (op_type >= 0) {
+        if (op_type >= stats.op_types.size()) {
+            stats.op_types.resize(op_type + 1);
+        }
+        addBytes(stats.op_types.at(op_type), size_in_bytes);
+    }
+}
+
+void MemoryTracker::untrack(const void *p) {
+    lock_guard<mutex> guard(mutex_);
+    auto it = allocations_.find(p);
+    if (it == allocations_.end()) {
+        return;
+    }
+    const Allocation &allocation = it->second;
+    DeviceStats &stats = allocation.on_device ? device_stats_ : host_stats_;
+    stats.total.live_bytes -= allocation.size;
+    stats.categories[allocation.category].live_bytes -= allocation.size;
+    if (allocation.op_type >= 0) {
+        stats.op_types.at(allocation.op_type).live_bytes -= allocation.size;
+    }
+    allocations_.erase(it);
+    --tracked_count_;
+}
+
+void MemoryTracker::beginStep() {
+    lock_guard<mutex> guard(mutex_);
+    ++step_;
+    for (DeviceStats *stats : {&host_stats_, &device_stats_}) {
+        auto reset = [](MemoryStats &s) {
+            s.peak_bytes = s.live_bytes;
+            s.allocation_count = 0;
+            s.allocated_bytes = 0;
+        };
+        reset(stats->total);
+        for (MemoryStats &s : stats->categories) {
+            reset(s);
+        }
+        for (MemoryStats &s : stats->op_types) {
+            reset(s);
+        }
+    }
+}
+
+MemoryStats MemoryTracker::total(bool on_device) const {
+    lock_guard<mutex> guard(mutex_);
+    return (on_device ? device_stats_ : host_stats_).total;
+}
+
+MemoryStats MemoryTracker::categoryStats(MemoryCategory category, bool on_device) const {
+    lock_guard<mutex> guard(mutex_);
+    return (on_device ? device_stats_ : host_stats_).categories[category];
+}
+
+map<string, MemoryStats> MemoryTracker::operatorStats(bool on_device) const {
+    lock_guard<mutex> guard(mutex_);
+    const DeviceStats &stats = on_device ? device_stats_ : host_stats_;
+    map<string, MemoryStats> result;
+    for (int i = 0; i < stats.op_types.size(); ++i) {
+        result.insert(std::make_pair(op_types_.at(i), stats.op_types.at(i)));
+    }
+    return result;
+}
+
+string MemoryTracker::deviceReport(bool on_device) const {
+    auto format = [](const string &name, const MemoryStats &stats) {
+        return fmt::format("{} live:{:.3f}MB peak:{:.3f}MB allocations:{} allocated:{:.3f}MB\n",
+                name,
+                stats.live_bytes / 1048576.0, stats.peak_bytes / 1048576.0,
+                stats.allocation_count, stats.allocated_bytes / 1048576.0);
+    };
+    MemoryStats all = total(on_device);
+    string report = format(on_device ? "device" : "host", all);
+    for (int i = 0; i < MEMORY_CATEGORY_COUNT; ++i) {
+        MemoryCategory category = static_cast<MemoryCategory>(i);
+        MemoryStats stats = categoryStats(category, on_device);
+        if (stats.peak_bytes > 0) {
+            report += "  category:" + format(memoryCategoryName(category), stats);
+        }
+    }
+    for (const auto &it : operatorStats(on_device)) {
+        if (it.second.peak_bytes > 0) {
+            report += "  op:" + format(it.first, it.second);
+        }
+    }
+    return report;
+}
+
+string MemoryTracker::report() const {
+    string report = fmt::format("step:{}\n", step_) + deviceReport(false);
+#if USE_GPU
+    report += deviceReport(true);
+#endif
+    return report;
+}
+
+MemoryScope::MemoryScope(MemoryCategory category, const string *op_type) :
+    last_category_(current_category), last_op_type_(current_op_type) {
+    current_category = category;
+    current_op_type = op_type;
+}
+
+MemoryScope::~MemoryScope() {
+    current_category = last_category_;
+    current_op_type = last_op_type_;
+}
+
 shared_ptr<MemoryContainer> memoryContainer(int size_in_bytes) {
     shared_ptr<MemoryContainer> ret;
 #if USE_GPU
@@ -1,10 +1,143 @@
 #ifndef INSNET_MEMORY_H
 #define INSNET_MEMORY_H
 
+#include <atomic>
+#include <cstdint>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace insnet {
 
+enum MemoryCategory {
+    OTHER_MEMORY = 0,
+    ACTIVATION_MEMORY = 1,
+    GRADIENT_MEMORY = 2,
+    PARAMETER_MEMORY = 3,
+    OPTIMIZER_STATE_MEMORY = 4,
+    MEMORY_CATEGORY_COUNT = 5
+};
+
+std::string memoryCategoryName(MemoryCategory category);
+
+struct MemoryStats {
+    int64_t live_bytes = 0;
+
+    /// The peak of the live bytes since the step began.
+    int64_t peak_bytes = 0;
+
+    /// The number and the bytes of the allocations since the step began.
+    int64_t allocation_count = 0;
+    int64_t allocated_bytes = 0;
+};
+
+/// \brief The allocation tracker of the tensors' host and device memory.
+///
+/// When enabled, it records the allocations of the memory containers, the tensors and the GPU memory pool, attributing them to the category and the operator type of the innermost MemoryScope of the allocating thread, e.g., the executors attribute the vals they allocate in forward to ACTIVATION_MEMORY and their node types. The allocations before enabling are not counted, while the frees of those recorded are counted even if disabled afterwards. When disabled, the tracker costs an atomic load per allocation and free.
+///
+/// For example:
+/// \code{.cpp}
+/// MemoryTracker &tracker = MemoryTracker::Ins();
+/// tracker.setEnabled(true);
+/// for (auto &batch : batches) {
+///     tracker.beginStep();
+///     // forward, backward and step ...
+///     std::cout << tracker.report();
+/// }
+/// \endcode
+class MemoryTracker {
+public:
+    static MemoryTracker &Ins();
+
+    MemoryTracker(const MemoryTracker &) = delete;
+
+    void setEnabled(bool enabled) {
+        enabled_ = enabled;
+    }
+
+    bool isEnabled() const {
+        return enabled_;
+    }
+
+    /// Begin a new step, resetting the allocation counts and bytes, and the peaks to the live bytes.
+    void beginStep();
+
+    int64_t step() const {
+        return step_;
+    }
+
+    void recordAllocation(const void *p, int64_t size_in_bytes, bool on_device = false) {
+        if (enabled_ && p != nullptr) {
+            track(p, size_in_bytes, on_device);
+        }
+    }
+
+    void recordFree(const void *p) {
+        if (tracked_count_ > 0 && p != nullptr) {
+            untrack(p);
+        }
+    }
+
+    /// Returns the stats of all the host (device) memory tracked.
+    MemoryStats total(bool on_device = false) const;
+
+    MemoryStats categoryStats(MemoryCategory category, bool on_device = false) const;
+
+    /// Returns the stats keyed by the operator types, where the allocations outside the executors are keyed by the empty string.
+    std::map<std::string, MemoryStats> operatorStats(bool on_device = false) const;
+
+    /// Returns the printable report of the stats of the current step.
+    std::string report() const;
+
+private:
+    MemoryTracker() = default;
+
+    struct Allocation {
+        int64_t size;
+        MemoryCategory category;
+        int op_type;
+        bool on_device;
+    };
+
+    struct DeviceStats {
+        MemoryStats total;
+        MemoryStats categories[MEMORY_CATEGORY_COUNT];
+        std::vector<MemoryStats> op_types;
+    };
+
+    void track(const void *p, int64_t size_in_bytes, bool on_device);
+
+    void untrack(const void *p);
+
+    std::string deviceReport(bool on_device) const;
+
+    mutable std::mutex mutex_;
+    std::atomic<bool> enabled_ = {false};
+    std::atomic<int64_t> tracked_count_ = {0};
+    int64_t step_ = 0;
+    std::unordered_map<const void *, Allocation> allocations_;
+    std::unordered_map<std::string, int> op_type_ids_;
+    std::vector<std::string> op_types_;
+    DeviceStats host_stats_, device_stats_;
+};
+
+/// \brief The scope attributing the tracked allocations of the current thread in its lifetime to *category* and *op_type*, which should outlive the scope. Scopes can be nested.
+class MemoryScope {
+public:
+    MemoryScope(MemoryCategory category, const std::string *op_type = nullptr);
+
+    MemoryScope(const MemoryScope &) = delete;
+
+    ~MemoryScope();
+
+private:
+    MemoryCategory last_category_;
+    const std::string *last_op_type_;
+};
+
 class MemoryContainer {
 public:
     MemoryContainer() = default;
@@ -19,6 +19,7 @@ using std::cerr;
 using std::endl;
 using std::default_random_engine;
 using std::normal_distribution;
+using std::shared_ptr;
 
 namespace insnet {
 
@@ -33,6 +34,7 @@ void cpu::Tensor1D::init(int ndim) {
     }
     dim = ndim;
     v = new dtype[dim];
+    MemoryTracker::Ins().recordAllocation(v, sizeof(dtype) * dim);
 }
 
 void cpu::Tensor1D::init(int dimm, const std::shared_ptr<MemoryContainer> &container) {
@@ -41,6 +43,83 @@ void cpu::Tensor1D::init(int dimm, const std::shared_ptr<MemoryContainer> &conta
     memory_container_ = container;
 }
 
+void cpu::Tensor1D::initAsView(const Tensor1D &src, int offset, int dimm) {
+    if (v != nullptr) {
+        cerr << "Tensor1D::initAsView v is not null\n";
+        abort();
+    }
+    if (src.memory_container_ == nullptr || offset + dimm > src.dim) {
+        cerr << fmt::format("Tensor1D::initAsView - src dim:{} offset:{} dim:{}\n", src.dim,
+                offset, dimm);
+        abort();
+    }
+    dim = dimm;
+    v = src.v + offset;
+    memory_container_ = src.memory_container_;
+}
+
+void cpu::Tensor1D::initAsStridedView(const Tensor1D &src, int offset, int row, int col,
+        int stridee) {
+    if (v != nullptr) {
+        cerr << "Tensor1D::initAsStridedView v is not null\n";
+        abort();
+    }
+    if (src.memory_container_ == nullptr || row > stridee ||
+            offset + (col - 1) * stridee + row > src.dim) {
+        cerr << fmt::format("Tensor1D::initAsStridedView - src dim:{} offset:{} row:{} col:{} stride:{}\n",
+                src.dim, offset, row, col, stridee);
+        abort();
+    }
+    dim = row * col;
+    stride = stridee;
+    v = src.v + offset;
+    memory_container_ = src.memory_container_;
+}
+
+void cpu::Tensor1D::planAsView(Tensor1D &src, int src_dim, int offset, int row, int stridee) {
+    if (isPlannedAsView()) {
+        cerr << "Tensor1D::planAsView already planned\n";
+        abort();
+    }
+    view_src_ = &src;
+    view_src_dim_ = src_dim;
+    view_offset_ = offset;
+    view_row_ = row;
+    view_stride_ = stridee;
+}
+
+cpu::Tensor1D &cpu::Tensor1D::plannedViewRoot(int &root_dim) {
+    Tensor1D *root = this;
+    while (root->isPlannedAsView()) {
+        root_dim = root->view_src_dim_;
+        root = root->view_src_;
+    }
+    return *root;
+}
+
+void cpu::Tensor1D::initAsPlannedView(int dimm) {
+    if (!view_src_->isInitialized()) {
+        if (!view_src_->isPlannedAsView()) {
+            cerr << "Tensor1D::initAsPlannedView the root tensor is not initialized\n";
+            abort();
+        }
+        view_src_->initAsPlannedView(view_src_dim_);
+    }
+    if (view_stride_ == 0) {
+        initAsView(*view_src_, view_offset_, dimm);
+    } else {
+        initAsStridedView(*view_src_, view_offset_, view_row_, dimm / view_row_, view_stride_);
+    }
+}
+
+void cpu::Tensor1D::clearViewPlan() {
+    view_src_ = nullptr;
+    view_src_dim_ = 0;
+    view_offset_ = 0;
+    view_row_ = 0;
+    view_stride_ = 0;
+}
+
 void cpu::Tensor1D::retain() {
     if (ref_count_ < 0) {
         cerr << fmt::format("Tensor1D::retain ref_count_:{}\n", ref_count_);
@@ -65,12 +144,14 @@ void cpu::Tensor1D::release() {
 void cpu::Tensor1D::releaseMemory() {
     if (v != nullptr) {
         if (memory_container_ == nullptr) {
+            MemoryTracker::Ins().recordFree(v);
             delete[] v;
         } else {
             memory_container_ = nullptr;
         }
         v = nullptr;
     }
+    stride = 0;
     ref_count_ = 0;
 }
 
@@ -116,6 +197,10 @@ Vec cpu::Tensor1D::vec() {
     return Vec(v, dim);
 }
 
+StridedMat cpu::Tensor1D::stridedMat(int row) {
+    return StridedMat(v, row, dim / row, Eigen::OuterStride<>(stride == 0 ? row : stride));
+}
+
 dtype& cpu::Tensor1D::operator[](const int i) {
     if (i >= dim) {
         cerr << fmt::format("i >= dim i:{} dim:{}\n", i, dim);
@@ -180,11 +265,16 @@ cpu::Tensor2D::Tensor2D() {
 }
 
 cpu::Tensor2D::~Tensor2D() {
-    if (v) {
+    release();
+}
+
+void cpu::Tensor2D::release() {
+    if (v && view_owner_ == nullptr) {
+        MemoryTracker::Ins().recordFree(v);
         delete[] v;
-        v = nullptr;
     }
     v = nullptr;
+    view_owner_ = nullptr;
     col = row = 0;
     size = 0;
 }
@@ -198,9 +288,35 @@ void cpu::Tensor2D::init(int nrow, int ncol) {
         abort();
     }
     v = new dtype[size];
+    MemoryTracker::Ins().recordAllocation(v, sizeof(dtype) * size);
     zero();
 }
 
+void cpu::Tensor2D::initAsView(const shared_ptr<Tensor2D> &src, int offset, int nrow, int ncol) {
+    if (src == nullptr || offset + nrow * ncol > src->size) {
+        cerr << fmt::format("cpu::Tensor2D::initAsView - src size:{} offset:{} row:{} col:{}\n",
+                src == nullptr ? 0 : src->size, offset, nrow, ncol);
+        abort();
+    }
+    initAsView(src->v == nullptr ? nullptr : src->v + offset, nrow, ncol, src);
+}
+
+void cpu::Tensor2D::initAsView(dtype *v, int nrow, int ncol, const shared_ptr<void> &owner) {
+    if (owner == nullptr) {
+        cerr << "cpu::Tensor2D::initAsView - owner is null" << endl;
+        abort();
+    }
+    if (this->v != nullptr && view_owner_ == nullptr) {
+        MemoryTracker::Ins().recordFree(this->v);
+        delete[] this->v;
+    }
+    this->v = v;
+    row = nrow;
+    col = ncol;
+    size = nrow * ncol;
+    view_owner_ = owner;
+}
+
 void cpu::Tensor2D::zero() {
     assert(v != nullptr);
     for (int i = 0; i < size; ++i) {
@@ -313,8 +429,10 @@ void initAndZeroTensors(vector<cpu::Tensor1D *> &tensors, const vector<int> &dim
         abort();
     }
 
+    static const int memory_management = Profiler::eventId("memory_management");
+    static const int clear_grad = Profiler::eventId("clear_grad");
     Profiler &profiler = Profiler::Ins();
-    profiler.BeginEvent("memory_management");
+    profiler.BeginEvent(memory_management);
 
     map<string, map<cpu::Tensor1D *, int>> tensor_map;
     for (int i = 0; i < tensors.size(); ++i) {
@@ -355,7 +473,7 @@ void initAndZeroTensors(vector<cpu::Tensor1D *> &tensors, const vector<int> &dim
     }
     profiler.EndEvent();
 
-    profiler.BeginEvent("clear_grad");
+    profiler.BeginEvent(clear_grad);
 
 #if USE_GPU
     vector<dtype *> grads;
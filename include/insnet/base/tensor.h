@@ -17,6 +17,8 @@ namespace cpu {
 struct Tensor1D {
     dtype *v = nullptr;
     int dim = 0;
+    /// The distance between the beginnings of two adjacent columns if this tensor is a strided view, or 0 if it is contiguous.
+    int stride = 0;
     int ref_count_ = 1;
     std::shared_ptr<MemoryContainer> memory_container_ = nullptr;
 
@@ -28,6 +30,42 @@ struct Tensor1D {
 
     virtual void init(int dim, const std::shared_ptr<MemoryContainer> &container);
 
+    /// Make this tensor a view of *dim* elements of *src* beginning at *offset* without copying.
+    ///
+    /// The view shares src's memory container, so src must be initialized with a container and the memory will not be freed until all views are released.
+    virtual void initAsView(const Tensor1D &src, int offset, int dim);
+
+    /// Make this tensor a *row* x *col* strided view of *src*, whose column i begins at *offset + i \* stride*.
+    ///
+    /// Only the operators reading and writing matrices through stridedMat accept strided views.
+    virtual void initAsStridedView(const Tensor1D &src, int offset, int row, int col, int stride);
+
+    /// Plan this tensor as a view of *src*, whose size is *src_dim*, so that executors will initialize it by initAsPlannedView instead of allocating new memory.
+    ///
+    /// If *stride* is not 0, the view will be a strided one with *row* rows.
+    void planAsView(Tensor1D &src, int src_dim, int offset, int row = 0, int stride = 0);
+
+    bool isPlannedAsView() const {
+        return view_src_ != nullptr;
+    }
+
+    bool isPlannedAsStridedView() const {
+        return view_stride_ != 0;
+    }
+
+    /// Returns the tensor which this tensor is planned as a view of, or nullptr if it is not planned.
+    const Tensor1D *plannedViewSource() const {
+        return view_src_;
+    }
+
+    /// Returns the tensor which the planned views finally refer to, and its size by *root_dim*.
+    Tensor1D &plannedViewRoot(int &root_dim);
+
+    /// Initialize this tensor as the planned view, initializing the planned views it refers to first if necessary. The root tensor should have been initialized.
+    void initAsPlannedView(int dim);
+
+    void clearViewPlan();
+
     virtual bool isInitialized() const {
         return v != nullptr;
     }
@@ -54,6 +92,9 @@ struct Tensor1D {
 
     Vec vec();
 
+    /// Returns the matrix with *row* rows, taking the stride into account.
+    StridedMat stridedMat(int row);
+
     dtype& operator[](const int i);
 
     const dtype& operator[](const int i) const;
@@ -77,6 +118,13 @@ struct Tensor1D {
     virtual std::vector<dtype> toCpu() const;
 
     virtual void checkIsNumber() const;
+
+private:
+    Tensor1D *view_src_ = nullptr;
+    int view_src_dim_ = 0;
+    int view_offset_ = 0;
+    int view_row_ = 0;
+    int view_stride_ = 0;
 };
 
 struct Tensor2D {
@@ -122,12 +170,30 @@ struct Tensor2D {
 
     void norm2one(dtype norm = 1.0);
 
+    /// Release the memory and make this tensor a *nrow* x *ncol* view of *src* beginning at *offset* without copying.
+    ///
+    /// The view keeps src alive, so the memory will not be freed until all views are released.
+    virtual void initAsView(const std::shared_ptr<Tensor2D> &src, int offset, int nrow, int ncol);
+
+    /// Release the memory and make this tensor a *nrow* x *ncol* view of the host memory *v*, which is kept valid by *owner*, e.g., a memory-mapped file.
+    void initAsView(dtype *v, int nrow, int ncol, const std::shared_ptr<void> &owner);
+
+    bool isView() const {
+        return view_owner_ != nullptr;
+    }
+
+    /// Free the memory unless it is a view, leaving the tensor uninitialized.
+    void release();
+
     template<typename Archive>
     void serialize(Archive &ar) {
         ar(row);
         ar(col);
         ar(cereal::binary_data(v, row * col * sizeof(dtype)));
     }
+
+protected:
+    std::shared_ptr<void> view_owner_ = nullptr;
 };
 
 }
@@ -148,6 +214,9 @@ struct Tensor1D : public insnet::cpu::Tensor1D, public Transferable {
     Tensor1D(Tensor1D &&);
     void init(int len) override;
     void init(int dim, const std::shared_ptr<MemoryContainer> &container) override;
+    void initAsView(const cpu::Tensor1D &src, int offset, int dim) override;
+    void initAsStridedView(const cpu::Tensor1D &src, int offset, int row, int col,
+            int stride) override;
     virtual bool isInitialized() const override {
         return value != nullptr;
     }
@@ -202,6 +271,9 @@ struct Tensor2D : public insnet::cpu::Tensor2D, public Transferable {
 
     void assignAll(dtype a) override;
 
+    void initAsView(const std::shared_ptr<cpu::Tensor2D> &src, int offset, int row, int col)
+        override;
+
     void initOnMemoryAndDevice(int row, int col);
 
     void copyFromHostToDevice() override;
@@ -27,6 +27,20 @@ pair<BatchedNode *, BatchedNode *> dotAttention(BatchedNode &key_matrix,
     return make_pair(hidden, scaled_weight);
 }
 
+pair<BatchedNode *, BatchedNode *> dotAttention(BatchedNode &key_matrix,
+        BatchedNode &value_matrix,
+        BatchedNode &query_matrix,
+        int row,
+        const AttentionBand &band,
+        bool is_decoder) {
+    BatchedNode *raw_weights = bandedTranMatrixMulMatrix(key_matrix, query_matrix, row, band,
+            is_decoder);
+    BatchedNode *scaled_weight = mul(*raw_weights, 1.0 / ::sqrt((dtype)row));
+    scaled_weight = softmax(*scaled_weight, band.width());
+    BatchedNode *hidden = bandedMatrixMulMatrix(value_matrix, *scaled_weight, row, band);
+    return make_pair(hidden, scaled_weight);
+}
+
 AdditiveAttentionParams::AdditiveAttentionParams(const string &name) : k(name + "-k"),
     q(name + "-q"), vt(name + "-vt") {}
 
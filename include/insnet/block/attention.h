@@ -2,6 +2,7 @@
 #define INSNET_ATTENTION_H
 
 #include "insnet/operator/linear.h"
+#include "insnet/operator/matrix.h"
 #include "insnet/computation-graph/graph.h"
 #include "insnet/param/base-param.h"
 
@@ -13,6 +14,16 @@ std::pair<BatchedNode *, BatchedNode *> dotAttention(BatchedNode &key_matrix,
         int q_col,
         bool is_decoder);
 
+/// The banded counterpart of dotAttention, where each query only attends to the keys in *band*, so that the time and memory are linear in the sentence length.
+///
+/// The returned weight matrix is *band.width()* x col. Note that K, V and Q should have the same column number.
+std::pair<BatchedNode *, BatchedNode *> dotAttention(BatchedNode &key_matrix,
+        BatchedNode &value_matrix,
+        BatchedNode &query_matrix,
+        int row,
+        const AttentionBand &band,
+        bool is_decoder);
+
 Node * dotAttentionWeights(Node& key_matrix, Node& guide);
 
 struct AdditiveAttentionParams : TunableCombination<BaseParam>
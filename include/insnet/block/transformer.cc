@@ -4,13 +4,16 @@
 #include "insnet/operator/split.h"
 #include "insnet/operator/add.h"
 #include "insnet/operator/embedding.h"
+#include "insnet/operator/bucket.h"
 #include "insnet/block/attention.h"
+#include <tuple>
 
 using std::string;
 using std::function;
 using std::vector;
 using std::cerr;
 using std::endl;
+using std::tie;
 
 namespace insnet {
 
@@ -111,10 +114,13 @@ vector<Tunable<BaseParam>*> TransformerDecoderLayerParams::tunableComponents() {
         &ffn_inner_params_, &ffn_outter_params_, &layer_norm_a_, &layer_norm_b_, &layer_norm_c_};
 }
 
+namespace {
+
 Node *multiheadAttention(Node& q, Node& k, Node& v, int row, int head_count,
         LinearParams &fusion_param,
         dtype dropout_value,
-        bool use_mask) {
+        bool use_mask,
+        const AttentionBand *band) {
     int head_dim = row / head_count;
     vector<int> offsets(head_count);
     for (int i = 0; i < head_count; ++i) {
@@ -134,19 +140,41 @@ Node *multiheadAttention(Node& q, Node& k, Node& v, int row, int head_count,
         abort();
     }
 
-    BatchedNode *split_q = split(q, head_dim, offsets, q_col);
-    BatchedNode *split_k = split(k, head_dim, offsets, v_col);
-    BatchedNode *split_v = split(v, head_dim, offsets, v_col);
-    BatchedNode *split_attended = dotAttention(*split_k, *split_v, *split_q, head_dim,
-            use_mask).first;
-    Node *attended_matrix = cat(*split_attended, q_col);
+    // The heads are strided views of q, k and v, and the attended heads are written into the
+    // concatenated matrix in place, for they are only consumed by the matmul-family operators.
+    BatchedNode *split_q = split(q, head_dim, offsets, q_col, true);
+    BatchedNode *split_k = split(k, head_dim, offsets, v_col, true);
+    BatchedNode *split_v = split(v, head_dim, offsets, v_col, true);
+    BatchedNode *split_attended = band == nullptr ?
+        dotAttention(*split_k, *split_v, *split_q, head_dim, use_mask).first :
+        dotAttention(*split_k, *split_v, *split_q, head_dim, *band, use_mask).first;
+    Node *attended_matrix = cat(*split_attended, q_col, true);
     attended_matrix = linear(*attended_matrix, fusion_param);
     attended_matrix = dropout(*attended_matrix, dropout_value);
     return attended_matrix;
 }
 
+}
+
+Node *multiheadAttention(Node& q, Node& k, Node& v, int row, int head_count,
+        LinearParams &fusion_param,
+        dtype dropout_value,
+        bool use_mask) {
+    return multiheadAttention(q, k, v, row, head_count, fusion_param, dropout_value, use_mask,
+            nullptr);
+}
+
+Node *multiheadAttention(Node& q, Node& k, Node& v, int row, int head_count,
+        LinearParams &fusion_param,
+        dtype dropout_value,
+        bool use_mask,
+        const AttentionBand &band) {
+    return multiheadAttention(q, k, v, row, head_count, fusion_param, dropout_value, use_mask,
+            &band);
+}
+
 vector<Node *> transformerEncoder(Node &inputs, TransformerEncoderParams &params,
-        dtype dropout_value) {
+        dtype dropout_value, bool checkpoint) {
     int hidden_dim = params.hiddenDim();
     int sentence_len = inputs.size() / hidden_dim;
     vector<int> pos_ids;
@@ -168,6 +196,10 @@ vector<Node *> transformerEncoder(Node &inputs, TransformerEncoderParams &params
     hiddens.reserve(layer_count);
     for (int i = 0; i < layer_count; ++i) {
         auto &layer_params = *params.layerParams().ptrs().at(i);
+        if (checkpoint) {
+            graph.beginCheckpointSegment(fmt::format("transformerEncoder-{}-{}",
+                        addressToString(&params), i));
+        }
 
         Node *normed = layerNorm(*last_layer, layer_params.layerNormA());
         auto &attention_head_params = layer_params.multiHeadAttentionParams();
@@ -177,13 +209,17 @@ vector<Node *> transformerEncoder(Node &inputs, TransformerEncoderParams &params
         int dim = params.hiddenDim();
         Node *attended = multiheadAttention(*q, *key, *value, dim, params.headCount(),
                 layer_params.headsFusionParams(), dropout_value, false);
-        Node *added = add({attended, last_layer});
-        normed = layerNorm(*added, layer_params.layerNormB());
+        Node *added;
+        tie(normed, added) = addLayerNorm(*last_layer, *attended,
+                layer_params.layerNormB());
         Node *t = linear(*normed, layer_params.ffnInnerParams());
         t = relu(*t);
         t = linear(*t, layer_params.ffnOutterParams());
         t = dropout(*t, dropout_value);
         t = add({added, t});
+        if (checkpoint) {
+            graph.endCheckpointSegment();
+        }
         last_layer = t;
         hiddens.push_back(last_layer);
     }
@@ -191,14 +227,84 @@ vector<Node *> transformerEncoder(Node &inputs, TransformerEncoderParams &params
     return hiddens;
 }
 
+void TransformerEncoderKVCache::prepare(Node &encoder_hiddens,
+        TransformerDecoderParams &params) {
+    key_nodes_.clear();
+    value_nodes_.clear();
+    for (int i = 0; i < params.layerCount(); ++i) {
+        auto &attention_head_params = params.layerParams().ptrs().at(i)->encoderAttention();
+        key_nodes_.push_back(linear(encoder_hiddens, attention_head_params.k()));
+        value_nodes_.push_back(linear(encoder_hiddens, attention_head_params.v()));
+    }
+}
+
+void TransformerEncoderKVCache::persist() {
+    if (key_nodes_.empty()) {
+        cerr << "TransformerEncoderKVCache::persist - not prepared" << endl;
+        abort();
+    }
+    keys_.clear();
+    values_.clear();
+    column_ = key_nodes_.front()->getColumn();
+    for (auto ptr : {std::make_pair(&key_nodes_, &keys_),
+            std::make_pair(&value_nodes_, &values_)}) {
+        for (Node *node : *ptr.first) {
+            if (!node->getVal().isInitialized()) {
+                cerr << "TransformerEncoderKVCache::persist - the graph is not forwarded" << endl;
+                abort();
+            }
+            std::unique_ptr<Tensor1D> t(new Tensor1D);
+            t->initAsView(node->getVal(), 0, node->size());
+            ptr.second->push_back(std::move(t));
+        }
+    }
+    key_nodes_.clear();
+    value_nodes_.clear();
+}
+
+vector<Node *> TransformerEncoderKVCache::keys(Graph &graph) const {
+    vector<Node *> results;
+    results.reserve(keys_.size());
+    for (const auto &t : keys_) {
+        results.push_back(tensor(graph, *t, column_));
+    }
+    return results;
+}
+
+vector<Node *> TransformerEncoderKVCache::values(Graph &graph) const {
+    vector<Node *> results;
+    results.reserve(values_.size());
+    for (const auto &t : values_) {
+        results.push_back(tensor(graph, *t, column_));
+    }
+    return results;
+}
+
 TransformerDecoderBuilderAbs::TransformerDecoderBuilderAbs(TransformerDecoderParams &params,
         Node &encoder_hiddens,
         dtype dropout) : params_(&params), encoder_hiddens_(&encoder_hiddens), dropout_(dropout) {}
 
+TransformerDecoderBuilderAbs::TransformerDecoderBuilderAbs(TransformerDecoderParams &params,
+        Graph &graph,
+        const TransformerEncoderKVCache &cache,
+        dtype dropout) : graph_(&graph), params_(&params), cache_(&cache), dropout_(dropout) {
+    if (cache.layerCount() != params.layerCount()) {
+        cerr << fmt::format("TransformerDecoderBuilderAbs - cache layerCount:{} params layerCount:{}",
+                cache.layerCount(), params.layerCount()) << endl;
+        abort();
+    }
+}
+
 void TransformerDecoderBuilderAbs::prepare() {
     if (prepared_) {
         return;
     }
+    if (cache_ != nullptr) {
+        encoder_key_matrices_ = cache_->keys(*graph_);
+        encoder_value_matrices_ = cache_->values(*graph_);
+        prepared_ = true;
+        return;
+    }
     int layer_count = params_->layerCount();
     for (int i = 0; i < layer_count; ++i) {
         auto &layer_params = *params_->layerParams().ptrs().at(i);
@@ -221,6 +327,16 @@ TransformerDecoderCellBuilder::TransformerDecoderCellBuilder(TransformerDecoderP
     }
 }
 
+TransformerDecoderCellBuilder::TransformerDecoderCellBuilder(TransformerDecoderParams &params,
+        Graph &graph,
+        const TransformerEncoderKVCache &cache,
+        dtype dropout) : TransformerDecoderBuilderAbs(params, graph, cache, dropout) {
+    for (int i = 0; i < params.layerCount(); ++i) {
+        key_matrix_layers_.push_back(nullptr);
+        value_matrix_layers_.push_back(nullptr);
+    }
+}
+
 void TransformerDecoderCellBuilder::prepare() {
     if (prepared_) {
         return;
@@ -247,10 +363,11 @@ void TransformerDecoderCellBuilder::step(Node &decoder_input) {
     pos_encoded = dropout(*pos_encoded, dropout_);
 
     int layer_count = params_->layerCount();
-    int encoder_sentence_len = encoder_hiddens_->size() / params_->hiddenDim();
-    if (encoder_sentence_len * params_->hiddenDim() != encoder_hiddens_->size()) {
-        cerr << fmt::format("TransformerDecoderCellBuilder::step - encoder_sentence_len:{} hidden_dim:{} encoder_hiddens_ dim:{}",
-                encoder_sentence_len, encoder_hiddens_->size(), encoder_hiddens_->size())
+    int encoder_dim = encoder_key_matrices_.front()->size();
+    int encoder_sentence_len = encoder_dim / params_->hiddenDim();
+    if (encoder_sentence_len * params_->hiddenDim() != encoder_dim) {
+        cerr << fmt::format("TransformerDecoderCellBuilder::step - encoder_sentence_len:{} hidden_dim:{} encoder dim:{}",
+                encoder_sentence_len, params_->hiddenDim(), encoder_dim)
             << endl;
         abort();
     }
@@ -272,16 +389,16 @@ void TransformerDecoderCellBuilder::step(Node &decoder_input) {
         int dim = params_->hiddenDim();
         Node *attended = multiheadAttention(*q, *key_matrix, *value_matrix, dim,
                 params_->headCount(), layer_params.selfFusion(), dropout_, false);
-        Node *added = add({attended, last_layer_node});
-        normed = layerNorm(*added, layer_params.layerNormB());
+        Node *added;
+        tie(normed, added) = addLayerNorm(*last_layer_node, *attended,
+                layer_params.layerNormB());
 
         auto &attention_head_params_for_encoder = layer_params.encoderAttention();
         q = linear(*normed, attention_head_params_for_encoder.q());
         attended = multiheadAttention(*q, *encoder_key_matrices_.at(i),
                 *encoder_value_matrices_.at(i), dim, params_->headCount(),
                 layer_params.encoderFusion(), dropout_, false);
-        added = add({added, attended});
-        normed = layerNorm(*added, layer_params.layerNormC());
+        tie(normed, added) = addLayerNorm(*added, *attended, layer_params.layerNormC());
 
         Node *t = linear(*normed, layer_params.ffnInnerParams());
         t = relu(*t);
@@ -298,6 +415,10 @@ TransformerDecoderBuilder::TransformerDecoderBuilder(TransformerDecoderParams &p
         Node &encoder_hiddens, dtype dropout) : TransformerDecoderBuilderAbs(params,
             encoder_hiddens, dropout) {}
 
+TransformerDecoderBuilder::TransformerDecoderBuilder(TransformerDecoderParams &params,
+        Graph &graph, const TransformerEncoderKVCache &cache,
+        dtype dropout) : TransformerDecoderBuilderAbs(params, graph, cache, dropout) {}
+
 void TransformerDecoderBuilder::connect(Node &inputs) {
     if (!prepared_) {
         cerr << "TransformerDecoderBuilder forward - not prepared" << endl;
@@ -327,10 +448,11 @@ void TransformerDecoderBuilder::connect(Node &inputs) {
     int layer_count = params_->layerCount();
     Node *last_layer = pos_encoded;
 
-    int encoder_sentence_len = encoder_hiddens_->size() / params_->hiddenDim();
-    if (encoder_sentence_len * params_->hiddenDim() != encoder_hiddens_->size()) {
-        cerr << fmt::format("TransformerDecoderCellBuilder::step - encoder_sentence_len:{} hidden_dim:{} encoder_hiddens_ dim:{}",
-                encoder_sentence_len, encoder_hiddens_->size(), encoder_hiddens_->size())
+    int encoder_dim = encoder_key_matrices_.front()->size();
+    int encoder_sentence_len = encoder_dim / params_->hiddenDim();
+    if (encoder_sentence_len * params_->hiddenDim() != encoder_dim) {
+        cerr << fmt::format("TransformerDecoderBuilder::connect - encoder_sentence_len:{} hidden_dim:{} encoder dim:{}",
+                encoder_sentence_len, params_->hiddenDim(), encoder_dim)
             << endl;
         abort();
     }
@@ -345,16 +467,16 @@ void TransformerDecoderBuilder::connect(Node &inputs) {
         int dim = params_->hiddenDim();
         Node *attended = multiheadAttention(*q, *k, *v, dim, params_->headCount(),
                 layer_params.selfFusion(), dropout_, true);
-        Node *added = add({attended, last_layer});
-        normed = layerNorm(*added, layer_params.layerNormB());
+        Node *added;
+        tie(normed, added) = addLayerNorm(*last_layer, *attended,
+                layer_params.layerNormB());
 
         auto &attention_head_params_for_encoder = layer_params.encoderAttention();
         q = linear(*normed, attention_head_params_for_encoder.q());
         attended = multiheadAttention(*q, *encoder_key_matrices_.at(i),
                 *encoder_value_matrices_.at(i), dim, params_->headCount(),
                 layer_params.encoderFusion(), dropout_, false);
-        added = add({added, attended});
-        normed = layerNorm(*added, layer_params.layerNormC());
+        tie(normed, added) = addLayerNorm(*added, *attended, layer_params.layerNormC());
 
         Node *t = linear(*normed, layer_params.ffnInnerParams());
         t = relu(*t);
@@ -446,16 +568,16 @@ TransformerDecoderState transformerDecoder(const TransformerDecoderState &state,
         int dim = params.hiddenDim();
         Node *attended = multiheadAttention(*q, *key_matrix, *value_matrix, dim,
                 params.headCount(), layer_params.selfFusion(), dropout_value, false);
-        Node *added = add({attended, last_layer_node});
-        normed = layerNorm(*added, layer_params.layerNormB());
+        Node *added;
+        tie(normed, added) = addLayerNorm(*last_layer_node, *attended,
+                layer_params.layerNormB());
 
         auto &attention_head_params_for_encoder = layer_params.encoderAttention();
         q = linear(*normed, attention_head_params_for_encoder.q());
         attended = multiheadAttention(*q, *encoder_keys.at(i),
                 *encoder_values.at(i), dim, params.headCount(),
                 layer_params.encoderFusion(), dropout_value, false);
-        added = add({added, attended});
-        normed = layerNorm(*added, layer_params.layerNormC());
+        tie(normed, added) = addLayerNorm(*added, *attended, layer_params.layerNormC());
 
         Node *t = linear(*normed, layer_params.ffnInnerParams());
         t = relu(*t);
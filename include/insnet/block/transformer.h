@@ -3,6 +3,7 @@
 
 #include "insnet/operator/linear.h"
 #include "insnet/operator/layer_normalization.h"
+#include "insnet/operator/matrix.h"
 
 namespace insnet {
 
@@ -282,6 +283,25 @@ Node *multiheadAttention(Node& Q, Node& K, Node& V, int embed_dim, int num_heads
         dtype dropout,
         bool use_mask);
 
+/// \ingroup module
+/// The multi-head attention where each query only attends to the keys in *band*, e.g., a sliding window or a block-sparse pattern, which makes the time and memory linear in the sentence length for long documents.
+///
+/// **The operators inside guarantee that multiheadAttention with the equal embed_dim, num_heads, Wo, dropout, use_mask and band will be executed in batch, no matter the sentence lengths.**
+/// \param Q The query matrix before divided into multi-heads. Its size should be equal to K and V.
+/// \param K The key matrix before divided into multi-heads.
+/// \param V The value matrix before divided into multi-heads.
+/// \param embed_dim The row number of Q, K and V. It should be divisible by *num_heads*.
+/// \param num_heads The head number.
+/// \param Wo The weight matrix of the output linear transformation.
+/// \param dropout The dropout value of the dropout following the output linear transformation.
+/// \param use_mask Whether to mask future tokens in K.
+/// \param band The keys that each query attends to. See AttentionBand::slidingWindow and AttentionBand::blockSparse.
+/// \return The result matrix. Its size is equal to Q.size().
+Node *multiheadAttention(Node& Q, Node& K, Node& V, int embed_dim, int num_heads, LinearParams &Wo,
+        dtype dropout,
+        bool use_mask,
+        const AttentionBand &band);
+
 /// \ingroup module
 /// The Transformer encoder. It uses the pre-layernorm version of the Transformer. See <a href="https://openreview.net/forum?id=B1x8anVFPr">On Layer Normalization in the Transformer Architecture</a>.
 /// 
@@ -289,15 +309,48 @@ Node *multiheadAttention(Node& Q, Node& K, Node& V, int embed_dim, int num_heads
 /// \param input The input matrix. Note that for the current version, the positional encoding is added inside transformerEncoder using sin and cos, which may lack flexibility.
 /// \param params The Transformer encoder parameters.
 /// \param dropout The dropout value. The dropout is added after self-attention and FFN, respectively.
+/// \param checkpoint Whether to make each layer a checkpoint segment, so that the activations inside layers are recomputed in backward instead of being kept. See Graph::beginCheckpointSegment. *The default value is false.*
 /// \return The list of hidden matrices of each layer.
 std::vector<Node *> transformerEncoder(Node &input, TransformerEncoderParams &params,
-        dtype dropout);
+        dtype dropout, bool checkpoint = false);
+
+/// The encoder-side key and value matrices of each Transformer decoder layer.
+///
+/// They only depend on the encoder hidden states, so they are computed once per source sentence in the encoder's graph and then persisted independently of any graph, to be referenced as constant inputs by all decoding steps and beams without copying or recomputing.
+class TransformerEncoderKVCache {
+public:
+    /// Build the key and value linear transformations of each layer in the encoder's graph.
+    /// \param encoder_hiddens The encoder hidden matrix.
+    /// \param params The Transformer decoder parameters.
+    void prepare(Node &encoder_hiddens, TransformerDecoderParams &params);
+
+    /// Take over the memory of the key and value matrices. It should be called after the encoder graph's forward pass and before its destruction.
+    void persist();
+
+    /// Reference the cached key matrices in *graph*. Call it once per graph and share the results among all the beams.
+    std::vector<Node *> keys(Graph &graph) const;
+
+    /// Reference the cached value matrices in *graph*. Call it once per graph and share the results among all the beams.
+    std::vector<Node *> values(Graph &graph) const;
+
+    int layerCount() const {
+        return keys_.size();
+    }
+
+private:
+    std::vector<Node *> key_nodes_, value_nodes_;
+    std::vector<std::unique_ptr<Tensor1D>> keys_, values_;
+    int column_ = 0;
+};
 
 class TransformerDecoderBuilderAbs {
 public:
     TransformerDecoderBuilderAbs(TransformerDecoderParams &params, Node &encoder_hiddens,
             dtype dropout);
 
+    TransformerDecoderBuilderAbs(TransformerDecoderParams &params, Graph &graph,
+            const TransformerEncoderKVCache &cache, dtype dropout);
+
     virtual ~TransformerDecoderBuilderAbs() = default;
 
     virtual void prepare();
@@ -306,7 +359,8 @@ protected:
     Graph *graph_ = nullptr;
     TransformerDecoderParams *params_ = nullptr;
 
-    Node *encoder_hiddens_;
+    Node *encoder_hiddens_ = nullptr;
+    const TransformerEncoderKVCache *cache_ = nullptr;
 
     std::vector<Node *> encoder_key_matrices_;
     std::vector<Node *> encoder_value_matrices_;
@@ -321,6 +375,9 @@ public:
     TransformerDecoderCellBuilder(TransformerDecoderParams &params, Node &encoder_hiddens,
             dtype dropout);
 
+    TransformerDecoderCellBuilder(TransformerDecoderParams &params, Graph &graph,
+            const TransformerEncoderKVCache &cache, dtype dropout);
+
     const std::vector<std::vector<Node *>> &hiddenLayers() {
         return hidden_layers_;
     }
@@ -340,6 +397,9 @@ public:
     TransformerDecoderBuilder(TransformerDecoderParams &params, Node &encoder_hiddens,
             dtype dropout);
 
+    TransformerDecoderBuilder(TransformerDecoderParams &params, Graph &graph,
+            const TransformerEncoderKVCache &cache, dtype dropout);
+
     void connect(Node &inputs);
 
     std::vector<Node *> &hiddenLayers() {
@@ -396,7 +456,7 @@ private:
 /// 
 /// It exploits the previous state to compute the next, which is useful in beam search.
 /// \param state The last state. In particular, it should contain nullptr vector of size n if it is the initial state, where n is the layer number.
-/// \param encoder_keys The encoder key matrices. Its size is equal to the layer number.
+/// \param encoder_keys The encoder key matrices. Its size is equal to the layer number. They can be referenced from a TransformerEncoderKVCache to avoid recomputing them at every step.
 /// \param encoder_values The encoder value matrices. Its size is equal to the layer number.
 /// \param input The decoder input vector. Its size is equal to hidden_dim, i.e., it does not contain previous inputs.
 /// \param params The Transformer decoder parameters.
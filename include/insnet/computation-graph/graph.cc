@@ -1,4 +1,7 @@
 #include "insnet/computation-graph/graph.h"
+#include <algorithm>
+#include <chrono>
+#include <unordered_set>
 #include "insnet/util/profiler.h"
 
 using std::map;
@@ -9,11 +12,18 @@ using std::vector;
 using std::cerr;
 using std::cout;
 using std::endl;
+using std::any_of;
+using std::unordered_set;
 
 namespace insnet {
 
 namespace {
 
+int64_t nowInNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 void Insert(NodeAbs *node, NodeMap& node_map) {
     string x_hash = node->cachedTypeSig();
     auto it = node_map.find(x_hash);
@@ -41,8 +51,9 @@ Graph::Graph(ModelStage stage, bool eager, bool calculate_flops, bool calculate_
     calculate_activations_(calculate_activations) {}
 
 Graph::~Graph() {
+    static const int graph_destructor = Profiler::eventId("graph_destructor");
     Profiler &profiler = Profiler::Ins();
-    profiler.BeginEvent("graph_destructor");
+    profiler.BeginEvent(graph_destructor);
 
     int count = execs.size();
     for (int idx = 0; idx < count; idx++) {
@@ -87,9 +98,151 @@ Graph::~Graph() {
 
 void Graph::backward() {
     int count = execs.size();
+
+    // A param's grad is complete after the backward of the first executor using it in forward.
+    vector<vector<BaseParam *>> complete_params;
+    if (complete_grads_callback_) {
+        complete_params.resize(count);
+        unordered_set<BaseParam *> used_params;
+        for (int idx = 0; idx < count; ++idx) {
+            for (BaseParam *param : execs.at(idx)->params()) {
+                if (used_params.insert(param).second) {
+                    complete_params.at(idx).push_back(param);
+                }
+            }
+        }
+    }
+
     for (int idx = count - 1; idx >= 0; idx--) {
-        execs.at(idx)->backwardFully();
+        Executor *exec = execs.at(idx);
+        if (exec->checkpoint_segment >= 0) {
+            CheckpointSegment &segment = checkpoint_segments_.at(exec->checkpoint_segment);
+            if (segment.is_dropped) {
+                recomputeCheckpointSegment(segment);
+            }
+        }
+        BatchingStats *stats = idx < exec_batching_stats_.size() ?
+            exec_batching_stats_.at(idx) : nullptr;
+        if (stats == nullptr) {
+            exec->backwardFully();
+        } else {
+            int64_t begin = nowInNanoseconds();
+            exec->backwardFully();
+            stats->backward_time_in_nanoseconds += nowInNanoseconds() - begin;
+        }
+        if (complete_grads_callback_ && !complete_params.at(idx).empty()) {
+            complete_grads_callback_(complete_params.at(idx));
+        }
+    }
+}
+
+void Graph::beginCheckpointSegment(const string &name) {
+    if (current_checkpoint_segment_ >= 0) {
+        cerr << fmt::format("Graph beginCheckpointSegment - {} begins before the last ends\n",
+                name);
+        abort();
+    }
+#if !USE_GPU
+    if (eager_) {
+        return;
+    }
+    auto it = checkpoint_segment_ids_.find(name);
+    if (it == checkpoint_segment_ids_.end()) {
+        it = checkpoint_segment_ids_.insert(make_pair(name, checkpoint_segments_.size())).first;
+        checkpoint_segments_.emplace_back();
+    }
+    current_checkpoint_segment_ = it->second;
+#endif
+}
+
+void Graph::endCheckpointSegment() {
+    current_checkpoint_segment_ = -1;
+}
+
+void Graph::setBFloat16Compute(bool enabled) {
+    if (enabled && getModelStage() != ModelStage::INFERENCE) {
+        cerr << "Graph setBFloat16Compute - only supported in inference" << endl;
+        abort();
+    }
+    bfloat16_compute_ = enabled;
+}
+
+void Graph::dropCheckpointSegment(CheckpointSegment &segment) {
+    int id = segment.execs.front()->checkpoint_segment;
+    // The references released after forward without checkpointing, so that only the vals otherwise
+    // kept until backward are counted as dropped.
+    map<Tensor1D *, int> forward_only_refs;
+    for (Executor *exec : segment.execs) {
+        for (Node *node : exec->batch) {
+            for (Tensor1D *val : node->forwardOnlyInputVals()) {
+                ++forward_only_refs[val];
+            }
+        }
+    }
+    // The vals sharing a memory container are dropped only if nothing else, e.g., a view or a val
+    // used outside the segment, refers to it, since otherwise dropping them frees no memory.
+    map<MemoryContainer *, vector<Tensor1D *>> containers;
+    for (Executor *exec : segment.execs) {
+        for (Node *node : exec->valOwners()) {
+            Tensor1D *val = &node->val();
+            const auto &parents = node->topologicalNode().getParents();
+            if (!val->isInitialized() || parents.empty() || any_of(parents.begin(),
+                        parents.end(), [id](NodeAbs *parent) {
+                            return parent->getCheckpointSegment() != id;
+                        })) {
+                continue;
+            }
+            containers[val->memory_container_.get()].push_back(val);
+        }
+    }
+    for (auto &it : containers) {
+        if (it.second.front()->memory_container_.use_count() !=
+                static_cast<long>(it.second.size())) {
+            continue;
+        }
+        for (Tensor1D *val : it.second) {
+            segment.dropped_vals.push_back(make_pair(val, val->ref_count_));
+            if (val->ref_count_ > forward_only_refs[val]) {
+                dropped_activations_ += val->dim;
+            }
+            val->releaseMemory();
+        }
+    }
+    if (segment.dropped_vals.empty()) {
+        return;
+    }
+    for (Executor *exec : segment.execs) {
+        dropped_activations_ += exec->releaseForwardStates();
+    }
+    segment.is_dropped = true;
+}
+
+void Graph::recomputeCheckpointSegment(CheckpointSegment &segment) {
+    static const int recompute = Profiler::eventId("recompute");
+    Profiler &profiler = Profiler::Ins();
+    profiler.BeginEvent(recompute);
+    is_recomputing_ = true;
+    vector<cpu::Tensor1D *> initialized;
+    for (Executor *exec : segment.execs) {
+        recomputed_flops_ += exec->recompute(initialized, calculate_flops_);
+    }
+    is_recomputing_ = false;
+
+    map<cpu::Tensor1D *, int> ref_counts;
+    for (auto &it : segment.dropped_vals) {
+        ref_counts.insert(it);
     }
+    for (cpu::Tensor1D *val : initialized) {
+        auto it = ref_counts.find(val);
+        if (it == ref_counts.end()) {
+            val->releaseMemory();
+        } else {
+            val->ref_count_ = it->second;
+        }
+    }
+    segment.dropped_vals.clear();
+    segment.is_dropped = false;
+    profiler.EndEvent();
 }
 
 void Graph::addNode(NodeAbs *x) {
@@ -98,6 +251,10 @@ void Graph::addNode(NodeAbs *x) {
         abort();
     }
     x->setNodeContainer(*this);
+    if (current_checkpoint_segment_ >= 0) {
+        x->setCheckpointSegment(current_checkpoint_segment_);
+        ++checkpoint_segments_.at(current_checkpoint_segment_).pending_node_count;
+    }
     if (x->getDegree() == 0) {
         Insert(x, free_nodes);
     }
@@ -109,9 +266,10 @@ void Graph::addNode(NodeAbs *x) {
 }
 
 void Graph::forward() {
+    static const int dynamic_batching = Profiler::eventId("dynamic_batching");
     while (true) {
         Profiler &profiler = Profiler::Ins();
-        profiler.BeginEvent("dynamic_batching");
+        profiler.BeginEvent(dynamic_batching);
         if (Size(free_nodes) <= 0) {
             profiler.EndEvent();
             break;
@@ -134,26 +292,59 @@ void Graph::forward() {
                 cur_exec->batch.push_back(dynamic_cast<Node *>(node));
             }
         }
+        BatchingStats *stats = nullptr;
+        if (calculate_batching_stats_) {
+            stats = &batching_stats_[free_nodes_begin->first];
+        }
         free_nodes.erase(free_nodes_begin->first);
 
+        int segment = cur_exec->topo_nodes.front()->getCheckpointSegment();
+        for (NodeAbs *node : cur_exec->topo_nodes) {
+            if (node->getCheckpointSegment() != segment) {
+                segment = -1;
+                break;
+            }
+        }
+        if (segment >= 0) {
+            checkpoint_segments_.at(segment).execs.push_back(cur_exec);
+        } else {
+            for (NodeAbs *node : cur_exec->topo_nodes) {
+                if (node->getCheckpointSegment() >= 0) {
+                    checkpoint_segments_.at(node->getCheckpointSegment()).is_mixed = true;
+                }
+            }
+        }
+        cur_exec->checkpoint_segment = segment;
+
         profiler.EndEvent();
-        cur_exec->forwardFully();
-        profiler.BeginEvent("dynamic_batching");
+        if (stats == nullptr) {
+            cur_exec->forwardFully();
+        } else {
+            int64_t begin = nowInNanoseconds();
+            cur_exec->forwardFully();
+            int64_t time = nowInNanoseconds() - begin;
+            int batch_size = cur_exec->batch.size();
+            if (stats->executor_count == 0) {
+                stats->node_type = cur_exec->getNodeType();
+                stats->min_batch_size = batch_size;
+            }
+            ++stats->executor_count;
+            stats->node_count += batch_size;
+            stats->min_batch_size = std::min(stats->min_batch_size, batch_size);
+            stats->max_batch_size = std::max(stats->max_batch_size, batch_size);
+            stats->singleton_count += batch_size == 1;
+            stats->forward_time_in_nanoseconds += time;
+            stats->flops += cur_exec->calculateFLOPs();
+            stats->bytes += cur_exec->calculateBytes();
+        }
+        profiler.BeginEvent(dynamic_batching);
         if (eager_) {
             for (Node *node : cur_exec->batch) {
                 node->getVal().checkIsNumber();
             }
         }
         if (calculate_flops_) {
-#if !USE_GPU
-            const auto &it = flops_table_.find(cur_exec->getNodeType());
-            if (it == flops_table_.end()) {
-                flops_table_.insert(make_pair(cur_exec->getNodeType(),
-                            cur_exec->calculateFLOPs()));
-            } else {
-                it->second += cur_exec->calculateFLOPs();
-            }
-#endif
+            flops_table_[cur_exec->getNodeType()] += cur_exec->calculateFLOPs();
         }
         if (calculate_activations_) {
 #if !USE_GPU
@@ -162,6 +353,20 @@ void Graph::forward() {
         }
 
         execs.push_back(cur_exec);
+        if (stats != nullptr) {
+            exec_batching_stats_.resize(execs.size() - 1);
+            exec_batching_stats_.push_back(stats);
+        }
+
+        for (NodeAbs *node : cur_exec->topo_nodes) {
+            if (node->getCheckpointSegment() >= 0) {
+                CheckpointSegment &segment = checkpoint_segments_.at(
+                        node->getCheckpointSegment());
+                if (--segment.pending_node_count == 0 && !segment.is_mixed) {
+                    dropCheckpointSegment(segment);
+                }
+            }
+        }
 
         int depth_sum = 0;
         for (NodeAbs* free_node : cur_exec->topo_nodes) {
@@ -187,6 +392,79 @@ void Graph::forward() {
     }
 }
 
+int64_t Graph::getExecutedNodeCount() const {
+    int64_t sum = 0;
+    for (Executor *exec : execs) {
+        sum += exec->batch.size();
+    }
+    return sum;
+}
+
+string Graph::batchingReport() const {
+    vector<pair<string, const BatchingStats *>> sorted;
+    int executor_count = 0;
+    int64_t node_count = 0;
+    int singleton_count = 0;
+    for (const auto &it : batching_stats_) {
+        sorted.push_back(make_pair(it.first, &it.second));
+        executor_count += it.second.executor_count;
+        node_count += it.second.node_count;
+        singleton_count += it.second.singleton_count;
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const pair<string, const BatchingStats *> &a,
+                const pair<string, const BatchingStats *> &b) {
+        return a.second->executor_count > b.second->executor_count;
+    });
+
+    string report = fmt::format(
+            "signatures:{} executors:{} nodes:{} singleton executors:{} mean batch size:{}\n",
+            sorted.size(), executor_count, node_count, singleton_count,
+            executor_count == 0 ? 0.0f : static_cast<float>(node_count) / executor_count);
+    for (const auto &it : sorted) {
+        const BatchingStats &stats = *it.second;
+        report += fmt::format("type:{} executors:{} nodes:{} batch size min:{} mean:{} max:{} "
+                "singletons:{} forward:{:.3f}ms backward:{:.3f}ms signature:{}\n", stats.node_type,
+                stats.executor_count, stats.node_count, stats.min_batch_size,
+                stats.meanBatchSize(), stats.max_batch_size, stats.singleton_count,
+                stats.forward_time_in_nanoseconds / 1e6,
+                stats.backward_time_in_nanoseconds / 1e6, it.first);
+    }
+    return report;
+}
+
+string Graph::rooflineReport() const {
+    map<string, BatchingStats> type_stats;
+    for (const auto &it : batching_stats_) {
+        const BatchingStats &stats = it.second;
+        BatchingStats &sum = type_stats[stats.node_type];
+        sum.executor_count += stats.executor_count;
+        sum.forward_time_in_nanoseconds += stats.forward_time_in_nanoseconds;
+        sum.flops += stats.flops;
+        sum.bytes += stats.bytes;
+    }
+    vector<pair<string, const BatchingStats *>> sorted;
+    for (const auto &it : type_stats) {
+        sorted.push_back(make_pair(it.first, &it.second));
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const pair<string, const BatchingStats *> &a,
+                const pair<string, const BatchingStats *> &b) {
+        return a.second->forward_time_in_nanoseconds > b.second->forward_time_in_nanoseconds;
+    });
+
+    string report;
+    for (const auto &it : sorted) {
+        const BatchingStats &stats = *it.second;
+        // FLOPs and bytes per nanosecond are GFLOP/s and GB/s.
+        float time = std::max<int64_t>(stats.forward_time_in_nanoseconds, 1);
+        report += fmt::format("type:{} executors:{} forward:{:.3f}ms FLOPs:{} bytes:{} "
+                "GFLOP/s:{:.2f} GB/s:{:.2f} FLOPs/byte:{:.2f}\n", it.first, stats.executor_count,
+                stats.forward_time_in_nanoseconds / 1e6, stats.flops, stats.bytes,
+                stats.flops / time, stats.bytes / time,
+                stats.bytes == 0 ? 0.0f : static_cast<float>(stats.flops) / stats.bytes);
+    }
+    return report;
+}
+
 void Graph::addFLOPs(int64_t flops, const string &name) {
     if (calculate_flops_) {
         const auto &it = flops_table_.find(name);
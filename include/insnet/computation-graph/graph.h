@@ -1,6 +1,7 @@
 #ifndef INSNET_GRAPH_H
 #define INSNET_GRAPH_H
 
+#include <functional>
 #include <unordered_map>
 #include "insnet/computation-graph/node.h"
 
@@ -13,6 +14,32 @@ namespace insnet {
 
 typedef std::unordered_map<std::string, std::vector<NodeAbs *>> NodeMap;
 
+/// \brief The dynamic batching statistics of the executors of an operator signature.
+struct BatchingStats {
+    std::string node_type;
+    int executor_count = 0;
+
+    /// The number of nodes executed, where each node of a batched node is counted.
+    int64_t node_count = 0;
+
+    int min_batch_size = 0;
+    int max_batch_size = 0;
+
+    /// The number of executors whose batch size is 1.
+    int singleton_count = 0;
+
+    int64_t forward_time_in_nanoseconds = 0;
+    int64_t backward_time_in_nanoseconds = 0;
+
+    /// The FLOPs and the bytes read or written of the forward passes, estimated by Executor::calculateFLOPs and Executor::calculateBytes.
+    int64_t flops = 0;
+    int64_t bytes = 0;
+
+    float meanBatchSize() const {
+        return executor_count == 0 ? 0 : static_cast<float>(node_count) / executor_count;
+    }
+};
+
 /// \brief The computation graph.
 class Graph : public NodeContainer {
 public:
@@ -40,6 +67,76 @@ public:
 
     void addFLOPs(int64_t flops, const std::string &name);
 
+    /// Returns the number of executors generated by dynamic batching in forward.
+    int getExecutorCount() const {
+        return execs.size();
+    }
+
+    /// Returns the number of nodes executed in forward, where each node of a batched node is counted.
+    int64_t getExecutedNodeCount() const;
+
+    /// Set whether to collect the dynamic batching statistics per operator signature, which are reported by getBatchingStats and batchingReport. *The default value is false.*
+    ///
+    /// On GPU, the times only include launching the kernels unless the profiler is enabled, which synchronizes the device after each executor.
+    void setCalculateBatchingStats(bool enabled) {
+        calculate_batching_stats_ = enabled;
+    }
+
+    /// Returns the dynamic batching statistics keyed by the operator signatures.
+    const std::map<std::string, BatchingStats> &getBatchingStats() const {
+        return batching_stats_;
+    }
+
+    /// Returns the report of the batching statistics, listing the signatures by their executor counts in descending order, so that the operators fragmenting batching come first.
+    std::string batchingReport() const;
+
+    /// Returns the roofline report of the forward pass from the batching statistics, listing the operator types by their forward times in descending order with the achieved GFLOP/s and GB/s, and the arithmetic intensity, i.e., FLOPs per byte. The operators whose intensity is below the machine's peak FLOP/s divided by its memory bandwidth are bandwidth-bound, and the others are compute-bound.
+    ///
+    /// It requires setCalculateBatchingStats(true), and on GPU, the profiler to be enabled so that the times include the kernels.
+    std::string rooflineReport() const;
+
+    /// Set the callback called in backward with the params whose grads are complete, i.e., that no executor left will accumulate into, so that their gradient communication overlaps the rest of backward. See DataParallel.
+    ///
+    /// The params not used by the graph are not passed.
+    void setCompleteGradsCallback(
+            const std::function<void(const std::vector<BaseParam *> &)> &callback) {
+        complete_grads_callback_ = callback;
+    }
+
+    /// Begin the checkpoint segment *name*, to which the nodes added before endCheckpointSegment belong.
+    ///
+    /// Once all the nodes of a segment are executed in forward, the vals only used inside the segment are dropped along with the states its executors keep for backward, e.g., the copies of the inputs of linear layers, and they are recomputed by re-executing the segment's executors right before its backward, trading FLOPs for activation memory. The segment's inputs from outside are kept until backward instead. Nodes of the same segment name, e.g., of the same Transformer layer in different sentences, are executed in batch as usual, but a segment is not dropped if any of its nodes are batched with nodes outside it.
+    ///
+    /// Checkpointing is only supported on CPU, and is ignored in eager mode or on GPU.
+    void beginCheckpointSegment(const std::string &name);
+
+    void endCheckpointSegment();
+
+    /// Returns the number of the elements that checkpoint segments free after forward and would be kept until backward otherwise, i.e., the vals read in backward and the states the executors keep for backward.
+    int64_t getDroppedActivations() const {
+        return dropped_activations_;
+    }
+
+    /// Returns the extra FLOPs of recomputing checkpoint segments in backward, to be compared with getFLOPs(). It is only calculated if calculate_flops is true.
+    int64_t getRecomputedFLOPs() const {
+        return recomputed_flops_;
+    }
+
+    bool isRecomputing() const override {
+        return is_recomputing_;
+    }
+
+    bool isEager() const override {
+        return eager_;
+    }
+
+    /// Set whether the linear and embedding operators take the bfloat16 compute path, i.e., read the bfloat16 copies of the params' values instead, for the params that have them (see BaseParam::setBFloat16Compute), which is used for memory-bandwidth bound inference on CPU. The activations are still in dtype. It is only supported by the graphs of ModelStage::INFERENCE, since the backward would use the values the forward did not read. *The default value is false.*
+    void setBFloat16Compute(bool enabled);
+
+    bool isBFloat16Compute() const override {
+        return bfloat16_compute_;
+    }
+
 protected:
     std::vector<Executor *> execs;
     NodeMap free_nodes;
@@ -53,6 +150,41 @@ private:
     bool calculate_activations_ = false;
     int64_t activations_ = 0;
     int all_nodes_count = 0;
+
+    struct CheckpointSegment {
+        int pending_node_count = 0;
+
+        /// Whether some nodes are batched with nodes outside the segment, in which case it is not dropped.
+        bool is_mixed = false;
+
+        bool is_dropped = false;
+        std::vector<Executor *> execs;
+
+        /// The dropped vals and their reference counts before being dropped.
+        std::vector<std::pair<cpu::Tensor1D *, int>> dropped_vals;
+    };
+
+    /// Drop the vals only used inside the segment after its forward, and the executors' states for backward.
+    void dropCheckpointSegment(CheckpointSegment &segment);
+
+    /// Recompute the dropped vals of the segment, releasing the vals that had been released in forward again.
+    void recomputeCheckpointSegment(CheckpointSegment &segment);
+
+    std::unordered_map<std::string, int> checkpoint_segment_ids_;
+    std::vector<CheckpointSegment> checkpoint_segments_;
+    int current_checkpoint_segment_ = -1;
+    bool is_recomputing_ = false;
+    int64_t dropped_activations_ = 0;
+    int64_t recomputed_flops_ = 0;
+
+    std::function<void(const std::vector<BaseParam *> &)> complete_grads_callback_;
+    bool bfloat16_compute_ = false;
+
+    bool calculate_batching_stats_ = false;
+    std::map<std::string, BatchingStats> batching_stats_;
+
+    /// The batching statistics of execs, or empty if not collected.
+    std::vector<BatchingStats *> exec_batching_stats_;
 };
 
 }
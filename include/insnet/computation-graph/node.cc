@@ -1,7 +1,11 @@
 #include "insnet/computation-graph/node.h"
 #include "insnet/base/memory.h"
+#include "insnet/util/perf-counters.h"
 #include "insnet/util/profiler.h"
+#include <atomic>
 #include <functional>
+#include <algorithm>
+#include <unordered_set>
 
 using std::string;
 using std::to_string;
@@ -12,6 +16,7 @@ using std::cout;
 using std::endl;
 using std::vector;
 using std::function;
+using std::unordered_set;
 using std::pair;
 using std::make_pair;
 using std::make_shared;
@@ -37,6 +42,7 @@ void NodeAbs::clear() {
     depth_ = 0;
     type_sig_.clear();
     parents_.clear();
+    checkpoint_segment_ = -1;
 }
 
 void NodeAbs::addParent(NodeAbs* parent) {
@@ -62,6 +68,9 @@ void Node::setDim(int dim) {
 
 void Node::clear() {
     val_.ref_count_ = 1;
+    val_.clearViewPlan();
+    grad_.clearViewPlan();
+    view_src_ = nullptr;
     batched_node_ = this;
     column_ = 1;
     input_vals_.clear();
@@ -99,7 +108,7 @@ string Node::isVectorSig() const {
 }
 
 Node::Node(const string &node_type, int dim) : NodeAbs(node_type), dim_(dim) {
-    static int id;
+    static std::atomic<int> id;
     id_ = id++;
 }
 
@@ -110,6 +119,12 @@ void Node::setInputs(const std::vector<Node*> &inputs) {
         abort();
     }
 
+    for (int i = 0; i < inputs.size(); ++i) {
+        if (!isStridedInputSupported(i)) {
+            inputs.at(i)->cancelStridedView();
+        }
+    }
+
     int size = inputs.size();
     input_vals_.reserve(size);
     input_grads_.reserve(size);
@@ -127,6 +142,41 @@ void Node::setInputs(const std::vector<Node*> &inputs) {
     }
 }
 
+bool Node::isPlannableAsView() const {
+    return !val_.isInitialized() && !val_.isPlannedAsView() && !grad_.isPlannedAsView() &&
+        batched_node_->getDegree() >= 0;
+}
+
+bool Node::planAsViewOf(Node &src, int offset, int row, int stride) {
+#if TEST_CUDA
+    return false;
+#else
+    if (!isPlannableAsView() || src.val_.isPlannedAsStridedView()) {
+        return false;
+    }
+    val_.planAsView(src.val_, src.dim_, offset, row, stride);
+    grad_.planAsView(src.grad_, src.dim_, offset, row, stride);
+    view_src_ = &src;
+    return true;
+#endif
+}
+
+void Node::cancelStridedView() {
+    if (!val_.isPlannedAsStridedView()) {
+        return;
+    }
+    if (val_.isInitialized()) {
+        cerr << fmt::format("Node cancelStridedView - {} is executed before its consumer\n",
+                getNodeType());
+        abort();
+    }
+    val_.clearViewPlan();
+    grad_.clearViewPlan();
+    Node *src = view_src_;
+    view_src_ = nullptr;
+    src->onStridedViewCancelled();
+}
+
 void Node::clearInputVals(bool force) {
     int begin = force ? forwardOnlyInputValSize() : 0;
     int end = force ? inputSize() : forwardOnlyInputValSize();
@@ -135,6 +185,11 @@ void Node::clearInputVals(bool force) {
     }
 }
 
+vector<Tensor1D *> Node::forwardOnlyInputVals() {
+    return vector<Tensor1D *>(input_vals_.begin(),
+            input_vals_.begin() + forwardOnlyInputValSize());
+}
+
 void Node::clearVal(bool force) {
     if (force || isValForwardOnly()) {
         val_.release();
@@ -252,6 +307,52 @@ int UniInputNode::forwardOnlyInputValSize() {
     return isInputValForwardOnly() ? 1 : 0;
 }
 
+namespace {
+
+/// Initialize and zero the grads, except that the planned views are initialized as views after their roots are initialized and zeroed.
+///
+/// The grads are deduplicated over the whole batch, so that a node's grad reachable both directly and as the root of another node's view, or from several consumers, is allocated only once.
+void initAndZeroGradsOrViews(vector<cpu::Tensor1D *> &grads, vector<int> &dims,
+        vector<string> &sigs) {
+    vector<pair<cpu::Tensor1D *, int>> views;
+    vector<cpu::Tensor1D *> unplanned_grads;
+    vector<int> unplanned_dims;
+    vector<string> unplanned_sigs;
+    unordered_set<cpu::Tensor1D *> visited;
+    auto add_unplanned = [&](cpu::Tensor1D &grad, int dim, const string &sig) {
+        if (visited.insert(&grad).second) {
+            unplanned_grads.push_back(&grad);
+            unplanned_dims.push_back(dim);
+            unplanned_sigs.push_back(sig);
+        }
+    };
+
+    for (int i = 0; i < grads.size(); ++i) {
+        cpu::Tensor1D &grad = *grads.at(i);
+        if (grad.isPlannedAsView()) {
+            if (visited.insert(&grad).second) {
+                views.push_back(make_pair(&grad, dims.at(i)));
+            }
+            int root_dim;
+            cpu::Tensor1D &root = grad.plannedViewRoot(root_dim);
+            if (!root.isInitialized()) {
+                add_unplanned(root, root_dim, sigs.at(i));
+            }
+        } else {
+            add_unplanned(grad, dims.at(i), sigs.at(i));
+        }
+    }
+
+    initAndZeroTensors(unplanned_grads, unplanned_dims, unplanned_sigs);
+    for (auto &it : views) {
+        if (!it.first->isInitialized()) {
+            it.first->initAsPlannedView(it.second);
+        }
+    }
+}
+
+}
+
 void initAndZeroGrads(vector<Node *> &nodes) {
     int size = nodes.size();
     vector<cpu::Tensor1D *> grads;
@@ -268,7 +369,7 @@ void initAndZeroGrads(vector<Node *> &nodes) {
         }
     }
 
-    initAndZeroTensors(grads, dims, sigs);
+    initAndZeroGradsOrViews(grads, dims, sigs);
 }
 
 #if USE_GPU
@@ -301,27 +402,81 @@ int Executor::calculateActivations() {
 }
 #endif
 
-void Executor::forwardFully() {
-    Profiler &profiler = Profiler::Ins();
-    profiler.BeginEvent("memory_management");
-
+void Executor::allocateVals(vector<cpu::Tensor1D *> *initialized) {
+    // Vals that are already initialized are views of persistent tensors, e.g., cached encoder keys.
+    // Planned views are initialized after their uninitialized roots, e.g., the results of
+    // concatenations written by their inputs in place, are allocated.
     int size_sum = 0;
+    vector<pair<cpu::Tensor1D *, int>> roots;
+    unordered_set<cpu::Tensor1D *> allocated;
     for (Node *node : batch) {
-        size_sum += node->size();
+        Tensor1D &val = node->val();
+        if (!val.isPlannedAsView() && !val.isInitialized() && allocated.insert(&val).second) {
+            size_sum += node->size();
+        }
+    }
+    for (Node *node : batch) {
+        Tensor1D &val = node->val();
+        if (val.isPlannedAsView()) {
+            int root_dim;
+            cpu::Tensor1D &root = val.plannedViewRoot(root_dim);
+            if (!root.isInitialized() && allocated.insert(&root).second) {
+                roots.push_back(make_pair(&root, root_dim));
+                size_sum += root_dim;
+            }
+        }
+    }
+
+    if (size_sum > 0) {
+        auto memory_container = memoryContainer(size_sum * sizeof(dtype));
+        for (Node *node : batch) {
+            if (!node->val().isPlannedAsView() && !node->val().isInitialized()) {
+                node->val().init(node->size(), memory_container);
+                if (checkpoint_segment >= 0) {
+                    val_owners_.push_back(node);
+                }
+                if (initialized != nullptr) {
+                    initialized->push_back(&node->val());
+                }
+            }
+        }
+        for (auto &it : roots) {
+            it.first->init(it.second, memory_container);
+            if (initialized != nullptr) {
+                initialized->push_back(it.first);
+            }
+        }
     }
-    
-    auto memory_container = memoryContainer(size_sum * sizeof(dtype));
 
     for (Node *node : batch) {
-        node->val().init(node->size(), memory_container);
+        if (node->val().isPlannedAsView() && !node->val().isInitialized()) {
+            node->val().initAsPlannedView(node->size());
+            if (initialized != nullptr) {
+                initialized->push_back(&node->val());
+            }
+        }
     }
+}
+
+void Executor::forwardFully() {
+    static const int memory_management = Profiler::eventId("memory_management");
+    MemoryScope scope(MemoryCategory::ACTIVATION_MEMORY, &getNodeType());
+    Profiler &profiler = Profiler::Ins();
+    profiler.BeginEvent(memory_management);
+    allocateVals(nullptr);
     profiler.EndEvent();
 
-    profiler.BeginEvent(getNodeType() + "-forward");
+    PerfCounters &counters = PerfCounters::Ins();
+    if (profiler.isEnabled() || counters.isEnabled()) {
+        string event = getNodeType() + "-forward";
+        profiler.BeginEvent(event);
+        counters.begin(event);
+    }
     forward();
+    counters.end();
     profiler.EndCudaEvent();
 
-    profiler.BeginEvent("memory_management");
+    profiler.BeginEvent(memory_management);
     for (NodeAbs *node : topo_nodes) {
         node->setDegree(-1);
     }
@@ -330,14 +485,18 @@ void Executor::forwardFully() {
         if (!node->topologicalNode().getParents().empty()) {
             node->clearVal(false);
         }
-        node->clearInputVals(false);
+        if (checkpoint_segment < 0) {
+            node->clearInputVals(false);
+        }
     }
     profiler.EndEvent();
 }
 
 void Executor::backwardFully() {
+    static const int memory_management = Profiler::eventId("memory_management");
+    MemoryScope scope(MemoryCategory::GRADIENT_MEMORY, &getNodeType());
     Profiler &profiler = Profiler::Ins();
-    profiler.BeginEvent("memory_management");
+    profiler.BeginEvent(memory_management);
     int size = 0;
     for (Node *node : batch) {
         size += node->inputSize();
@@ -362,21 +521,38 @@ void Executor::backwardFully() {
     }
 
     profiler.EndEvent();
-    initAndZeroTensors(grads, dims, sigs);
+    initAndZeroGradsOrViews(grads, dims, sigs);
 
-    profiler.BeginEvent(getNodeType() + "-backward");
+    PerfCounters &counters = PerfCounters::Ins();
+    if (profiler.isEnabled() || counters.isEnabled()) {
+        string event = getNodeType() + "-backward";
+        profiler.BeginEvent(event);
+        counters.begin(event);
+    }
     backward();
+    counters.end();
     profiler.EndCudaEvent();
 
-    profiler.BeginEvent("memory_management");
+    profiler.BeginEvent(memory_management);
     for (Node *node : batch) {
         node->clearVal(true);
+        if (checkpoint_segment >= 0) {
+            node->clearInputVals(false);
+        }
         node->clearInputVals(true);
         node->clearGrad();
     }
     profiler.EndEvent();
 }
 
+int64_t Executor::recompute(vector<cpu::Tensor1D *> &initialized, bool calculate_flops) {
+    MemoryScope scope(MemoryCategory::ACTIVATION_MEMORY, &getNodeType());
+    val_owners_.clear();
+    allocateVals(&initialized);
+    forward();
+    return calculate_flops ? calculateFLOPs() : 0;
+}
+
 void Executor::backward() {
     for (NodeAbs *node : batch) {
         Node *x = dynamic_cast<Node *>(node);
@@ -391,11 +567,28 @@ void Executor::forward() {
     }
 }
 
-int Executor::defaultFLOPs() {
-    int sum = 0;
-    for (NodeAbs *node : batch) {
-        Node *x = dynamic_cast<Node *>(node);
-        sum += x->size();
+int64_t Executor::calculateFLOPs() {
+    return elementCount();
+}
+
+int64_t Executor::calculateBytes() {
+    return (inputElementCount() + elementCount()) * sizeof(dtype);
+}
+
+int64_t Executor::elementCount() {
+    int64_t sum = 0;
+    for (Node *node : batch) {
+        sum += node->size();
+    }
+    return sum;
+}
+
+int64_t Executor::inputElementCount() {
+    int64_t sum = 0;
+    for (Node *node : batch) {
+        for (int dim : node->input_dims_) {
+            sum += dim;
+        }
     }
     return sum;
 }
@@ -31,6 +31,21 @@ public:
         return model_stage_;
     }
 
+    /// Returns whether the executors are recomputing dropped vals, in which case the nodes should reproduce the vals of the first forward, e.g., dropout should reuse its mask.
+    virtual bool isRecomputing() const {
+        return false;
+    }
+
+    /// Returns whether the nodes are executed as soon as they are added, i.e., before their consumers are known.
+    virtual bool isEager() const {
+        return false;
+    }
+
+    /// Returns whether the operators should take the bfloat16 compute path, reading the bfloat16 copies of the params' values if they have. See BaseParam::setBFloat16Compute.
+    virtual bool isBFloat16Compute() const {
+        return false;
+    }
+
 private:
     ModelStage model_stage_;
 };
@@ -38,6 +53,7 @@ private:
 std::string addressToString(const void* p);
 
 class Node;
+class BaseParam;
 
 class NodeAbs {
 public:
@@ -97,6 +113,15 @@ public:
         return *node_container_;
     }
 
+    /// Returns the checkpoint segment ID assigned by Graph, or -1 if the node is not in any.
+    int getCheckpointSegment() const {
+        return checkpoint_segment_;
+    }
+
+    void setCheckpointSegment(int segment) {
+        checkpoint_segment_ = segment;
+    }
+
 private:
     std::string node_type_;
     int degree_ = 0;
@@ -104,6 +129,7 @@ private:
     std::vector<NodeAbs *> parents_;
     mutable std::string type_sig_;
     NodeContainer *node_container_ = nullptr;
+    int checkpoint_segment_ = -1;
 };
 
 #if USE_GPU
@@ -121,6 +147,11 @@ public:
 
     virtual std::string typeSignature() const override;
 
+    /// Returns the params whose grads the node accumulates in backward.
+    ///
+    /// It is pure virtual so that every node type states its params, returning {} if it has none, for a missed param would be reported complete too early, e.g., to the data-parallel all-reduce.
+    virtual std::vector<BaseParam *> params() = 0;
+
     const Tensor1D &getVal() const {
         return val_;
     }
@@ -193,6 +224,9 @@ public:
 
     void clearInputVals(bool force);
 
+    /// Returns the input vals that backward does not read, which are released after forward unless the executor is checkpointed.
+    std::vector<Tensor1D *> forwardOnlyInputVals();
+
     void clearVal(bool force);
 
     void clearGrad();
@@ -213,6 +247,30 @@ public:
         return input_ids_;
     }
 
+    /// Whether the val and grad can be planned as views of another node's, i.e., they are neither initialized nor planned and the node has not been executed.
+    bool isPlannableAsView() const;
+
+    /// Plan the val and grad as views of src's beginning at *offset*, so that they will share memory with src's instead of being allocated. A strided view will be planned if *stride* is not 0.
+    ///
+    /// It is not planned when testing CUDA, for the CPU tensors of a GPU view are copies.
+    /// \return Whether it is planned.
+    bool planAsViewOf(Node &src, int offset, int row = 0, int stride = 0);
+
+    /// Whether the operator reads the *i*th input's val and writes its grad through their stride, so that they may be strided views. Only the matmul-family operators do.
+    virtual bool isStridedInputSupported(int i) const {
+        return false;
+    }
+
+    /// Whether the operator writes the val and reads the grad through their stride, so that they may be planned as strided views of its consumer's, e.g., concat's.
+    virtual bool isStridedValSupported() const {
+        return false;
+    }
+
+    /// Cancel the planned strided view of the val and grad, if any, so that they will be allocated and the node they were planned to view will copy instead.
+    ///
+    /// Strided views are planned before all the consumers are known, so Node::setInputs calls it on the inputs which the operator reads regardless of the stride.
+    void cancelStridedView();
+
 protected:
     void afterConnect(const std::vector<Node*> &ins);
 
@@ -224,6 +282,9 @@ protected:
 
     virtual bool isValForwardOnly() const = 0;
 
+    /// Called on the node whose val a strided view planned by planAsViewOf referred to, when the view is cancelled, so that the node copies instead of being aliased, e.g., concat cancels the views of its other inputs.
+    virtual void onStridedViewCancelled() {}
+
     virtual int forwardOnlyInputValSize() = 0;
 
     std::vector<Tensor1D *> input_vals_;
@@ -240,6 +301,8 @@ private:
     NodeAbs *batched_node_;
     bool is_pooled_ = true;
     int id_ = 0;
+    /// The node which the val is planned as a view of, or nullptr if it is not planned.
+    Node *view_src_ = nullptr;
 
     friend class Executor;
 };
@@ -334,8 +397,9 @@ protected:
 };
 
 
+/// Returns the node pools of the current thread. The pools are thread-local, so that graphs can be built and run on multiple threads, e.g., by hogwild, as long as each graph is used only on the thread that built it.
 inline std::map<std::vector<Node *> *, int *> &globalPoolReferences() {
-    static std::map<std::vector<Node *> *, int *> o;
+    static thread_local std::map<std::vector<Node *> *, int *> o;
     return o;
 }
 
@@ -443,14 +507,14 @@ public:
     virtual void setNodeDim(int dim) = 0;
 
 private:
-    static std::vector<Node *> pool_;
-    static int used_count_;
+    static thread_local std::vector<Node *> pool_;
+    static thread_local int used_count_;
 };
 
 template<typename T>
-std::vector<Node *> Poolable<T>::pool_;
+thread_local std::vector<Node *> Poolable<T>::pool_;
 template<typename T>
-int Poolable<T>::used_count_ = 0;
+thread_local int Poolable<T>::used_count_ = 0;
 
 void validateEqualNodeDims(const std::vector<Node *> &nodes);
 
@@ -505,6 +569,9 @@ class Executor {
 public:
     std::vector<Node *> batch;
     std::vector<NodeAbs *> topo_nodes;
+
+    /// The checkpoint segment ID of all the nodes, or -1 if the executor is not checkpointed. The input vals of a checkpointed executor are kept until backward so that it can be recomputed.
+    int checkpoint_segment = -1;
     virtual ~Executor() = default;
 
 #if USE_GPU
@@ -512,11 +579,15 @@ public:
 
     std::vector<dtype *> getGrads();
 #else
-    virtual int calculateFLOPs() = 0;
-
     virtual int calculateActivations();
 #endif
 
+    /// Returns the FLOPs of the batch's forward pass. *By default, it is the number of the vals' elements, as for the element-wise operators.*
+    virtual int64_t calculateFLOPs();
+
+    /// Returns the bytes of the input vals, params and vals that the batch's forward pass reads or writes, which with the FLOPs give the arithmetic intensity. *By default, it is the size of the input vals and the vals.*
+    virtual int64_t calculateBytes();
+
     int size() const {
         return dynamic_cast<Node *>(batch.back())->size();
     }
@@ -530,6 +601,11 @@ public:
         return batch.front()->getNodeType();
     }
 
+    /// Returns the params whose grads the executor accumulates in backward, which are shared by the batch since they are parts of the type signatures.
+    std::vector<BaseParam *> params() {
+        return batch.front()->params();
+    }
+
     std::string getSignature() const {
         return batch.front()->typeSignature();
     }
@@ -544,10 +620,32 @@ public:
 
     virtual void backward();
 
+    /// Returns the nodes whose vals are allocated by forwardFully rather than being views, which are recorded only for checkpointed executors.
+    const std::vector<Node *> &valOwners() const {
+        return val_owners_;
+    }
+
+    /// Release the states that forward keeps for backward, e.g., the copies of the input vals, which are restored by recompute. It is called when the executor's checkpoint segment is dropped.
+    ///
+    /// \return The number of the elements released.
+    virtual int64_t releaseForwardStates() {
+        return 0;
+    }
+
+    /// Recompute the vals of the batch and the states released by releaseForwardStates by executing forward again, which allocates the uninitialized vals and planned views and appends them to *initialized*.
+    ///
+    /// \param calculate_flops Whether to calculate the FLOPs of the recomputation.
+    /// \return The FLOPs of the recomputation, or 0 if not calculated.
+    int64_t recompute(std::vector<cpu::Tensor1D *> &initialized, bool calculate_flops);
+
 protected:
     virtual void forward();
 
-    int defaultFLOPs();
+    /// Returns the number of the vals' elements of the batch.
+    int64_t elementCount();
+
+    /// Returns the number of the input vals' elements of the batch.
+    int64_t inputElementCount();
 
 #if TEST_CUDA
     void testForward();
@@ -562,6 +660,12 @@ protected:
 
     void testBeforeBackward();
 #endif
+
+private:
+    /// Allocate the uninitialized vals and the roots of the planned views, appending the allocated vals to *initialized* if it is not null.
+    void allocateVals(std::vector<cpu::Tensor1D *> *initialized);
+
+    std::vector<Node *> val_owners_;
 };
 
 }
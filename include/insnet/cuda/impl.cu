@@ -218,6 +218,51 @@ void Tensor1D::init(int dim, const shared_ptr<MemoryContainer> &container) {
 #endif
 }
 
+void Tensor1D::initAsView(const cpu::Tensor1D &src, int offset, int dim) {
+    const Tensor1D &gpu_src = dynamic_cast<const Tensor1D &>(src);
+    if (value != nullptr) {
+        cerr << "Tensor1D::initAsView value is not null" << endl;
+        abort();
+    }
+    if (gpu_src.memory_container_ == nullptr || offset + dim > gpu_src.dim) {
+        cerr << format("Tensor1D::initAsView - src dim:{} offset:{} dim:{}\n", gpu_src.dim,
+                offset, dim);
+        abort();
+    }
+    value = gpu_src.value + offset;
+    memory_container_ = gpu_src.memory_container_;
+    this->dim = dim;
+#if TEST_CUDA
+    v = new dtype[dim];
+    memcpy(v, gpu_src.v + offset, dim * sizeof(dtype));
+#endif
+}
+
+void Tensor1D::initAsStridedView(const cpu::Tensor1D &src, int offset, int row, int col,
+        int stride) {
+    const Tensor1D &gpu_src = dynamic_cast<const Tensor1D &>(src);
+    if (value != nullptr) {
+        cerr << "Tensor1D::initAsStridedView value is not null" << endl;
+        abort();
+    }
+    if (gpu_src.memory_container_ == nullptr || row > stride ||
+            offset + (col - 1) * stride + row > gpu_src.dim) {
+        cerr << format("Tensor1D::initAsStridedView - src dim:{} offset:{} row:{} col:{} stride:{}\n",
+                gpu_src.dim, offset, row, col, stride);
+        abort();
+    }
+    value = gpu_src.value + offset;
+    memory_container_ = gpu_src.memory_container_;
+    this->dim = row * col;
+    this->stride = stride;
+#if TEST_CUDA
+    v = new dtype[dim];
+    for (int i = 0; i < col; ++i) {
+        memcpy(v + i * row, gpu_src.v + offset + i * stride, row * sizeof(dtype));
+    }
+#endif
+}
+
 void Tensor1D::initOnMemoryAndDevice(int dim) {
     initOnDevice(dim);
     if (v != nullptr) {
@@ -274,6 +319,7 @@ void Tensor1D::releaseMemory() {
         }
         value = nullptr;
     }
+    stride = 0;
 }
 
 void Tensor1D::print() const {
@@ -362,6 +408,11 @@ Tensor2D::Tensor2D(const Tensor2D &t) {
 }
 
 Tensor2D::~Tensor2D() {
+    if (isView()) {
+        value = nullptr;
+        v = nullptr;
+        return;
+    }
     if (value != nullptr) {
         MemoryPool::Ins().Free(value);
     }
@@ -371,6 +422,15 @@ Tensor2D::~Tensor2D() {
     }
 }
 
+void Tensor2D::initAsView(const shared_ptr<cpu::Tensor2D> &src, int offset, int row, int col) {
+    const Tensor2D &gpu_src = dynamic_cast<const Tensor2D &>(*src);
+    if (value != nullptr && !isView()) {
+        MemoryPool::Ins().Free(value);
+    }
+    cpu::Tensor2D::initAsView(src, offset, row, col);
+    value = gpu_src.value + offset;
+}
+
 void Tensor2D::print() const {
     cout << "row:" << row << " col:" << col << endl;
     PrintNums(value, size);
@@ -1334,6 +1394,7 @@ void MemoryPool::Malloc(void **p, int size) {
         fit_size <<= 1;
         ++n;
     }
+    static const int split_memory_block = Profiler::eventId("split_memory_block");
     Profiler &profiler = Profiler::Ins();
     cudaError_t status = cudaErrorMemoryAllocation;
     while (status != cudaSuccess) {
@@ -1355,7 +1416,7 @@ void MemoryPool::Malloc(void **p, int size) {
                 MemoryBlock block(*p, fit_size);
                 busy_blocks_.insert(make_pair(*p, block));
             } else {
-                profiler.BeginEvent("split_memory_block");
+                profiler.BeginEvent(split_memory_block);
                 while (higher_power > n) {
                     auto &v = free_blocks_.at(higher_power);
                     MemoryBlock &to_split = v.rbegin()->second;
@@ -1387,6 +1448,7 @@ void MemoryPool::Malloc(void **p, int size) {
         abort();
     }
 #endif
+    MemoryTracker::Ins().recordAllocation(*p, size, true);
 }
 
 pair<MemoryBlock *, MemoryBlock *> lowerAndhigherBlocks(MemoryBlock &a,
@@ -1434,8 +1496,9 @@ MemoryBlock mergeBlocks(MemoryBlock &a, MemoryBlock &b) {
 void returnFreeBlock(MemoryBlock &block, vector<map<void*, MemoryBlock>> &free_blocks,
         int power,
         unordered_map<void*, MemoryBlock> &busy_blocks) {
+    static const int return_free_block = Profiler::eventId("return_free_block");
     Profiler &profiler = Profiler::Ins();
-    profiler.BeginEvent("return_free_block");
+    profiler.BeginEvent(return_free_block);
     MemoryBlock current_block = block;
     for (int i = power; i <= MAX_BLOCK_POWER; ++i) {
         map<void*, MemoryBlock> &v = free_blocks.at(i);
@@ -1456,6 +1519,7 @@ void returnFreeBlock(MemoryBlock &block, vector<map<void*, MemoryBlock>> &free_b
 }
 
 void MemoryPool::Free(void *p) {
+    MemoryTracker::Ins().recordFree(p);
 #if DEVICE_MEMORY
     cudaError_t r = cudaFree(p);
     if (r != cudaSuccess) {
@@ -2096,7 +2160,10 @@ __global__ void KernelMatMul(dtype **a, bool transpose_a, dtype **b, bool transp
         int *ks,
         dtype **vals,
         bool acc,
-        bool use_lower_triangle_mask = false) {
+        bool use_lower_triangle_mask = false,
+        int *a_strides = nullptr,
+        int *b_strides = nullptr,
+        int *v_strides = nullptr) {
     int count_i = blockIdx.x;
     int b_col = b_cols[count_i];
     int b_col_i = blockDim.x * blockIdx.z + threadIdx.x;
@@ -2109,26 +2176,29 @@ __global__ void KernelMatMul(dtype **a, bool transpose_a, dtype **b, bool transp
         return;
     }
 
+    int v_stride = v_strides == nullptr ? a_row : v_strides[count_i];
     if (use_lower_triangle_mask && a_row_i > b_col_i) {
-        int v_offset = a_row * b_col_i + a_row_i;
+        int v_offset = v_stride * b_col_i + a_row_i;
         vals[count_i][v_offset] = -INF;
         return;
     }
 
     int k = ks[count_i];
+    int a_stride = a_strides == nullptr ? (transpose_a ? k : a_row) : a_strides[count_i];
+    int b_stride = b_strides == nullptr ? (transpose_b ? b_col : k) : b_strides[count_i];
 
     dtype sum = 0;
     for (int i = 0; i < k; ++i) {
-        int a_offset = transpose_a ? k * a_row_i + i : a_row * i + a_row_i;
+        int a_offset = transpose_a ? a_stride * a_row_i + i : a_stride * i + a_row_i;
         dtype av = a[count_i][a_offset];
 
-        int b_offset = transpose_b ? b_col * i + b_col_i : k * b_col_i + i;
+        int b_offset = transpose_b ? b_stride * i + b_col_i : b_stride * b_col_i + i;
         dtype bv = b[count_i][b_offset];
 
         sum += av * bv;
     }
 
-    int v_offset = a_row * b_col_i + a_row_i;
+    int v_offset = v_stride * b_col_i + a_row_i;
     if (acc) {
         DeviceAtomicAdd(vals[count_i] + v_offset, sum);
     } else {
@@ -2142,15 +2212,19 @@ void TranMatrixMulMatrixForward(vector<dtype *> &input_a_vals, vector <dtype *>
         vector<int> &a_cols,
         vector<int> &b_cols,
         int row,
+        vector<int> &a_strides,
+        vector<int> &b_strides,
         bool use_lower_triangle_mask,
         vector<dtype *> &vals) {
     NumberPointerArray a_val_arr, b_val_arr, val_arr;
     a_val_arr.init(input_a_vals.data(), count);
     b_val_arr.init(input_b_vals.data(), count);
     val_arr.init(vals.data(), count);
-    IntArray a_col_arr, b_col_arr;
+    IntArray a_col_arr, b_col_arr, a_stride_arr, b_stride_arr;
     a_col_arr.init(a_cols.data(), count);
     b_col_arr.init(b_cols.data(), count);
+    a_stride_arr.init(a_strides.data(), count);
+    b_stride_arr.init(b_strides.data(), count);
     int max_a_col = *max_element(a_cols.begin(), a_cols.end());
     int max_b_col = *max_element(b_cols.begin(), b_cols.end());
 
@@ -2169,7 +2243,7 @@ void TranMatrixMulMatrixForward(vector<dtype *> &input_a_vals, vector <dtype *>
 
     KernelMatMul<<<block_dim, thread_dim>>>(a_val_arr.value, true, b_val_arr.value, false,
             a_col_arr.value, b_col_arr.value, row_arr.value, val_arr.value, false,
-            use_lower_triangle_mask);
+            use_lower_triangle_mask, a_stride_arr.value, b_stride_arr.value);
 
     CheckCudaError();
 }
@@ -2180,6 +2254,8 @@ void TranMatrixMulMatrixBackward(vector<dtype *> &grads, vector<dtype *> &a_vals
         vector<int> &a_cols,
         vector<int> &b_cols,
         int row,
+        vector<int> &a_strides,
+        vector<int> &b_strides,
         vector<dtype *> &a_grads,
         vector<dtype *> &b_grads) {
     NumberPointerArray grad_arr, a_val_arr, b_val_arr, a_grad_arr, b_grad_arr;
@@ -2188,9 +2264,11 @@ void TranMatrixMulMatrixBackward(vector<dtype *> &grads, vector<dtype *> &a_vals
     b_val_arr.init(b_vals.data(), count);
     a_grad_arr.init(a_grads.data(), count);
     b_grad_arr.init(b_grads.data(), count);
-    IntArray a_col_arr, b_col_arr, row_arr;
+    IntArray a_col_arr, b_col_arr, row_arr, a_stride_arr, b_stride_arr;
     a_col_arr.init(a_cols.data(), count);
     b_col_arr.init(b_cols.data(), count);
+    a_stride_arr.init(a_strides.data(), count);
+    b_stride_arr.init(b_strides.data(), count);
 
     vector<int> rows;
     rows.reserve(count);
@@ -2210,15 +2288,308 @@ void TranMatrixMulMatrixBackward(vector<dtype *> &grads, vector<dtype *> &a_vals
         dim3 block_dim(count, block_y, block_z);
 
         KernelMatMul<<<block_dim, thread_dim>>>(b_val_arr.value, false, grad_arr.value, true,
-                row_arr.value, a_col_arr.value, b_col_arr.value, a_grad_arr.value, true);
+                row_arr.value, a_col_arr.value, b_col_arr.value, a_grad_arr.value, true, false,
+                b_stride_arr.value, nullptr, a_stride_arr.value);
         CheckCudaError();
     }
     {
         int block_z = (max_b_col + TPB_SQRT - 1) / TPB_SQRT;
         dim3 block_dim(count, block_y, block_z);
         KernelMatMul<<<block_dim, thread_dim>>>(a_val_arr.value, false, grad_arr.value, false,
-                row_arr.value, b_col_arr.value, a_col_arr.value, b_grad_arr.value, true);
+                row_arr.value, b_col_arr.value, a_col_arr.value, b_grad_arr.value, true, false,
+                a_stride_arr.value, nullptr, b_stride_arr.value);
+
+        CheckCudaError();
+    }
+}
+
+__device__ int DeviceBandedKey(int query_col, int t, int block_size, int left_blocks) {
+    return (query_col / block_size - left_blocks) * block_size + t;
+}
+
+__device__ bool DeviceIsBandedKeyLegal(int key, int query_col, int col,
+        bool use_lower_triangle_mask) {
+    return key >= 0 && key < col && (!use_lower_triangle_mask || key <= query_col);
+}
+
+__global__ void KernelBandedTranMatMul(dtype **k_vals, dtype **q_vals, int *cols, int row,
+        int *k_strides,
+        int *q_strides,
+        int block_size,
+        int left_blocks,
+        int width,
+        bool use_lower_triangle_mask,
+        dtype **vals) {
+    int count_i = blockIdx.x;
+    int col = cols[count_i];
+    int j = blockDim.x * blockIdx.z + threadIdx.x;
+    int t = blockDim.y * blockIdx.y + threadIdx.y;
+    if (j >= col || t >= width) {
+        return;
+    }
+    int key = DeviceBandedKey(j, t, block_size, left_blocks);
+    int v_offset = j * width + t;
+    if (!DeviceIsBandedKeyLegal(key, j, col, use_lower_triangle_mask)) {
+        vals[count_i][v_offset] = -INF;
+        return;
+    }
+    dtype *k = k_vals[count_i] + key * k_strides[count_i];
+    dtype *q = q_vals[count_i] + j * q_strides[count_i];
+    dtype sum = 0;
+    for (int i = 0; i < row; ++i) {
+        sum += k[i] * q[i];
+    }
+    vals[count_i][v_offset] = sum;
+}
+
+__global__ void KernelBandedTranMatMulBackward(dtype **grads, dtype **k_vals, dtype **q_vals,
+        int *cols,
+        int row,
+        int *k_strides,
+        int *q_strides,
+        int block_size,
+        int left_blocks,
+        int width,
+        bool use_lower_triangle_mask,
+        dtype **k_grads,
+        dtype **q_grads) {
+    int count_i = blockIdx.x;
+    int col = cols[count_i];
+    int j = blockDim.x * blockIdx.z + threadIdx.x;
+    int t = blockDim.y * blockIdx.y + threadIdx.y;
+    if (j >= col || t >= width) {
+        return;
+    }
+    int key = DeviceBandedKey(j, t, block_size, left_blocks);
+    if (!DeviceIsBandedKeyLegal(key, j, col, use_lower_triangle_mask)) {
+        return;
+    }
+    dtype g = grads[count_i][j * width + t];
+    int k_offset = key * k_strides[count_i];
+    int q_offset = j * q_strides[count_i];
+    dtype *k = k_vals[count_i] + k_offset;
+    dtype *q = q_vals[count_i] + q_offset;
+    dtype *k_grad = k_grads[count_i] + k_offset;
+    dtype *q_grad = q_grads[count_i] + q_offset;
+    for (int i = 0; i < row; ++i) {
+        DeviceAtomicAdd(k_grad + i, g * q[i]);
+        DeviceAtomicAdd(q_grad + i, g * k[i]);
+    }
+}
+
+void BandedTranMatrixMulMatrixForward(vector<dtype *> &k_vals, vector<dtype *> &q_vals,
+        int count,
+        vector<int> &cols,
+        int row,
+        vector<int> &k_strides,
+        vector<int> &q_strides,
+        int block_size,
+        int left_blocks,
+        int width,
+        bool use_lower_triangle_mask,
+        vector<dtype *> &vals) {
+    NumberPointerArray k_val_arr, q_val_arr, val_arr;
+    k_val_arr.init(k_vals.data(), count);
+    q_val_arr.init(q_vals.data(), count);
+    val_arr.init(vals.data(), count);
+    IntArray col_arr, k_stride_arr, q_stride_arr;
+    col_arr.init(cols.data(), count);
+    k_stride_arr.init(k_strides.data(), count);
+    q_stride_arr.init(q_strides.data(), count);
+    int max_col = *max_element(cols.begin(), cols.end());
+
+    dim3 thread_dim(TPB_SQRT, TPB_SQRT, 1);
+    int block_y = (width + TPB_SQRT - 1) / TPB_SQRT;
+    int block_z = (max_col + TPB_SQRT - 1) / TPB_SQRT;
+    dim3 block_dim(count, block_y, block_z);
+    KernelBandedTranMatMul<<<block_dim, thread_dim>>>(k_val_arr.value, q_val_arr.value,
+            col_arr.value, row, k_stride_arr.value, q_stride_arr.value, block_size, left_blocks, width, use_lower_triangle_mask,
+            val_arr.value);
+    CheckCudaError();
+}
+
+void BandedTranMatrixMulMatrixBackward(vector<dtype *> &grads, vector<dtype *> &k_vals,
+        vector<dtype *> &q_vals,
+        int count,
+        vector<int> &cols,
+        int row,
+        vector<int> &k_strides,
+        vector<int> &q_strides,
+        int block_size,
+        int left_blocks,
+        int width,
+        bool use_lower_triangle_mask,
+        vector<dtype *> &k_grads,
+        vector<dtype *> &q_grads) {
+    NumberPointerArray grad_arr, k_val_arr, q_val_arr, k_grad_arr, q_grad_arr;
+    grad_arr.init(grads.data(), count);
+    k_val_arr.init(k_vals.data(), count);
+    q_val_arr.init(q_vals.data(), count);
+    k_grad_arr.init(k_grads.data(), count);
+    q_grad_arr.init(q_grads.data(), count);
+    IntArray col_arr, k_stride_arr, q_stride_arr;
+    col_arr.init(cols.data(), count);
+    k_stride_arr.init(k_strides.data(), count);
+    q_stride_arr.init(q_strides.data(), count);
+    int max_col = *max_element(cols.begin(), cols.end());
+
+    dim3 thread_dim(TPB_SQRT, TPB_SQRT, 1);
+    int block_y = (width + TPB_SQRT - 1) / TPB_SQRT;
+    int block_z = (max_col + TPB_SQRT - 1) / TPB_SQRT;
+    dim3 block_dim(count, block_y, block_z);
+    KernelBandedTranMatMulBackward<<<block_dim, thread_dim>>>(grad_arr.value, k_val_arr.value,
+            q_val_arr.value, col_arr.value, row, k_stride_arr.value, q_stride_arr.value,
+            block_size, left_blocks, width,
+            use_lower_triangle_mask, k_grad_arr.value, q_grad_arr.value);
+    CheckCudaError();
+}
+
+__global__ void KernelBandedMatMul(dtype **v_vals, dtype **w_vals, int *cols, int row,
+        int *v_strides,
+        int *strides,
+        int block_size,
+        int left_blocks,
+        int width,
+        dtype **vals) {
+    int count_i = blockIdx.x;
+    int col = cols[count_i];
+    int j = blockDim.x * blockIdx.z + threadIdx.x;
+    int r = blockDim.y * blockIdx.y + threadIdx.y;
+    if (j >= col || r >= row) {
+        return;
+    }
+    dtype *w = w_vals[count_i] + j * width;
+    dtype sum = 0;
+    for (int t = 0; t < width; ++t) {
+        int key = DeviceBandedKey(j, t, block_size, left_blocks);
+        if (key >= 0 && key < col) {
+            sum += w[t] * v_vals[count_i][key * v_strides[count_i] + r];
+        }
+    }
+    vals[count_i][j * strides[count_i] + r] = sum;
+}
+
+__global__ void KernelBandedMatMulBackwardForV(dtype **grads, dtype **w_vals, int *cols,
+        int row,
+        int *v_strides,
+        int *strides,
+        int block_size,
+        int left_blocks,
+        int width,
+        dtype **v_grads) {
+    int count_i = blockIdx.x;
+    int col = cols[count_i];
+    int j = blockDim.x * blockIdx.z + threadIdx.x;
+    int r = blockDim.y * blockIdx.y + threadIdx.y;
+    if (j >= col || r >= row) {
+        return;
+    }
+    dtype g = grads[count_i][j * strides[count_i] + r];
+    dtype *w = w_vals[count_i] + j * width;
+    for (int t = 0; t < width; ++t) {
+        int key = DeviceBandedKey(j, t, block_size, left_blocks);
+        if (key >= 0 && key < col) {
+            DeviceAtomicAdd(v_grads[count_i] + key * v_strides[count_i] + r, w[t] * g);
+        }
+    }
+}
+
+__global__ void KernelBandedMatMulBackwardForW(dtype **grads, dtype **v_vals, int *cols,
+        int row,
+        int *v_strides,
+        int *strides,
+        int block_size,
+        int left_blocks,
+        int width,
+        dtype **w_grads) {
+    int count_i = blockIdx.x;
+    int col = cols[count_i];
+    int j = blockDim.x * blockIdx.z + threadIdx.x;
+    int t = blockDim.y * blockIdx.y + threadIdx.y;
+    if (j >= col || t >= width) {
+        return;
+    }
+    int key = DeviceBandedKey(j, t, block_size, left_blocks);
+    if (key < 0 || key >= col) {
+        return;
+    }
+    dtype *g = grads[count_i] + j * strides[count_i];
+    dtype *v = v_vals[count_i] + key * v_strides[count_i];
+    dtype sum = 0;
+    for (int i = 0; i < row; ++i) {
+        sum += g[i] * v[i];
+    }
+    w_grads[count_i][j * width + t] += sum;
+}
+
+void BandedMatrixMulMatrixForward(vector<dtype *> &v_vals, vector<dtype *> &w_vals, int count,
+        vector<int> &cols,
+        int row,
+        vector<int> &v_strides,
+        vector<int> &strides,
+        int block_size,
+        int left_blocks,
+        int width,
+        vector<dtype *> &vals) {
+    NumberPointerArray v_val_arr, w_val_arr, val_arr;
+    v_val_arr.init(v_vals.data(), count);
+    w_val_arr.init(w_vals.data(), count);
+    val_arr.init(vals.data(), count);
+    IntArray col_arr, v_stride_arr, stride_arr;
+    col_arr.init(cols.data(), count);
+    v_stride_arr.init(v_strides.data(), count);
+    stride_arr.init(strides.data(), count);
+    int max_col = *max_element(cols.begin(), cols.end());
+
+    dim3 thread_dim(TPB_SQRT, TPB_SQRT, 1);
+    int block_y = (row + TPB_SQRT - 1) / TPB_SQRT;
+    int block_z = (max_col + TPB_SQRT - 1) / TPB_SQRT;
+    dim3 block_dim(count, block_y, block_z);
+    KernelBandedMatMul<<<block_dim, thread_dim>>>(v_val_arr.value, w_val_arr.value, col_arr.value,
+            row, v_stride_arr.value, stride_arr.value, block_size, left_blocks, width, val_arr.value);
+    CheckCudaError();
+}
+
+void BandedMatrixMulMatrixBackward(vector<dtype *> &grads, vector<dtype *> &v_vals,
+        vector<dtype *> &w_vals,
+        int count,
+        vector<int> &cols,
+        int row,
+        vector<int> &v_strides,
+        vector<int> &strides,
+        int block_size,
+        int left_blocks,
+        int width,
+        vector<dtype *> &v_grads,
+        vector<dtype *> &w_grads) {
+    NumberPointerArray grad_arr, v_val_arr, w_val_arr, v_grad_arr, w_grad_arr;
+    grad_arr.init(grads.data(), count);
+    v_val_arr.init(v_vals.data(), count);
+    w_val_arr.init(w_vals.data(), count);
+    v_grad_arr.init(v_grads.data(), count);
+    w_grad_arr.init(w_grads.data(), count);
+    IntArray col_arr, v_stride_arr, stride_arr;
+    col_arr.init(cols.data(), count);
+    v_stride_arr.init(v_strides.data(), count);
+    stride_arr.init(strides.data(), count);
+    int max_col = *max_element(cols.begin(), cols.end());
 
+    dim3 thread_dim(TPB_SQRT, TPB_SQRT, 1);
+    int block_z = (max_col + TPB_SQRT - 1) / TPB_SQRT;
+    {
+        int block_y = (row + TPB_SQRT - 1) / TPB_SQRT;
+        dim3 block_dim(count, block_y, block_z);
+        KernelBandedMatMulBackwardForV<<<block_dim, thread_dim>>>(grad_arr.value,
+                w_val_arr.value, col_arr.value, row, v_stride_arr.value, stride_arr.value,
+                block_size, left_blocks, width, v_grad_arr.value);
+        CheckCudaError();
+    }
+    {
+        int block_y = (width + TPB_SQRT - 1) / TPB_SQRT;
+        dim3 block_dim(count, block_y, block_z);
+        KernelBandedMatMulBackwardForW<<<block_dim, thread_dim>>>(grad_arr.value,
+                v_val_arr.value, col_arr.value, row, v_stride_arr.value, stride_arr.value,
+                block_size, left_blocks, width, w_grad_arr.value);
         CheckCudaError();
     }
 }
@@ -2226,14 +2597,18 @@ void TranMatrixMulMatrixBackward(vector<dtype *> &grads, vector<dtype *> &a_vals
 void MatrixMulMatrixForward(vector<dtype *> &a, vector<dtype *> &b, int count, vector<int> &ks,
         vector<int> &b_cols,
         int row,
+        vector<int> &a_strides,
+        vector<int> &strides,
         vector<dtype *> &vals) {
     NumberPointerArray a_arr, b_arr, val_arr;
     a_arr.init(a.data(), count);
     b_arr.init(b.data(), count);
     val_arr.init(vals.data(), count);
-    IntArray k_arr, b_col_arr;
+    IntArray k_arr, b_col_arr, a_stride_arr, stride_arr;
     k_arr.init(ks.data(), count);
     b_col_arr.init(b_cols.data(), count);
+    a_stride_arr.init(a_strides.data(), count);
+    stride_arr.init(strides.data(), count);
     int max_b_col = *max_element(b_cols.begin(), b_cols.end());
     int max_k = *max_element(ks.begin(), ks.end());
     dim3 thread_dim(TPB_SQRT, TPB_SQRT, 1);
@@ -2250,7 +2625,8 @@ void MatrixMulMatrixForward(vector<dtype *> &a, vector<dtype *> &b, int count, v
     row_arr.init(rows.data(), count);
 
     KernelMatMul<<<block_dim, thread_dim>>>(a_arr.value, false, b_arr.value, false, row_arr.value,
-            b_col_arr.value, k_arr.value, val_arr.value, false);
+            b_col_arr.value, k_arr.value, val_arr.value, false, false, a_stride_arr.value,
+            nullptr, stride_arr.value);
     CheckCudaError();
 }
 
@@ -2260,6 +2636,8 @@ void MatrixMulMatrixBackward(vector<dtype *> &grads, vector<dtype *> &a_vals,
         vector<int> &ks,
         vector<int> &b_cols,
         int row,
+        vector<int> &a_strides,
+        vector<int> &strides,
         vector<dtype *> &a_grads,
         vector<dtype *> &b_grads) {
     NumberPointerArray grad_arr, a_val_arr, b_val_arr, a_grad_arr, b_grad_arr;
@@ -2269,9 +2647,11 @@ void MatrixMulMatrixBackward(vector<dtype *> &grads, vector<dtype *> &a_vals,
     a_grad_arr.init(a_grads.data(), count);
     b_grad_arr.init(b_grads.data(), count);
 
-    IntArray k_arr, b_col_arr;
+    IntArray k_arr, b_col_arr, a_stride_arr, stride_arr;
     k_arr.init(ks.data(), count);
     b_col_arr.init(b_cols.data(), count);
+    a_stride_arr.init(a_strides.data(), count);
+    stride_arr.init(strides.data(), count);
 
     vector<int> rows;
     rows.reserve(count);
@@ -2290,7 +2670,8 @@ void MatrixMulMatrixBackward(vector<dtype *> &grads, vector<dtype *> &a_vals,
         int block_z = (max_k + TPB_SQRT - 1) / TPB_SQRT;
         dim3 block_dim(count, block_y, block_z);
         KernelMatMul<<<block_dim, thread_dim>>>(grad_arr.value, false, b_val_arr.value, true,
-                row_arr.value, k_arr.value, b_col_arr.value, a_grad_arr.value, true);
+                row_arr.value, k_arr.value, b_col_arr.value, a_grad_arr.value, true, false,
+                stride_arr.value, nullptr, a_stride_arr.value);
 
         CheckCudaError();
     } {
@@ -2298,7 +2679,8 @@ void MatrixMulMatrixBackward(vector<dtype *> &grads, vector<dtype *> &a_vals,
         int block_z = (max_b_col + TPB_SQRT - 1) / TPB_SQRT;
         dim3 block_dim(count, block_y, block_z);
         KernelMatMul<<<block_dim, thread_dim>>>(a_val_arr.value, true, grad_arr.value, false,
-                k_arr.value, b_col_arr.value, row_arr.value, b_grad_arr.value, true);
+                k_arr.value, b_col_arr.value, row_arr.value, b_grad_arr.value, true, false,
+                a_stride_arr.value, stride_arr.value);
 
         CheckCudaError();
     }
@@ -4451,6 +4833,161 @@ void StandardLayerNormBackward(dtype **grads, int count, int row, int *cols, int
     CheckCudaError();
 }
 
+__global__ void KernelAddLayerNormForward(dtype **a_vals, dtype **b_vals, int row, int *cols,
+        int max_col,
+        dtype *g,
+        dtype *bias,
+        dtype **vals,
+        dtype *means,
+        dtype *sds) {
+    __shared__ volatile extern dtype shared_welford[];
+    volatile dtype *shared_n = shared_welford;
+    volatile dtype *shared_mean = shared_welford + blockDim.x;
+    volatile dtype *shared_m2 = shared_welford + 2 * blockDim.x;
+
+    int count_i = blockIdx.x;
+    int col_i = blockIdx.y;
+    if (col_i >= cols[count_i]) {
+        return;
+    }
+    dtype *a = a_vals[count_i] + col_i * row;
+    dtype *b = b_vals[count_i] + col_i * row;
+    dtype *sum = vals[count_i] + (cols[count_i] + col_i) * row;
+
+    dtype n = 0, mean = 0, m2 = 0;
+    for (int i = threadIdx.x; i < row; i += blockDim.x) {
+        dtype x = a[i] + b[i];
+        sum[i] = x;
+        n += 1;
+        dtype delta = x - mean;
+        mean += delta / n;
+        m2 += delta * (x - mean);
+    }
+    shared_n[threadIdx.x] = n;
+    shared_mean[threadIdx.x] = mean;
+    shared_m2[threadIdx.x] = m2;
+    __syncthreads();
+
+    for (int i = (blockDim.x >> 1); i > 0; i >>= 1) {
+        if (threadIdx.x < i) {
+            dtype n_a = shared_n[threadIdx.x];
+            dtype n_b = shared_n[threadIdx.x + i];
+            dtype n_ab = n_a + n_b;
+            if (n_ab > 0) {
+                dtype delta = shared_mean[threadIdx.x + i] - shared_mean[threadIdx.x];
+                shared_mean[threadIdx.x] += delta * n_b / n_ab;
+                shared_m2[threadIdx.x] += shared_m2[threadIdx.x + i] +
+                    delta * delta * n_a * n_b / n_ab;
+                shared_n[threadIdx.x] = n_ab;
+            }
+        }
+        __syncthreads();
+    }
+
+    mean = shared_mean[0];
+    dtype sd = cuda_sqrt(shared_m2[0] / row);
+    if (threadIdx.x == 0) {
+        means[count_i * max_col + col_i] = mean;
+        sds[count_i * max_col + col_i] = sd;
+    }
+
+    dtype *v = vals[count_i] + col_i * row;
+    for (int i = threadIdx.x; i < row; i += blockDim.x) {
+        v[i] = g[i] * (sum[i] - mean) / sd + bias[i];
+    }
+}
+
+void AddLayerNormForward(dtype **a_vals, dtype **b_vals, int count, int row, int *cols,
+        int max_col,
+        dtype *g,
+        dtype *bias,
+        dtype **vals,
+        dtype *means,
+        dtype *sds) {
+    int thread_count = min(NextTwoIntegerPowerNumber(row), TPB);
+    dim3 block_dim(count, max_col, 1);
+    KernelAddLayerNormForward<<<block_dim, thread_count, 3 * thread_count * sizeof(dtype)>>>(
+            a_vals, b_vals, row, cols, max_col, g, bias, vals, means, sds);
+    CheckCudaError();
+}
+
+__global__ void KernelAddLayerNormBackward(dtype **grads, dtype **vals,
+        int row,
+        int *cols,
+        int max_col,
+        dtype *g,
+        dtype *means,
+        dtype *sds,
+        dtype **a_grads,
+        dtype **b_grads,
+        dtype *g_grads,
+        dtype *bias_grads) {
+    __shared__ volatile extern dtype shared_sums[];
+    volatile dtype *shared_grad_sum = shared_sums;
+    volatile dtype *shared_product_sum = shared_sums + blockDim.x;
+
+    int count_i = blockIdx.x;
+    int col_i = blockIdx.y;
+    if (col_i >= cols[count_i]) {
+        return;
+    }
+    int offset = col_i * row;
+    int sum_offset = (cols[count_i] + col_i) * row;
+    dtype *sum = vals[count_i] + sum_offset;
+    dtype *grad = grads[count_i] + offset;
+    dtype *sum_grad = grads[count_i] + sum_offset;
+    dtype mean = means[count_i * max_col + col_i];
+    dtype sd = sds[count_i * max_col + col_i];
+
+    dtype grad_sum = 0, product_sum = 0;
+    for (int i = threadIdx.x; i < row; i += blockDim.x) {
+        dtype x_hat = (sum[i] - mean) / sd;
+        dtype x_hat_grad = grad[i] * g[i];
+        grad_sum += x_hat_grad;
+        product_sum += x_hat_grad * x_hat;
+        DeviceAtomicAdd(g_grads + i, grad[i] * x_hat);
+        DeviceAtomicAdd(bias_grads + i, grad[i]);
+    }
+    shared_grad_sum[threadIdx.x] = grad_sum;
+    shared_product_sum[threadIdx.x] = product_sum;
+    __syncthreads();
+
+    for (int i = (blockDim.x >> 1); i > 0; i >>= 1) {
+        if (threadIdx.x < i) {
+            shared_grad_sum[threadIdx.x] += shared_grad_sum[threadIdx.x + i];
+            shared_product_sum[threadIdx.x] += shared_product_sum[threadIdx.x + i];
+        }
+        __syncthreads();
+    }
+
+    dtype grad_mean = shared_grad_sum[0] / row;
+    dtype product_mean = shared_product_sum[0] / row;
+    for (int i = threadIdx.x; i < row; i += blockDim.x) {
+        dtype x_hat = (sum[i] - mean) / sd;
+        dtype x = (grad[i] * g[i] - grad_mean - x_hat * product_mean) / sd + sum_grad[i];
+        DeviceAtomicAdd(a_grads[count_i] + offset + i, x);
+        DeviceAtomicAdd(b_grads[count_i] + offset + i, x);
+    }
+}
+
+void AddLayerNormBackward(dtype **grads, dtype **vals, int count, int row,
+        int *cols,
+        int max_col,
+        dtype *g,
+        dtype *means,
+        dtype *sds,
+        dtype **a_grads,
+        dtype **b_grads,
+        dtype *g_grads,
+        dtype *bias_grads) {
+    int thread_count = min(NextTwoIntegerPowerNumber(row), TPB);
+    dim3 block_dim(count, max_col, 1);
+    KernelAddLayerNormBackward<<<block_dim, thread_count, 2 * thread_count * sizeof(dtype)>>>(
+            grads, vals, row, cols, max_col, g, means, sds, a_grads, b_grads, g_grads,
+            bias_grads);
+    CheckCudaError();
+}
+
 __global__ void KernelPointwiseLinearForward(dtype **in_vals, int count, int row, int *cols,
         int max_col,
         dtype *g,
@@ -4691,81 +5228,6 @@ dtype SquareSum(dtype *v, int len) {
     return result.v;
 }
 
-__global__ void KernelSquareSum(dtype *v, bool *indexers,
-        int count,
-        int dim,
-        volatile dtype *global_sum,
-        int *block_counter,
-        dtype *result) {
-    __shared__ volatile dtype shared_sum[TPB];
-    __shared__ volatile bool is_last_block;
-    int index = DeviceDefaultIndex();
-    if (index == 0) {
-        *block_counter = 0;
-    }
-    if (threadIdx.x == 0) {
-        global_sum[blockIdx.x] = 0.0f;
-        is_last_block = false;
-    }
-    int count_i = index / dim;
-    if (index < count * dim && indexers[count_i]) {
-        shared_sum[threadIdx.x] = v[index] * v[index];
-    } else {
-        shared_sum[threadIdx.x] = 0.0f;
-    }
-    __syncthreads();
-    for (int i = (blockDim.x >> 1); i > 0; i >>= 1) {
-        if (threadIdx.x < i) {
-            shared_sum[threadIdx.x] += shared_sum[threadIdx.x + i];
-        }
-        __syncthreads();
-    }
-
-    if (threadIdx.x == 0) {
-        global_sum[blockIdx.x] = shared_sum[0];
-        if (atomicAdd(block_counter, 1) == gridDim.x - 1) {
-            is_last_block = true;
-        }
-    }
-    __syncthreads();
-
-    if (is_last_block) {
-        float sum = 0.0f;
-        for (int i = threadIdx.x; i < gridDim.x; i += blockDim.x) {
-            sum += global_sum[i];
-        }
-
-        shared_sum[threadIdx.x] = sum;
-        __syncthreads();
-
-        for (int i = (blockDim.x >> 1); i > 0; i >>= 1) {
-            if (threadIdx.x < i) {
-                shared_sum[threadIdx.x] += shared_sum[threadIdx.x + i];
-            }
-            __syncthreads();
-        }
-
-        if (threadIdx.x == 0) {
-            *result = shared_sum[0];
-        }
-    }
-}
-
-dtype SquareSum(dtype *v, bool *indexers, int count, int dim) {
-    int block_count = DefaultBlockCountWithoutLimit(count * dim);
-    NumberArray global_sum;
-    global_sum.init(block_count);
-    DeviceInt block_counter;
-    block_counter.init();
-    DeviceNumber result;
-    result.init();
-    KernelSquareSum<<<block_count, TPB>>>(v, indexers,
-            count, dim, global_sum.value, block_counter.value, result.value);
-    CheckCudaError();
-    result.copyFromDeviceToHost();
-    return result.v;
-}
-
 __global__ void KernelRescale(dtype *v, int len, dtype scale) {
     int index = DeviceDefaultIndex();
     int step = DeviceDefaultStep();
@@ -4874,10 +5336,10 @@ void UpdateAdamW(dtype *val, dtype *grad, int row, int col, bool is_bias, dtype
     CheckCudaError();
 }
 
-__global__ void KernelUpdateAdam(dtype *val, dtype *grad, int row, int col,
+__global__ void KernelUpdateSparseAdam(dtype *val, dtype *grad_columns, int row, int *ids,
+        int id_count,
         dtype *aux_mean,
         dtype *aux_square,
-        bool *indexers,
         int *iters,
         dtype belta1,
         dtype belta2,
@@ -4886,51 +5348,43 @@ __global__ void KernelUpdateAdam(dtype *val, dtype *grad, int row, int col,
         dtype eps) {
     int index = DeviceDefaultIndex();
     int step = DeviceDefaultStep();
-    int len = row * col;
+    int len = row * id_count;
     for (int i = index; i < len; i += step) {
-        int count_i = i / row;
-        if (indexers[count_i]) {
-            if (row > 1 && col > 1) {
-                grad[i] += val[i] * reg;
-            }
-            aux_mean[i] = belta1 * aux_mean[i] + (1 - belta1) * grad[i];
-            aux_square[i] = belta2 * aux_square[i] + (1 - belta2) * grad[i] *
-                grad[i];
-            dtype lr_t = alpha * cuda_sqrt(1 - cuda_pow(belta2,
-                        iters[count_i] + 1)) / (1 - cuda_pow(belta1,
-                            iters[count_i] + 1));
-            dtype square_plus_eps = aux_square[i] + eps;
-            val[i] = val[i] - aux_mean[i] * lr_t / cuda_sqrt(square_plus_eps);
-        }
+        int id = ids[i / row];
+        int vi = id * row + i % row;
+        grad_columns[i] += val[vi] * reg;
+        dtype g = grad_columns[i];
+        aux_mean[vi] = belta1 * aux_mean[vi] + (1 - belta1) * g;
+        aux_square[vi] = belta2 * aux_square[vi] + (1 - belta2) * g * g;
+        dtype lr_t = alpha * cuda_sqrt(1 - cuda_pow(belta2, iters[id] + 1)) /
+            (1 - cuda_pow(belta1, iters[id] + 1));
+        val[vi] = val[vi] - aux_mean[vi] * lr_t / cuda_sqrt(aux_square[vi] + eps);
     }
 }
 
-__global__ void KernelSelfPlusIters(bool *indexers, int *iters,
-        int count) {
+__global__ void KernelSelfPlusIters(int *ids, int id_count, int *iters) {
     int index = DeviceDefaultIndex();
     int step = DeviceDefaultStep();
-    for (int i = index; i < count; i += step) {
-        if (indexers[i]) {
-            ++iters[i];
-        }
+    for (int i = index; i < id_count; i += step) {
+        ++iters[ids[i]];
     }
 }
 
-void UpdateAdam(dtype *val, dtype *grad, int row, int col, dtype *aux_mean,
+void UpdateSparseAdam(dtype *val, dtype *grad_columns, int row, int *ids, int id_count,
+        dtype *aux_mean,
         dtype *aux_square,
-        bool *indexers,
         int *iters,
         dtype belta1,
         dtype belta2,
         dtype alpha,
         dtype reg,
         dtype eps) {
-    int block_count = DefaultBlockCount(row * col);
-    KernelUpdateAdam<<<block_count, TPB>>>(val, grad, row, col, aux_mean,
-            aux_square, indexers, iters, belta1, belta2, alpha, reg, eps);
+    int block_count = DefaultBlockCount(row * id_count);
+    KernelUpdateSparseAdam<<<block_count, TPB>>>(val, grad_columns, row, ids, id_count,
+            aux_mean, aux_square, iters, belta1, belta2, alpha, reg, eps);
     CheckCudaError();
-    block_count = DefaultBlockCount(col);
-    KernelSelfPlusIters<<<block_count, TPB>>>(indexers, iters, col);
+    block_count = DefaultBlockCount(id_count);
+    KernelSelfPlusIters<<<block_count, TPB>>>(ids, id_count, iters);
     CheckCudaError();
 }
 
@@ -4962,36 +5416,138 @@ void UpdateAdagrad(dtype *val, dtype *grad, int row, int col,
     CheckCudaError();
 }
 
-__global__ void KernelUpdateAdagrad(dtype *val, dtype *grad, int row, int col,
+__global__ void KernelUpdateSparseAdagrad(dtype *val, dtype *grad_columns, int row, int *ids,
+        int id_count,
         dtype *aux_square,
-        bool *indexers,
         dtype alpha,
         dtype reg,
         dtype eps) {
     int index = DeviceDefaultIndex();
     int step = DeviceDefaultStep();
-    int len = row * col;
+    int len = row * id_count;
     for (int i = index; i < len; i += step) {
-        int count_i = i / col;
-        if (indexers[count_i]) {
-            if (row > 1 && col > 1) {
-                grad[i] += val[i] * reg;
-            }
-            aux_square[i] = aux_square[i] + grad[i] * grad[i];
-            val[i] = val[i] - grad[i] * alpha / cuda_sqrt(aux_square[i] + eps);
-        }
+        int vi = ids[i / row] * row + i % row;
+        grad_columns[i] += val[vi] * reg;
+        dtype g = grad_columns[i];
+        aux_square[vi] = aux_square[vi] + g * g;
+        val[vi] = val[vi] - g * alpha / cuda_sqrt(aux_square[vi] + eps);
     }
 }
 
-void UpdateAdagrad(dtype *val, dtype *grad, int row, int col,
+void UpdateSparseAdagrad(dtype *val, dtype *grad_columns, int row, int *ids, int id_count,
         dtype *aux_square,
-        bool *indexers,
         dtype alpha,
         dtype reg,
         dtype eps) {
-    int block_count = DefaultBlockCount(row * col);
-    KernelUpdateAdagrad<<<block_count, TPB>>>(val, grad, row, col, aux_square,
-            indexers, alpha, reg, eps);
+    int block_count = DefaultBlockCount(row * id_count);
+    KernelUpdateSparseAdagrad<<<block_count, TPB>>>(val, grad_columns, row, ids, id_count,
+            aux_square, alpha, reg, eps);
+    CheckCudaError();
+}
+
+__global__ void KernelUpdateFlatAdam(dtype *val, dtype *grad, int len, int bias_offset,
+        dtype *aux_mean,
+        dtype *aux_square,
+        dtype belta1,
+        dtype belta2,
+        dtype reg,
+        dtype eps,
+        dtype lr_t,
+        dtype grad_scale) {
+    int index = DeviceDefaultIndex();
+    int step = DeviceDefaultStep();
+    for (int i = index; i < len; i += step) {
+        dtype g = grad[i] * grad_scale;
+        if (i < bias_offset) {
+            g += val[i] * reg;
+        }
+        aux_mean[i] = belta1 * aux_mean[i] + (1 - belta1) * g;
+        aux_square[i] = belta2 * aux_square[i] + (1 - belta2) * g * g;
+        val[i] = val[i] - aux_mean[i] * lr_t / cuda_sqrt(aux_square[i] + eps);
+    }
+}
+
+void UpdateFlatAdam(dtype *val, dtype *grad, int len, int bias_offset,
+        dtype *aux_mean,
+        dtype *aux_square,
+        int iter,
+        dtype belta1,
+        dtype belta2,
+        dtype alpha,
+        dtype reg,
+        dtype eps,
+        dtype grad_scale) {
+    int block_count = DefaultBlockCount(len);
+    dtype lr_t = alpha * sqrt(1 - pow(belta2, iter + 1)) / (1 - pow(belta1, iter + 1));
+    KernelUpdateFlatAdam<<<block_count, TPB>>>(val, grad, len, bias_offset, aux_mean,
+            aux_square, belta1, belta2, reg, eps, lr_t, grad_scale);
+    CheckCudaError();
+}
+
+__global__ void KernelUpdateFlatAdamW(dtype *val, dtype *grad, int len, int bias_offset,
+        dtype *aux_mean,
+        dtype *aux_square,
+        dtype belta1,
+        dtype belta2,
+        dtype reg,
+        dtype eps,
+        dtype lr_t,
+        dtype grad_scale) {
+    int index = DeviceDefaultIndex();
+    int step = DeviceDefaultStep();
+    for (int i = index; i < len; i += step) {
+        dtype g = grad[i] * grad_scale;
+        aux_mean[i] = belta1 * aux_mean[i] + (1 - belta1) * g;
+        aux_square[i] = belta2 * aux_square[i] + (1 - belta2) * g * g;
+        val[i] = (1 - (i < bias_offset ? reg : 0.0f)) * val[i] - aux_mean[i] * lr_t /
+            cuda_sqrt(aux_square[i] + eps);
+    }
+}
+
+void UpdateFlatAdamW(dtype *val, dtype *grad, int len, int bias_offset,
+        dtype *aux_mean,
+        dtype *aux_square,
+        int iter,
+        dtype belta1,
+        dtype belta2,
+        dtype alpha,
+        dtype reg,
+        dtype eps,
+        dtype grad_scale) {
+    int block_count = DefaultBlockCount(len);
+    dtype lr_t = alpha * sqrt(1 - pow(belta2, iter + 1)) / (1 - pow(belta1, iter + 1));
+    KernelUpdateFlatAdamW<<<block_count, TPB>>>(val, grad, len, bias_offset, aux_mean,
+            aux_square, belta1, belta2, reg, eps, lr_t, grad_scale);
+    CheckCudaError();
+}
+
+__global__ void KernelUpdateFlatAdagrad(dtype *val, dtype *grad, int len, int bias_offset,
+        dtype *aux_square,
+        dtype alpha,
+        dtype reg,
+        dtype eps,
+        dtype grad_scale) {
+    int index = DeviceDefaultIndex();
+    int step = DeviceDefaultStep();
+    for (int i = index; i < len; i += step) {
+        dtype g = grad[i] * grad_scale;
+        if (i < bias_offset) {
+            g += val[i] * reg;
+        }
+        aux_square[i] = aux_square[i] + g * g;
+        val[i] = val[i] - g * alpha / cuda_sqrt(aux_square[i] + eps);
+    }
+}
+
+void UpdateFlatAdagrad(dtype *val, dtype *grad, int len, int bias_offset,
+        dtype *aux_square,
+        dtype alpha,
+        dtype reg,
+        dtype eps,
+        dtype grad_scale) {
+    int block_count = DefaultBlockCount(len);
+    KernelUpdateFlatAdagrad<<<block_count, TPB>>>(val, grad, len, bias_offset, aux_square,
+            alpha, reg, eps, grad_scale);
     CheckCudaError();
 }
 
@@ -293,6 +293,8 @@ void TranMatrixMulMatrixForward(std::vector<dtype *> &input_a_vals,
         std::vector<int> &a_cols,
         std::vector<int> &b_cols,
         int row,
+        std::vector<int> &a_strides,
+        std::vector<int> &b_strides,
         bool use_lower_triangle_mask,
         std::vector<dtype *> &vals);
 void TranMatrixMulMatrixBackward(std::vector<dtype *> &grads,
@@ -302,6 +304,8 @@ void TranMatrixMulMatrixBackward(std::vector<dtype *> &grads,
         std::vector<int> &a_cols,
         std::vector<int> &b_cols,
         int row,
+        std::vector<int> &a_strides,
+        std::vector<int> &b_strides,
         std::vector<dtype *> &a_grads,
         std::vector<dtype *> &b_grads);
 void MatrixMulMatrixForward(std::vector<dtype *> &a,
@@ -310,6 +314,8 @@ void MatrixMulMatrixForward(std::vector<dtype *> &a,
         std::vector<int> &ks,
         std::vector<int> &b_cols,
         int row,
+        std::vector<int> &a_strides,
+        std::vector<int> &strides,
         std::vector<dtype *> &vals);
 void MatrixMulMatrixBackward(std::vector<dtype *> &grads,
         std::vector<dtype *> &a_vals,
@@ -318,8 +324,60 @@ void MatrixMulMatrixBackward(std::vector<dtype *> &grads,
         std::vector<int> &ks,
         std::vector<int> &b_cols,
         int row,
+        std::vector<int> &a_strides,
+        std::vector<int> &strides,
         std::vector<dtype *> &a_grads,
         std::vector<dtype *> &b_grads);
+void BandedTranMatrixMulMatrixForward(std::vector<dtype *> &k_vals,
+        std::vector<dtype *> &q_vals,
+        int count,
+        std::vector<int> &cols,
+        int row,
+        std::vector<int> &k_strides,
+        std::vector<int> &q_strides,
+        int block_size,
+        int left_blocks,
+        int width,
+        bool use_lower_triangle_mask,
+        std::vector<dtype *> &vals);
+void BandedTranMatrixMulMatrixBackward(std::vector<dtype *> &grads,
+        std::vector<dtype *> &k_vals,
+        std::vector<dtype *> &q_vals,
+        int count,
+        std::vector<int> &cols,
+        int row,
+        std::vector<int> &k_strides,
+        std::vector<int> &q_strides,
+        int block_size,
+        int left_blocks,
+        int width,
+        bool use_lower_triangle_mask,
+        std::vector<dtype *> &k_grads,
+        std::vector<dtype *> &q_grads);
+void BandedMatrixMulMatrixForward(std::vector<dtype *> &v_vals,
+        std::vector<dtype *> &w_vals,
+        int count,
+        std::vector<int> &cols,
+        int row,
+        std::vector<int> &v_strides,
+        std::vector<int> &strides,
+        int block_size,
+        int left_blocks,
+        int width,
+        std::vector<dtype *> &vals);
+void BandedMatrixMulMatrixBackward(std::vector<dtype *> &grads,
+        std::vector<dtype *> &v_vals,
+        std::vector<dtype *> &w_vals,
+        int count,
+        std::vector<int> &cols,
+        int row,
+        std::vector<int> &v_strides,
+        std::vector<int> &strides,
+        int block_size,
+        int left_blocks,
+        int width,
+        std::vector<dtype *> &v_grads,
+        std::vector<dtype *> &w_grads);
 void MatrixAndVectorMultiForward(std::vector<dtype *> &matrices,
         std::vector<dtype *> &vectors,
         int count,
@@ -455,6 +513,23 @@ void StandardLayerNormBackward(dtype **grads, int count, int row, int *cols,
         dtype **vals,
         dtype *sds,
         dtype **in_grads);
+void AddLayerNormForward(dtype **a_vals, dtype **b_vals, int count, int row, int *cols,
+        int max_col,
+        dtype *g,
+        dtype *bias,
+        dtype **vals,
+        dtype *means,
+        dtype *sds);
+void AddLayerNormBackward(dtype **grads, dtype **vals, int count, int row,
+        int *cols,
+        int max_col,
+        dtype *g,
+        dtype *means,
+        dtype *sds,
+        dtype **a_grads,
+        dtype **b_grads,
+        dtype *g_grads,
+        dtype *bias_grads);
 void PointwiseLinearForward(dtype **in_vals, int count, int row, int *cols,
         int max_col, dtype *g,
         dtype *b,
@@ -487,7 +562,6 @@ std::pair<dtype, std::vector<int>> SoftMaxLoss(
         int batchsize,
         std::vector<dtype *> &losses_vector);
 dtype SquareSum(dtype *v, int len);
-dtype SquareSum(dtype *v, bool *indexers, int count, int dim);
 void Rescale(dtype *v, int len, dtype scale);
 void UpdateAdam(dtype *val, dtype *grad, int row, int col, bool is_bias,
         dtype *aux_mean,
@@ -498,10 +572,9 @@ void UpdateAdam(dtype *val, dtype *grad, int row, int col, bool is_bias,
         dtype alpha,
         dtype reg,
         dtype eps);
-void UpdateAdam(dtype *val, dtype *grad, int row, int col,
+void UpdateSparseAdam(dtype *val, dtype *grad_columns, int row, int *ids, int id_count,
         dtype *aux_mean,
         dtype *aux_square,
-        bool *indexers,
         int *iters,
         dtype belta1,
         dtype belta2,
@@ -522,12 +595,37 @@ void UpdateAdagrad(dtype *val, dtype *grad, int row, int col,
         dtype alpha,
         dtype reg,
         dtype eps);
-void UpdateAdagrad(dtype *val, dtype *grad, int row, int col,
+void UpdateSparseAdagrad(dtype *val, dtype *grad_columns, int row, int *ids, int id_count,
         dtype *aux_square,
-        bool *indexers,
         dtype alpha,
         dtype reg,
         dtype eps);
+void UpdateFlatAdam(dtype *val, dtype *grad, int len, int bias_offset,
+        dtype *aux_mean,
+        dtype *aux_square,
+        int iter,
+        dtype belta1,
+        dtype belta2,
+        dtype alpha,
+        dtype reg,
+        dtype eps,
+        dtype grad_scale);
+void UpdateFlatAdamW(dtype *val, dtype *grad, int len, int bias_offset,
+        dtype *aux_mean,
+        dtype *aux_square,
+        int iter,
+        dtype belta1,
+        dtype belta2,
+        dtype alpha,
+        dtype reg,
+        dtype eps,
+        dtype grad_scale);
+void UpdateFlatAdagrad(dtype *val, dtype *grad, int len, int bias_offset,
+        dtype *aux_square,
+        dtype alpha,
+        dtype reg,
+        dtype eps,
+        dtype grad_scale);
 void *GraphHostAlloc();
 
 }
@@ -4,8 +4,11 @@
 #include "insnet/computation-graph/graph.h"
 #include "insnet/computation-graph/node.h"
 #include "insnet/nlp/vocab.h"
+#include "insnet/nlp/embedding-file.h"
+#include "insnet/util/batch-scheduler.h"
 #include "insnet/util/metric.h"
 #include "insnet/util/profiler.h"
+#include "insnet/util/perf-counters.h"
 #include "insnet/util/check-grad.h"
 #include "insnet/operator/add.h"
 #include "insnet/operator/atomic.h"
@@ -24,7 +27,11 @@
 #include "insnet/operator/split.h"
 #include "insnet/operator/sub.h"
 #include "insnet/param/param.h"
+#include "insnet/param/flat-params.h"
 #include "insnet/param/sparse-param.h"
+#include "insnet/param/checkpoint.h"
+#include "insnet/parallel/data-parallel.h"
+#include "insnet/parallel/hogwild.h"
 #include "insnet/optimizer/optimizer.h"
 #include "insnet/optimizer/adam.h"
 #include "insnet/optimizer/adamw.h"
@@ -10,6 +10,22 @@ using std::max_element;
 
 namespace insnet {
 
+int answerCount(const vector<vector<int>> &answers) {
+    int count = 0;
+    for (const auto &a : answers) {
+        count += a.size();
+    }
+    return count;
+}
+
+dtype averageLossFactor(int answer_count) {
+    if (answer_count <= 0) {
+        cerr << fmt::format("averageLossFactor - answer_count:{}\n", answer_count);
+        abort();
+    }
+    return 1.0 / answer_count;
+}
+
 namespace {
 
 vector<vector<int>> cpuPredict(const vector<Node *> &nodes, int row) {
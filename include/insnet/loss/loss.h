@@ -16,6 +16,16 @@ namespace insnet {
 /// \return The result indexes.
 std::vector<std::vector<int>> argmax(const std::vector<Node *> &nodes, int row);
 
+/// \ingroup loss
+/// Returns the number of answers, i.e., the sum of the inner vector sizes.
+int answerCount(const std::vector<std::vector<int>> &answers);
+
+/// \ingroup loss
+/// Returns the loss factor of the average reduction, i.e., 1.0 / answer_count.
+///
+/// When the grads of several micro-batches are accumulated before one step (see Optimizer::setGradAccumulation), pass the answer count of all the micro-batches rather than of each one, so that the accumulated grads and the summed losses are equal to those of the whole batch's average loss, no matter how the answers are distributed among the micro-batches.
+dtype averageLossFactor(int answer_count);
+
 /// \ingroup loss
 /// The negative log likelihood loss.
 ///
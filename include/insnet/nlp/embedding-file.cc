@@ -0,0 +1,330 @@
+#include "insnet/nlp/embedding-file.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include "fmt/core.h"
+
+using std::string;
+using std::vector;
+using std::function;
+using std::thread;
+using std::ifstream;
+using std::ofstream;
+using std::ios;
+using std::cerr;
+using std::cout;
+
+namespace insnet {
+
+namespace {
+
+const char MAGIC[8] = {'I', 'N', 'S', 'E', 'M', 'B', '0', '1'};
+
+struct EmbeddingFileHeader {
+    char magic[8];
+    int64_t size;
+    int32_t dim;
+    int32_t dtype_size;
+    int64_t vecs_offset;
+    int64_t word_offsets_offset;
+    int64_t words_offset;
+    char padding[16];
+};
+
+static_assert(sizeof(EmbeddingFileHeader) == 64, "EmbeddingFileHeader should be 64 bytes");
+
+const size_t READING_BLOCK_SIZE = 1 << 26;
+
+bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+dtype parseNumber(const char *p, char **end) {
+#if USE_FLOAT
+    return strtof(p, end);
+#else
+    return strtod(p, end);
+#endif
+}
+
+/// Returns the number of the space-separated tokens in [begin, end).
+int tokenCount(const char *begin, const char *end) {
+    int count = 0;
+    bool in_token = false;
+    for (const char *p = begin; p < end; ++p) {
+        if (isBlank(*p)) {
+            in_token = false;
+        } else if (!in_token) {
+            in_token = true;
+            ++count;
+        }
+    }
+    return count;
+}
+
+struct ParsedLines {
+    vector<string> words;
+    vector<dtype> vecs;
+    int skipped_count = 0;
+};
+
+/// Parse the lines in [begin, end), where *end should point to '\n' or '\0' so that strtof stops there.
+void parseLines(const char *begin, const char *end, int dim, ParsedLines &result) {
+    const char *p = begin;
+    while (p < end) {
+        const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+        if (eol == nullptr) {
+            eol = end;
+        }
+        while (p < eol && isBlank(*p)) {
+            ++p;
+        }
+        const char *word_end = p;
+        while (word_end < eol && !isBlank(*word_end)) {
+            ++word_end;
+        }
+        if (word_end > p) {
+            size_t vec_begin = result.vecs.size();
+            result.vecs.resize(vec_begin + dim);
+            dtype *vec = result.vecs.data() + vec_begin;
+            const char *q = word_end;
+            int i = 0;
+            for (; i < dim; ++i) {
+                char *number_end;
+                vec[i] = parseNumber(q, &number_end);
+                if (number_end == q || number_end > eol) {
+                    break;
+                }
+                q = number_end;
+            }
+            while (q < eol && isBlank(*q)) {
+                ++q;
+            }
+            if (i == dim && q == eol) {
+                result.words.emplace_back(p, word_end);
+            } else {
+                result.vecs.resize(vec_begin);
+                ++result.skipped_count;
+            }
+        }
+        p = eol + 1;
+    }
+}
+
+/// Returns the beginning of the first data line in [begin, end), skipping the header line of the word count and the dimension if any, or nullptr if there is no nonblank line.
+const char *firstDataLine(const char *begin, const char *end, int dim) {
+    const char *p = begin;
+    while (p < end) {
+        const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+        if (eol == nullptr) {
+            eol = end;
+        }
+        int count = tokenCount(p, eol);
+        if (count > 0) {
+            return count == 2 && dim != 1 ? eol + 1 : p;
+        }
+        p = eol + 1;
+    }
+    return nullptr;
+}
+
+}
+
+int textEmbeddingDim(const string &path) {
+    ifstream inf(path);
+    if (!inf.is_open()) {
+        cerr << fmt::format("textEmbeddingDim - failed to open {}\n", path);
+        abort();
+    }
+    string line;
+    for (int i = 0; i < 2 && getline(inf, line); ) {
+        int count = tokenCount(line.data(), line.data() + line.size());
+        if (count == 0) {
+            continue;
+        }
+        if (!(i == 0 && count == 2)) {
+            return count - 1;
+        }
+        ++i;
+    }
+    cerr << fmt::format("textEmbeddingDim - no vector in {}\n", path);
+    abort();
+}
+
+int readTextEmbeddingFile(const string &path,
+        const function<void(const string &word, const dtype *vec)> &f, int thread_count) {
+    if (thread_count <= 0) {
+        thread_count = std::max<int>(thread::hardware_concurrency(), 1);
+    }
+    ifstream inf(path, ios::binary);
+    if (!inf.is_open()) {
+        cerr << fmt::format("readTextEmbeddingFile - failed to open {}\n", path);
+        abort();
+    }
+
+    int dim = textEmbeddingDim(path);
+    bool header_checked = false;
+    int skipped_count = 0;
+    vector<char> buf;
+    string carry;
+    bool eof = false;
+    while (!eof) {
+        buf.assign(carry.begin(), carry.end());
+        size_t carry_size = buf.size();
+        buf.resize(carry_size + READING_BLOCK_SIZE);
+        inf.read(buf.data() + carry_size, READING_BLOCK_SIZE);
+        size_t len = carry_size + inf.gcount();
+        eof = inf.gcount() < READING_BLOCK_SIZE;
+        size_t parsed_len = len;
+        if (!eof) {
+            const char *last_newline = static_cast<const char *>(memrchr(buf.data(), '\n', len));
+            if (last_newline == nullptr) {
+                carry.assign(buf.data(), len);
+                continue;
+            }
+            parsed_len = last_newline - buf.data() + 1;
+        }
+        carry.assign(buf.data() + parsed_len, len - parsed_len);
+        buf.resize(parsed_len);
+        buf.push_back('\0');
+
+        const char *begin = buf.data();
+        const char *end = buf.data() + parsed_len;
+        if (!header_checked) {
+            begin = firstDataLine(begin, end, dim);
+            if (begin == nullptr) {
+                continue;
+            }
+            begin = std::min(begin, end);
+            header_checked = true;
+        }
+
+        vector<const char *> bounds = {begin};
+        for (int i = 1; i < thread_count; ++i) {
+            const char *p = std::max(begin + (end - begin) * i / thread_count, bounds.back());
+            const char *newline = static_cast<const char *>(memchr(p, '\n', end - p));
+            bounds.push_back(newline == nullptr ? end : newline + 1);
+        }
+        bounds.push_back(end);
+        vector<ParsedLines> parsed(thread_count);
+        vector<thread> threads;
+        for (int i = 1; i < thread_count; ++i) {
+            threads.emplace_back(parseLines, bounds.at(i), bounds.at(i + 1), dim,
+                    std::ref(parsed.at(i)));
+        }
+        parseLines(bounds.at(0), bounds.at(1), dim, parsed.front());
+        for (thread &t : threads) {
+            t.join();
+        }
+
+        for (const ParsedLines &lines : parsed) {
+            for (int i = 0; i < lines.words.size(); ++i) {
+                f(lines.words.at(i), lines.vecs.data() + static_cast<size_t>(i) * dim);
+            }
+            skipped_count += lines.skipped_count;
+        }
+    }
+
+    if (skipped_count > 0) {
+        cerr << fmt::format("readTextEmbeddingFile - skipped {} lines not of dim {}\n",
+                skipped_count, dim);
+    }
+    return dim;
+}
+
+void convertTextEmbeddingFile(const string &text_path, const string &binary_path,
+        int thread_count) {
+    ofstream outf(binary_path, ios::binary);
+    if (!outf.is_open()) {
+        cerr << fmt::format("convertTextEmbeddingFile - failed to open {}\n", binary_path);
+        abort();
+    }
+    EmbeddingFileHeader header;
+    memset(&header, 0, sizeof(header));
+    outf.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    int dim = textEmbeddingDim(text_path);
+    vector<int64_t> word_offsets = {0};
+    string words;
+    readTextEmbeddingFile(text_path, [&](const string &word, const dtype *vec) {
+        outf.write(reinterpret_cast<const char *>(vec), sizeof(dtype) * dim);
+        words += word;
+        word_offsets.push_back(words.size());
+    }, thread_count);
+
+    int64_t pos = sizeof(header) + (word_offsets.size() - 1) * dim * sizeof(dtype);
+    int64_t padding = (sizeof(int64_t) - pos % sizeof(int64_t)) % sizeof(int64_t);
+    outf.write(header.padding, padding);
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.size = word_offsets.size() - 1;
+    header.dim = dim;
+    header.dtype_size = sizeof(dtype);
+    header.vecs_offset = sizeof(header);
+    header.word_offsets_offset = pos + padding;
+    header.words_offset = header.word_offsets_offset + word_offsets.size() * sizeof(int64_t);
+    outf.write(reinterpret_cast<const char *>(word_offsets.data()),
+            word_offsets.size() * sizeof(int64_t));
+    outf.write(words.data(), words.size());
+    outf.seekp(0);
+    outf.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    if (!outf.good()) {
+        cerr << fmt::format("convertTextEmbeddingFile - failed to write {}\n", binary_path);
+        abort();
+    }
+    cout << fmt::format("convertTextEmbeddingFile - {} words of dim {}\n", header.size, dim);
+}
+
+EmbeddingFile::EmbeddingFile(const string &path) : file_(path) {
+    if (file_.size() < sizeof(EmbeddingFileHeader)) {
+        cerr << fmt::format("EmbeddingFile - {} is too short\n", path);
+        abort();
+    }
+    const char *base = file_.data();
+    const EmbeddingFileHeader &header = *reinterpret_cast<const EmbeddingFileHeader *>(base);
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.dtype_size != sizeof(dtype)) {
+        cerr << fmt::format("EmbeddingFile - {} is not a valid embedding file of dtype size {}\n",
+                path, sizeof(dtype));
+        abort();
+    }
+    int64_t file_size = file_.size();
+    if (header.size <= 0 || header.dim <= 0 ||
+            header.size > (file_size / header.dim) / static_cast<int64_t>(sizeof(dtype)) ||
+            !sectionFits(header.vecs_offset, header.size * header.dim * sizeof(dtype), file_size,
+                sizeof(header), alignof(dtype)) ||
+            !sectionFits(header.word_offsets_offset, (header.size + 1) * sizeof(int64_t),
+                file_size, sizeof(header), alignof(int64_t)) ||
+            !sectionFits(header.words_offset, 0, file_size, sizeof(header), 1)) {
+        cerr << fmt::format("EmbeddingFile - {} has {} words of dim {} not fitting in {} bytes\n",
+                path, header.size, header.dim, file_size);
+        abort();
+    }
+    const int64_t *word_offsets = reinterpret_cast<const int64_t *>(base +
+            header.word_offsets_offset);
+    if (!areOffsetsValid(word_offsets, header.size, file_size - header.words_offset)) {
+        cerr << fmt::format("EmbeddingFile - {} has word offsets not delimiting its words\n",
+                path);
+        abort();
+    }
+    size_ = header.size;
+    dim_ = header.dim;
+    vecs_ = reinterpret_cast<const dtype *>(base + header.vecs_offset);
+    word_offsets_ = reinterpret_cast<const int64_t *>(base + header.word_offsets_offset);
+    words_ = base + header.words_offset;
+}
+
+string EmbeddingFile::word(int i) const {
+    return string(words_ + word_offsets_[i], word_offsets_[i + 1] - word_offsets_[i]);
+}
+
+vector<string> EmbeddingFile::words() const {
+    vector<string> result;
+    result.reserve(size_);
+    for (int i = 0; i < size_; ++i) {
+        result.push_back(word(i));
+    }
+    return result;
+}
+
+}
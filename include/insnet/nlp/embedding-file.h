@@ -0,0 +1,65 @@
+#ifndef INSNET_EMBEDDING_FILE_H
+#define INSNET_EMBEDDING_FILE_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "insnet/base/def.h"
+#include "insnet/util/mapped-file.h"
+
+namespace insnet {
+
+/// Returns the dimension of the vectors in a text embedding file.
+int textEmbeddingDim(const std::string &path);
+
+/// Parse a text embedding file, calling *f* with each word and its vector in the file order.
+///
+/// Each line of the file contains a word followed by its vector, separated by spaces, and the first line may be a header of the word count and the dimension. The file is read block by block and each block is parsed by *thread_count* threads, so the memory usage does not grow with the file size. The lines of the wrong dimension are skipped with warnings.
+///
+/// \param thread_count The number of parsing threads. *The default value is 0, i.e., the number of the hardware threads.*
+/// \return The dimension.
+int readTextEmbeddingFile(const std::string &path,
+        const std::function<void(const std::string &word, const dtype *vec)> &f,
+        int thread_count = 0);
+
+/// Convert a text embedding file to the binary format of EmbeddingFile.
+void convertTextEmbeddingFile(const std::string &text_path, const std::string &binary_path,
+        int thread_count = 0);
+
+/// \brief The memory-mapped binary embedding file.
+///
+/// The file begins with a 64-byte header, followed by the vectors stored word by word, i.e., in the same layout as the embedding table, then the word offsets and the words. The vectors are stored in dtype, so the files converted with float can not be opened when USE_DOUBLE is on and vice versa.
+class EmbeddingFile {
+public:
+    EmbeddingFile(const std::string &path);
+
+    int size() const {
+        return size_;
+    }
+
+    int dim() const {
+        return dim_;
+    }
+
+    std::string word(int i) const;
+
+    std::vector<std::string> words() const;
+
+    /// Returns the vector of the i-th word, which is valid while this object lives.
+    const dtype *vec(int i) const {
+        return vecs_ + static_cast<int64_t>(i) * dim_;
+    }
+
+private:
+    MappedFile file_;
+    int size_ = 0;
+    int dim_ = 0;
+    const dtype *vecs_ = nullptr;
+    const int64_t *word_offsets_ = nullptr;
+    const char *words_ = nullptr;
+};
+
+}
+
+#endif
@@ -1,4 +1,6 @@
 #include "insnet/nlp/vocab.h"
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include "insnet/base/def.h"
 #include "insnet/util/util.h"
@@ -11,46 +13,179 @@ using std::cerr;
 using std::endl;
 using std::ofstream;
 using std::unordered_map;
-using std::pair;
+using std::make_shared;
+using std::ios;
 
 namespace insnet {
 
+namespace {
+
+const char MAGIC[8] = {'I', 'N', 'S', 'V', 'O', 'C', '0', '1'};
+
+struct VocabFileHeader {
+    char magic[8];
+    int64_t size;
+    int64_t slot_count;
+    int64_t offsets_offset;
+    int64_t slots_offset;
+    int64_t arena_offset;
+    int64_t arena_size;
+    char padding[8];
+};
+
+static_assert(sizeof(VocabFileHeader) == 64, "VocabFileHeader should be 64 bytes");
+
+/// The 64-bit FNV-1a hash, which is stable across platforms and thus can be stored in files.
+uint64_t hashString(const char *str, size_t len) {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= static_cast<unsigned char>(str[i]);
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+const int LOOKUP_GROUP_SIZE = 16;
+
+}
+
+int64_t Vocab::slotCountFor(int64_t size) {
+    int64_t slot_count = 16;
+    while (slot_count < 2 * size) {
+        slot_count *= 2;
+    }
+    return slot_count;
+}
+
+void Vocab::clear() {
+    size_ = 0;
+    slot_count_ = 0;
+    offsets_ = {0};
+    arena_.clear();
+    slots_.clear();
+    mapped_ = nullptr;
+}
+
+void Vocab::detach() {
+    if (mapped_ == nullptr) {
+        return;
+    }
+    offsets_.assign(mapped_offsets_, mapped_offsets_ + size_ + 1);
+    arena_.assign(mapped_arena_, offsets_.back());
+    slots_.assign(mapped_slots_, mapped_slots_ + slot_count_);
+    mapped_ = nullptr;
+}
+
+void Vocab::rehash(int64_t slot_count) {
+    slot_count_ = slot_count;
+    slots_.assign(slot_count, -1);
+    for (int id = 0; id < size_; ++id) {
+        insertIntoSlots(id);
+    }
+}
+
+void Vocab::insertIntoSlots(int id) {
+    const char *str = arena_.data() + offsets_.at(id);
+    size_t len = offsets_.at(id + 1) - offsets_.at(id);
+    uint64_t mask = slot_count_ - 1;
+    for (uint64_t i = hashString(str, len) & mask; ; i = (i + 1) & mask) {
+        int &slot = slots_[i];
+        if (slot < 0) {
+            slot = id;
+            return;
+        }
+        int64_t begin = offsets_[slot];
+        if (offsets_[slot + 1] - begin == len && memcmp(arena_.data() + begin, str, len) == 0) {
+            return;
+        }
+    }
+}
+
+int Vocab::findWithHash(const char *str, size_t len, uint64_t hash) const {
+    if (slot_count_ == 0) {
+        return -1;
+    }
+    const int64_t *offsets = offsetsPtr();
+    const int *slots = slotsPtr();
+    const char *arena = arenaPtr();
+    uint64_t mask = slot_count_ - 1;
+    for (uint64_t i = hash & mask; ; i = (i + 1) & mask) {
+        int id = slots[i];
+        if (id < 0) {
+            return -1;
+        }
+        int64_t begin = offsets[id];
+        if (offsets[id + 1] - begin == len && memcmp(arena + begin, str, len) == 0) {
+            return id;
+        }
+    }
+}
+
+int Vocab::find(const string &str) const {
+    return findWithHash(str.data(), str.size(), hashString(str.data(), str.size()));
+}
+
+vector<int> Vocab::lookup(const vector<string> &words, int unknown_id) const {
+    vector<int> ids(words.size());
+    uint64_t hashes[LOOKUP_GROUP_SIZE];
+    uint64_t mask = slot_count_ - 1;
+    for (int begin = 0; begin < words.size(); begin += LOOKUP_GROUP_SIZE) {
+        int end = std::min<int>(begin + LOOKUP_GROUP_SIZE, words.size());
+        for (int i = begin; i < end; ++i) {
+            const string &w = words[i];
+            hashes[i - begin] = hashString(w.data(), w.size());
+            if (slot_count_ > 0) {
+                __builtin_prefetch(slotsPtr() + (hashes[i - begin] & mask));
+            }
+        }
+        for (int i = begin; i < end; ++i) {
+            const string &w = words[i];
+            int id = findWithHash(w.data(), w.size(), hashes[i - begin]);
+            ids[i] = id < 0 ? unknown_id : id;
+        }
+    }
+    return ids;
+}
+
 int Vocab::operator[](const string& str) {
-    StringToId::const_iterator it = m_string_to_id.find(str);
-    if (it != m_string_to_id.end()) {
-        return it->second;
-    } else {
+    int id = find(str);
+    if (id < 0) {
         cerr << str << " not found" << endl;
         abort();
     }
+    return id;
 }
 
-const string& Vocab::from_id(const int& qid) const {
-    if (qid < 0 || m_size <= qid) {
+string Vocab::from_id(int qid) const {
+    if (qid < 0 || size_ <= qid) {
         cerr << "qid:" << qid << endl;
         abort();
-    } else {
-        return m_id_to_string[qid];
     }
+    const int64_t *offsets = offsetsPtr();
+    return string(arenaPtr() + offsets[qid], offsets[qid + 1] - offsets[qid]);
 }
 
 int Vocab::insert_string(const string& str) {
-    StringToId::const_iterator it = m_string_to_id.find(str);
-    if (it != m_string_to_id.end()) {
-        return it->second;
+    int id = find(str);
+    if (id >= 0) {
+        return id;
+    }
+    detach();
+    id = size_++;
+    arena_ += str;
+    offsets_.push_back(arena_.size());
+    if (2 * size_ > slot_count_) {
+        rehash(slotCountFor(size_));
     } else {
-        int newid = m_size;
-        m_id_to_string.push_back(str);
-        m_string_to_id.insert(pair<string, int>(str, newid));
-        m_size++;
-        return newid;
+        insertIntoSlots(id);
     }
+    return id;
 }
 
 int Vocab::from_string(const string& str) const {
-    StringToId::const_iterator it = m_string_to_id.find(str);
-    if (it != m_string_to_id.end()) {
-        return it->second;
+    int id = find(str);
+    if (id >= 0) {
+        return id;
     } else if (str == UNKNOWN_WORD) {
         return -1;
     } else {
@@ -60,34 +195,39 @@ int Vocab::from_string(const string& str) const {
 }
 
 void Vocab::read(ifstream &inf) {
+    clear();
     string featKey;
     int featId;
-    inf >> m_size;
-    for (int i = 0; i < m_size; ++i) {
+    int size;
+    inf >> size;
+    vector<string> words;
+    words.reserve(size);
+    for (int i = 0; i < size; ++i) {
         inf >> featKey >> featId;
-        m_string_to_id[featKey] = i;
-        m_id_to_string.push_back(featKey);
+        words.push_back(featKey);
         if (featId != i) {
             cerr << fmt::format("Vocab read - featId:{} i:{}\n", featId, i);
             abort();
         }
     }
+    init(words);
 }
 
 void Vocab::write(ofstream &outf) const {
-    outf << m_size << endl;
-    for (int i = 0; i < m_size; i++) {
-        outf << m_id_to_string[i] << " " << i << endl;
+    outf << size_ << endl;
+    for (int i = 0; i < size_; i++) {
+        outf << from_id(i) << " " << i << endl;
     }
 }
 
 void Vocab::init(const vector<string> &word_list) {
-    m_size = word_list.size();
-    m_id_to_string = word_list;
-    int i = 0;
+    clear();
     for (const string &w : word_list) {
-        m_string_to_id.insert(make_pair(w, i++));
+        arena_ += w;
+        offsets_.push_back(arena_.size());
     }
+    size_ = word_list.size();
+    rehash(slotCountFor(size_));
 }
 
 void Vocab::init(const unordered_map<string, int>& elem_stat, int cutOff) {
@@ -111,12 +251,93 @@ void Vocab::init(const string& inFile, bool bUseUnknown) {
         }
         if (!strLine.empty()) {
             split_bychar(strLine, vecInfo, ' ');
-            from_string(vecInfo[0]);
+            insert_string(vecInfo[0]);
         }
     }
     if (bUseUnknown) {
-        from_string(UNKNOWN_WORD);
+        insert_string(UNKNOWN_WORD);
+    }
+}
+
+void Vocab::writeBinary(const string &path) const {
+    ofstream outf(path, ios::binary);
+    if (!outf.is_open()) {
+        cerr << fmt::format("Vocab writeBinary - failed to open {}\n", path);
+        abort();
+    }
+    const int64_t *offsets = offsetsPtr();
+    VocabFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.size = size_;
+    header.slot_count = slot_count_;
+    header.offsets_offset = sizeof(header);
+    header.slots_offset = header.offsets_offset + (size_ + 1) * sizeof(int64_t);
+    header.arena_offset = header.slots_offset + slot_count_ * sizeof(int);
+    header.arena_size = offsets[size_];
+    outf.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    outf.write(reinterpret_cast<const char *>(offsets), (size_ + 1) * sizeof(int64_t));
+    outf.write(reinterpret_cast<const char *>(slotsPtr()), slot_count_ * sizeof(int));
+    outf.write(arenaPtr(), header.arena_size);
+    if (!outf.good()) {
+        cerr << fmt::format("Vocab writeBinary - failed to write {}\n", path);
+        abort();
+    }
+}
+
+void Vocab::mapBinary(const string &path) {
+    auto file = make_shared<MappedFile>(path);
+    if (file->size() < sizeof(VocabFileHeader)) {
+        cerr << fmt::format("Vocab mapBinary - {} is too short\n", path);
+        abort();
+    }
+    const VocabFileHeader &header = *reinterpret_cast<const VocabFileHeader *>(file->data());
+    int64_t file_size = file->size();
+    bool slot_count_valid = header.slot_count == 0 ? header.size == 0 :
+        header.slot_count > 0 && (header.slot_count & (header.slot_count - 1)) == 0 &&
+        header.slot_count > header.size;
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.size < 0 ||
+            header.size >= file_size / static_cast<int64_t>(sizeof(int64_t)) ||
+            !slot_count_valid ||
+            header.slot_count > file_size / static_cast<int64_t>(sizeof(int)) ||
+            !sectionFits(header.offsets_offset, (header.size + 1) * sizeof(int64_t), file_size,
+                sizeof(header), alignof(int64_t)) ||
+            !sectionFits(header.slots_offset, header.slot_count * sizeof(int), file_size,
+                sizeof(header), alignof(int)) ||
+            !sectionFits(header.arena_offset, header.arena_size, file_size, sizeof(header), 1)) {
+        cerr << fmt::format("Vocab mapBinary - {} is not a valid vocabulary file\n", path);
+        abort();
+    }
+    const int64_t *offsets = reinterpret_cast<const int64_t *>(file->data() +
+            header.offsets_offset);
+    if (!areOffsetsValid(offsets, header.size, header.arena_size) ||
+            offsets[header.size] != header.arena_size) {
+        cerr << fmt::format("Vocab mapBinary - {} has offsets not delimiting its {}-byte arena\n",
+                path, header.arena_size);
+        abort();
+    }
+    // findWithHash stops probing at an empty slot, so a miss would never end without one.
+    const int *slots = reinterpret_cast<const int *>(file->data() + header.slots_offset);
+    bool has_empty_slot = header.slot_count == 0;
+    for (int64_t i = 0; i < header.slot_count; ++i) {
+        if (slots[i] < -1 || slots[i] >= header.size) {
+            cerr << fmt::format("Vocab mapBinary - {} has slot {} of invalid id {}\n", path, i,
+                    slots[i]);
+            abort();
+        }
+        has_empty_slot = has_empty_slot || slots[i] == -1;
+    }
+    if (!has_empty_slot) {
+        cerr << fmt::format("Vocab mapBinary - {} has no empty slot\n", path);
+        abort();
     }
+    clear();
+    size_ = header.size;
+    slot_count_ = header.slot_count;
+    mapped_offsets_ = reinterpret_cast<const int64_t *>(file->data() + header.offsets_offset);
+    mapped_slots_ = slots;
+    mapped_arena_ = file->data() + header.arena_offset;
+    mapped_ = file;
 }
 
 }
@@ -1,24 +1,23 @@
 #ifndef INSNET_VOCAB_H
 #define INSNET_VOCAB_H
 
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
+#include "insnet/util/mapped-file.h"
 
 namespace insnet {
 
+/// \brief The vocabulary mapping words to contiguous IDs.
+///
+/// The words are stored once in a contiguous arena, indexed by an open-addressing hash table of IDs. The whole representation can be written to a binary file by writeBinary and then memory-mapped by mapBinary without rebuilding the hash table, in which case it is copied to the heap only when new words are inserted.
 class Vocab {
 public:
-    typedef std::unordered_map<std::string, int> StringToId;
-    typedef std::vector<std::string> IdToString;
-
-    StringToId m_string_to_id;
-    IdToString m_id_to_string;
-    int m_size = 0;
-
     /**
      * Map a string to its associated ID.
-     *  If string-to-integer association does not exist, allocate a new ID.
+     *  If string-to-integer association does not exist, abort.
      *  @param  str         String value.
      *  @return           Associated ID for the string value.
      */
@@ -27,21 +26,28 @@ public:
     /**
      * Convert ID value into the associated string value.
      *  @param  qid         ID.
-     *  @param  def         Default value if the ID was out of range.
      *  @return           String value associated with the ID.
      */
-    const std::string& from_id(const int& qid) const;
+    std::string from_id(int qid) const;
 
     int insert_string(const std::string& str);
 
     int from_string(const std::string& str) const;
 
     bool find_string(const std::string &str) const {
-        return m_string_to_id.find(str) != m_string_to_id.end();
+        return find(str) >= 0;
     }
 
+    /// Returns the ID of *str*, or -1 if not found.
+    int find(const std::string &str) const;
+
+    /// Returns the IDs of *words* in batch, using *unknown_id* for the words not found.
+    ///
+    /// The hashes of a group of words are computed and their slots are prefetched before probing, so the cache misses of the hash table overlap.
+    std::vector<int> lookup(const std::vector<std::string> &words, int unknown_id = -1) const;
+
     size_t size() const {
-        return m_size;
+        return size_;
     }
 
     void read(std::ifstream &inf);
@@ -56,12 +62,67 @@ public:
     // initial by a file (first column), always an embedding file
     void init(const std::string& inFile, bool bUseUnknown = true);
 
+    /// Write the arena, the offsets and the hash table to the binary file that mapBinary loads.
+    void writeBinary(const std::string &path) const;
+
+    /// Replace this vocabulary with the memory-mapped binary file written by writeBinary.
+    void mapBinary(const std::string &path);
+
     template<typename Archive>
-    void serialize(Archive &ar) {
-        ar(m_string_to_id);
-        ar(m_id_to_string);
-        ar(m_size);
+    void save(Archive &ar) const {
+        std::vector<int64_t> offsets(offsetsPtr(), offsetsPtr() + size_ + 1);
+        std::string arena(arenaPtr(), offsets.back());
+        ar(offsets, arena);
     }
+
+    template<typename Archive>
+    void load(Archive &ar) {
+        clear();
+        ar(offsets_, arena_);
+        size_ = offsets_.size() - 1;
+        rehash(slotCountFor(size_));
+    }
+
+private:
+    void clear();
+
+    /// Copy the memory-mapped representation to the heap so that it can be modified.
+    void detach();
+
+    void rehash(int64_t slot_count);
+
+    void insertIntoSlots(int id);
+
+    int findWithHash(const char *str, size_t len, uint64_t hash) const;
+
+    static int64_t slotCountFor(int64_t size);
+
+    const int64_t *offsetsPtr() const {
+        return mapped_ == nullptr ? offsets_.data() : mapped_offsets_;
+    }
+
+    const int *slotsPtr() const {
+        return mapped_ == nullptr ? slots_.data() : mapped_slots_;
+    }
+
+    const char *arenaPtr() const {
+        return mapped_ == nullptr ? arena_.data() : mapped_arena_;
+    }
+
+    int size_ = 0;
+    int64_t slot_count_ = 0;
+
+    /// The word i is arena_[offsets_[i], offsets_[i + 1]).
+    std::vector<int64_t> offsets_ = {0};
+    std::string arena_;
+
+    /// The IDs in the open-addressing hash table, or -1 if the slots are empty.
+    std::vector<int> slots_;
+
+    std::shared_ptr<MappedFile> mapped_ = nullptr;
+    const int64_t *mapped_offsets_ = nullptr;
+    const int *mapped_slots_ = nullptr;
+    const char *mapped_arena_ = nullptr;
 };
 
 }
@@ -51,6 +51,10 @@ public:
 
     Executor *generate() override;
 
+    vector<BaseParam *> params() override {
+        return {};
+    }
+
     string typeSignature() const override {
         return Node::getNodeType() + "-" + to_string(inputSize());
     }
@@ -134,6 +138,15 @@ public:
 #endif
     }
 
+    int64_t calculateFLOPs() override {
+        int64_t sum = 0;
+        for (Node *node : batch) {
+            PAddNode *add = dynamic_cast<PAddNode*>(node);
+            sum += static_cast<int64_t>(add->size()) * add->inputSize();
+        }
+        return sum;
+    }
+
 private:
     int inCount() {
         return dynamic_cast<PAddNode &>(*batch.front()).input_vals_.size();
@@ -146,11 +159,11 @@ private:
 #else
 class PAddExecutor : public Executor {
 public:
-    int calculateFLOPs() override {
-        int sum = 0;
+    int64_t calculateFLOPs() override {
+        int64_t sum = 0;
         for (Node *node : batch) {
             PAddNode *add = dynamic_cast<PAddNode*>(node);
-            sum += add->size() * add->inputSize();
+            sum += static_cast<int64_t>(add->size()) * add->inputSize();
         }
         return sum;
     }
@@ -69,13 +69,7 @@ private:
 };
 #else
 template<ActivatedEnum activation>
-class ActivationExecutor : public Executor {
-public:
-    int calculateFLOPs() override {
-        return defaultFLOPs();
-    }
-
-};
+class ActivationExecutor : public Executor {};
 #endif
 
 class TanhNode : public UniInputNode, public Poolable<TanhNode> {
@@ -96,6 +90,10 @@ public:
 
     Executor *generate() override;
 
+    vector<BaseParam *> params() override {
+        return {};
+    }
+
     string typeSignature() const override {
         return Node::getNodeType();
     }
@@ -139,6 +137,10 @@ public:
         return new ActivationExecutor<ActivatedEnum::SIGMOID>;
     }
 
+    vector<BaseParam *> params() override {
+        return {};
+    }
+
     string typeSignature() const override {
         return Node::getNodeType();
     }
@@ -177,6 +179,10 @@ public:
         return new ActivationExecutor<ActivatedEnum::RELU>;
     }
 
+    vector<BaseParam *> params() override {
+        return {};
+    }
+
     string typeSignature() const override {
         return Node::getNodeType();
     }
@@ -219,6 +225,10 @@ public:
         return new ActivationExecutor<ActivatedEnum::SQRT>;
     }
 
+    vector<BaseParam *> params() override {
+        return {};
+    }
+
 protected:
     virtual bool isDimLegal(const Node &input) const override {
         return input.size() == size();
@@ -265,7 +275,9 @@ public:
     void compute() override {
         if (isTraining()) {
 #if !TEST_CUDA
-            generate_dropmask();
+            if (!getNodeContainer().isRecomputing()) {
+                generate_dropmask();
+            }
 #endif
         } else {
             drop_mask_ = 1 - drop_value_;
@@ -292,6 +304,10 @@ public:
 
     Executor *generate() override;
 
+    vector<BaseParam *> params() override {
+        return {};
+    }
+
     bool isTraining() {
         return getNodeContainer().getModelStage() == ModelStage::TRAINING;
     }
@@ -446,10 +462,6 @@ public:
         }
 #endif
     }
-#else
-    int calculateFLOPs() override {
-        return defaultFLOPs();
-    }
 #endif
 
 private:
@@ -505,6 +517,10 @@ public:
 
     Executor* generate() override;
 
+    vector<BaseParam *> params() override {
+        return {};
+    }
+
 protected:
     bool isDimLegal(const Node &input) const override {
         return input.size() % size() == 0;
@@ -577,14 +593,18 @@ public:
 #endif
     }
 
+    int64_t calculateFLOPs() override {
+        return inputElementCount();
+    }
+
 private:
     vector<int> max_indexes;
 };
 #else
 class MaxScalarExecutor : public Executor {
 public:
-    int calculateFLOPs() override {
-        return defaultFLOPs();
+    int64_t calculateFLOPs() override {
+        return inputElementCount();
     }
 };
 #endif
@@ -626,6 +646,10 @@ public:
 
     Executor* generate() override;
 
+    vector<BaseParam *> params() override {
+        return {};
+    }
+
 protected:
     bool isDimLegal(const Node &input) const override {
         return true;
@@ -697,13 +721,17 @@ public:
 #endif
     }
 
+    int64_t calculateFLOPs() override {
+        return 0;
+    }
+
 private:
     vector<int> dims_;
 };
 #else
 class ScalarToVectorExecutor : public Executor {
 public:
-    int calculateFLOPs() override {
+    int64_t calculateFLOPs() override {
         return 0;
     }
 };
@@ -725,6 +753,10 @@ public:
         return new ActivationExecutor<ActivatedEnum::EXP>;
     }
 
+    vector<BaseParam *> params() override {
+        return {};
+    }
+
     string typeSignature() const override {
         return getNodeType();
     }
@@ -761,6 +793,10 @@ public:
 
     Executor* generate() override;
 
+    vector<BaseParam *> params() override {
+        return {};
+    }
+
     virtual string typeSignature() const override {
         return Node::typeSignature();
     }
@@ -849,14 +885,18 @@ class SumExecutor : public Executor {
 #endif
     }
 
+    int64_t calculateFLOPs() override {
+        return inputElementCount();
+    }
+
 private:
     vector<int> dims_;
 };
 #else
 class SumExecutor : public Executor {
 public:
-    int calculateFLOPs() override {
-        return defaultFLOPs();
+    int64_t calculateFLOPs() override {
+        return inputElementCount();
     }
 };
 #endif
@@ -889,6 +929,10 @@ public:
 
     Executor* generate() override;
 
+    vector<BaseParam *> params() override {
+        return {};
+    }
+
     virtual string typeSignature() const override {
         return getNodeType();
     }
@@ -970,12 +1014,7 @@ private:
     vector<dtype> factors;
 };
 #else
-class ScaledExecutor : public Executor {
-public:
-    int calculateFLOPs() override {
-        return defaultFLOPs();
-    }
-};
+class ScaledExecutor : public Executor {};
 #endif
 
 Executor *ScaledNode::generate() {
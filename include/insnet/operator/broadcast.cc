@@ -16,6 +16,10 @@ public:
 
     Executor *generate() override;
 
+    vector<BaseParam *> params() override {
+        return {};
+    }
+
     void compute() override {
         int row = size() / getColumn();
         for (int i = 0; i < getColumn(); ++i) {
@@ -100,6 +104,10 @@ public:
 #endif
     }
 
+    int64_t calculateFLOPs() override {
+        return 0;
+    }
+
 private:
     cuda::IntArray ns_arr_;
     int max_n_;
@@ -110,8 +118,8 @@ private:
 
 class BroadcastExecutor : public Executor {
 public:
-    int calculateFLOPs() override {
-        return 0; // TODO
+    int64_t calculateFLOPs() override {
+        return 0;
     }
 };
 
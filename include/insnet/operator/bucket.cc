@@ -33,6 +33,10 @@ public:
 
     Executor* generate() override;
 
+    vector<BaseParam *> params() override {
+        return {};
+    }
+
     void setVals(const vector<dtype> &vals) {
         input_ = vals;
     }
@@ -67,13 +71,74 @@ Node *tensor(Graph &graph, const vector<dtype> &v) {
     return bucket;
 }
 
+class TensorViewNode : public Node, public Poolable<TensorViewNode> {
+public:
+    TensorViewNode() : Node("tensor-view") {}
+
+    void setNodeDim(int dim) override {
+        setDim(dim);
+    }
+
+    void connect(Graph &graph, const Tensor1D &t) {
+        val().initAsView(t, 0, t.dim);
+        graph.addNode(this);
+    }
+
+    std::string typeSignature() const override {
+        return getNodeType();
+    }
+
+    void compute() override {}
+
+    void backward() override {}
+
+    Executor* generate() override;
+
+    vector<BaseParam *> params() override {
+        return {};
+    }
+
+protected:
+    int forwardOnlyInputValSize() override {
+        return 0;
+    }
+
+    bool isValForwardOnly() const override {
+        return true;
+    }
+};
+
+Node *tensor(Graph &graph, const Tensor1D &t, int col) {
+    TensorViewNode *view = TensorViewNode::newNode(t.dim);
+    view->setColumn(col);
+    view->connect(graph, t);
+    return view;
+}
+
+class TensorViewExecutor : public Executor {
+public:
+    int64_t calculateFLOPs() override {
+        return 0;
+    }
+
+    int64_t calculateBytes() override {
+        return 0;
+    }
+
+    void forward() override {}
+
+    void backward() override {}
+};
+
+Executor* TensorViewNode::generate() {
+    return new TensorViewExecutor();
+}
+
 class BucketExecutor : public Executor {
 public:
-#if !USE_GPU
-    int calculateFLOPs() override {
+    int64_t calculateFLOPs() override {
         return 0;
     }
-#endif
 
     void forward() override {
 #if USE_GPU
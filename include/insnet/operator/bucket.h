@@ -30,6 +30,18 @@ Node *tensor(Graph &graph, int size, dtype value);
 /// \return The result tensor. Its size is equal to *list.size()*.
 Node *tensor(Graph &graph, const std::vector<dtype> &list);
 
+/// \ingroup operator
+/// Reference a persistent tensor, e.g., the cached encoder keys of the Transformer decoder, in the computation graph without copying it.
+///
+/// The tensor must be initialized with a memory container, which is the case for vals computed in a previous graph. The result is a constant, so no gradient will be propagated to the tensor.
+///
+/// **All the operators will be executed in batch and the forward pass does nothing.**
+/// \param graph The computation graph.
+/// \param t The persistent tensor, which should live until the graph is destroyed. It is not mandatory since the memory is shared rather than borrowed.
+/// \param col The result tensor's column. The default value is 1.
+/// \return The result tensor, whose val is a view of *t*.
+Node *tensor(Graph &graph, const Tensor1D &t, int col = 1);
+
 }
 
 #endif
@@ -8,6 +8,7 @@ using std::to_string;
 using std::cerr;
 using std::cout;
 using std::endl;
+using std::find;
 
 namespace insnet {
 
@@ -21,6 +22,8 @@ public:
 
     void clear() override {
         in_rows_.clear();
+        view_inputs_.clear();
+        is_planned_ = false;
         Node::clear();
     }
 
@@ -47,21 +50,61 @@ public:
         }
 
         setInputs(x);
+        planInputViews(x);
         afterConnect(x);
     }
 
+    /// Plan the inputs as views of the result, so that they are written into the result in place and neither forward nor backward copies.
+    ///
+    /// It is planned only if all the inputs are distinct and plannable, and their slices are contiguous unless *strided* is true, with which the inputs should be produced by operators supporting strided vals. If a consumer not supporting strided inputs connects to any of them later, all the views are cancelled and the concatenation copies.
+    void planInputViews(const vector<Node *> &ins, bool strided = false) {
+        bool contiguous = getColumn() == 1 || ins.size() == 1;
+        if (!contiguous && !strided) {
+            return;
+        }
+        for (int i = 0; i < ins.size(); ++i) {
+            if (!ins.at(i)->isPlannableAsView() ||
+                    find(ins.begin(), ins.begin() + i, ins.at(i)) != ins.begin() + i ||
+                    (!contiguous && !ins.at(i)->isStridedValSupported())) {
+                return;
+            }
+        }
+        int row = size() / getColumn();
+        int offset = 0;
+        for (int i = 0; i < ins.size(); ++i) {
+            bool planned = contiguous ? ins.at(i)->planAsViewOf(*this, offset) :
+                ins.at(i)->planAsViewOf(*this, offset, in_rows_.at(i), row);
+            if (!planned) {
+                return;
+            }
+            offset += in_rows_.at(i);
+        }
+        view_inputs_ = ins;
+        is_planned_ = true;
+    }
+
     Executor* generate() override;
 
+    vector<BaseParam *> params() override {
+        return {};
+    }
+
     string typeSignature() const override {
         string hash_code = Node::getNodeType() + "-" + to_string(in_rows_.size());
         for (int dim : in_rows_) {
             hash_code += "-" + to_string(dim);
         }
         hash_code += "-" + to_string(getColumn());
+        if (is_planned_) {
+            hash_code += "-view";
+        }
         return hash_code;
     }
 
     void compute() override {
+        if (is_planned_) {
+            return;
+        }
         int in_size = input_vals_.size();
         int row = size() / getColumn();
         for (int i = 0; i < getColumn(); ++i) {
@@ -75,6 +118,9 @@ public:
     }
 
     void backward() override {
+        if (is_planned_) {
+            return;
+        }
         int in_size = input_vals_.size();
         int row = size() / getColumn();
         for (int i = 0; i < getColumn(); ++i) {
@@ -96,8 +142,22 @@ protected:
         return true;
     }
 
+    /// The views are planned all or none, so cancelling one cancels the others.
+    void onStridedViewCancelled() override {
+        if (!is_planned_) {
+            return;
+        }
+        is_planned_ = false;
+        for (Node *in : view_inputs_) {
+            in->cancelStridedView();
+        }
+        view_inputs_.clear();
+    }
+
 private:
     vector<int> in_rows_;
+    vector<Node *> view_inputs_;
+    bool is_planned_ = false;
 
     friend class ConcatExecutor;
 };
@@ -106,6 +166,9 @@ private:
 class ConcatExecutor : public Executor {
 public:
     void forward() override {
+        if (dynamic_cast<ConcatNode &>(*batch.front()).is_planned_) {
+            return;
+        }
         int count = batch.size();
 
         vector<dtype*> in_vals, vals;
@@ -135,6 +198,9 @@ public:
     }
 
     void backward() override {
+        if (dynamic_cast<ConcatNode &>(*batch.front()).is_planned_) {
+            return;
+        }
         int count = batch.size();
         vector<dtype*> in_losses, losses;
         in_losses.reserve(inCount() * count);
@@ -162,6 +228,15 @@ public:
 #endif
     }
 
+    int64_t calculateFLOPs() override {
+        return 0;
+    }
+
+    int64_t calculateBytes() override {
+        return dynamic_cast<ConcatNode &>(*batch.front()).is_planned_ ? 0 :
+            Executor::calculateBytes();
+    }
+
 private:
     int inCount() {
         return dynamic_cast<ConcatNode *>(batch.front())->input_vals_.size();
@@ -173,10 +248,15 @@ private:
 #else
 class ConcatExecutor : public Executor {
 public:
-    int calculateFLOPs() override {
+    int64_t calculateFLOPs() override {
         return 0;
     }
 
+    int64_t calculateBytes() override {
+        return dynamic_cast<ConcatNode &>(*batch.front()).is_planned_ ? 0 :
+            Executor::calculateBytes();
+    }
+
     int calculateActivations() override {
         return 0;
     }
@@ -195,12 +275,34 @@ public:
 
     MatrixConcatNode(): Node("matrix-concat") {}
 
+    void clear() override {
+        is_planned_ = false;
+        Node::clear();
+    }
+
     void connect(const vector<Node *> &inputs) {
         setInputs(inputs);
         setColumn(inputs.size());
+        planInputViews(inputs);
         afterConnect(inputs);
     }
 
+    /// Plan the inputs as views of the result's columns if they are all distinct and plannable, so that they are written into the result in place and neither forward nor backward copies.
+    void planInputViews(const vector<Node *> &ins) {
+        for (int i = 0; i < ins.size(); ++i) {
+            if (!ins.at(i)->isPlannableAsView() ||
+                    find(ins.begin(), ins.begin() + i, ins.at(i)) != ins.begin() + i) {
+                return;
+            }
+        }
+        for (int i = 0; i < ins.size(); ++i) {
+            if (!ins.at(i)->planAsViewOf(*this, i * getRow())) {
+                return;
+            }
+        }
+        is_planned_ = true;
+    }
+
     void setInputs(const vector<Node *> &inputs) override {
         int input_dim = inputs.front()->size();
         for (auto it = inputs.begin() + 1; it != inputs.end(); ++it) {
@@ -214,6 +316,9 @@ public:
     }
 
     void compute() override {
+        if (is_planned_) {
+            return;
+        }
         for (int i = 0; i < inputSize(); ++i) {
             int offset = i * getRow();
             for (int j = 0; j < getRow(); ++j) {
@@ -223,6 +328,9 @@ public:
     }
 
     void backward() override {
+        if (is_planned_) {
+            return;
+        }
         for (int i = 0; i < inputSize(); ++i) {
             int offset = i * getRow();
             for (int j = 0; j < getRow(); ++j) {
@@ -232,11 +340,15 @@ public:
     }
 
     string typeSignature() const override {
-        return "MatrixConcatNode-" + to_string(getRow());
+        return "MatrixConcatNode-" + to_string(getRow()) + (is_planned_ ? "-view" : "");
     }
 
     Executor* generate() override;
 
+    vector<BaseParam *> params() override {
+        return {};
+    }
+
 protected:
     int forwardOnlyInputValSize() override {
         return inputSize();
@@ -247,6 +359,8 @@ protected:
     }
 
 private:
+    bool is_planned_ = false;
+
     friend class BatchedMatrixConcatNode;
     friend class MatrixConcatExecutor;
 };
@@ -255,6 +369,9 @@ private:
 class MatrixConcatExecutor : public Executor {
 public:
     void forward() override {
+        if (dynamic_cast<MatrixConcatNode &>(*batch.front()).is_planned_) {
+            return;
+        }
 #if TEST_CUDA
         testForwardInpputs();
         cout << "MatrixConcat forward tested" << endl;
@@ -286,6 +403,9 @@ public:
     }
 
     void backward() override {
+        if (dynamic_cast<MatrixConcatNode &>(*batch.front()).is_planned_) {
+            return;
+        }
         vector<dtype *> grads, in_grads;
         grads.reserve(batch.size());
         in_grads.reserve(batch.size());
@@ -305,6 +425,15 @@ public:
 #endif
     }
 
+    int64_t calculateFLOPs() override {
+        return 0;
+    }
+
+    int64_t calculateBytes() override {
+        return dynamic_cast<MatrixConcatNode &>(*batch.front()).is_planned_ ? 0 :
+            Executor::calculateBytes();
+    }
+
 private:
     vector<int> in_counts;
     int max_in_count;
@@ -312,10 +441,15 @@ private:
 #else
 class MatrixConcatExecutor : public Executor {
 public:
-    int calculateFLOPs() override {
+    int64_t calculateFLOPs() override {
         return 0;
     }
 
+    int64_t calculateBytes() override {
+        return dynamic_cast<MatrixConcatNode &>(*batch.front()).is_planned_ ? 0 :
+            Executor::calculateBytes();
+    }
+
     int calculateActivations() override {
         return 0;
     }
@@ -361,7 +495,7 @@ Node *cat(const vector<Node*> &inputs, int col) {
     }
 }
 
-Node *cat(BatchedNode &inputs, int col) {
+Node *cat(BatchedNode &inputs, int col, bool strided_view) {
     int dim = 0;
     for (Node *in : inputs.batch()) {
         dim += in->size();
@@ -369,6 +503,7 @@ Node *cat(BatchedNode &inputs, int col) {
     ConcatNode *concat = ConcatNode::newNode(dim);
     concat->setColumn(col);
     concat->setInputs(inputs.batch());
+    concat->planInputViews(inputs.batch(), strided_view);
     inputs.addParent(concat);
     NodeContainer &container = inputs.getNodeContainer();
     container.addNode(concat);
@@ -17,10 +17,14 @@ namespace insnet {
 /// For example, cat({[0.1, 0.2], [0.1, 0], [0.1, 0.2]}) and cat({[0, 0], [0, 0]}) will be executed in batch because their input tensors have the same size of 2, though they have different number of input tensors.
 /// \param inputs The input matrices
 /// \param col The column number of both the input matrices and the result matrix. *The default value is 1.*
+/// If the inputs are distinct and not yet computed, and *col* is 1, they will be written into the result in place, so that neither forward nor backward copies.
 /// \return The result matrix. Its size is equal to the sum of all input matrix sizes.
 Node *cat(const std::vector<Node*> &inputs, int col = 1);
 
-Node *cat(BatchedNode &inputs, int col = 1);
+/// Concaternate the batched input matrices.
+///
+/// The inputs are planned as views of the result and written into it in place if possible, i.e., they are distinct and plannable, and either col is 1 or *strided_view* is true. Strided views are only planned for the inputs produced by matmul-family operators such as matrixMulMatrix, and they are all cancelled if any input is also consumed by another operator.
+Node *cat(BatchedNode &inputs, int col = 1, bool strided_view = false);
 
 }
 
@@ -57,6 +57,10 @@ public:
 
     Executor* generate() override;
 
+    vector<BaseParam *> params() override {
+        return {};
+    }
+
 protected:
     int forwardOnlyInputValSize() override {
         return 0;
@@ -121,12 +125,7 @@ private:
     vector<int> dims;
 };
 #else
-class FullDivExecutor : public Executor {
-public:
-    int calculateFLOPs() override {
-        return defaultFLOPs();
-    }
-};
+class FullDivExecutor : public Executor {};
 #endif
 
 Executor *FullDivNode::generate() {
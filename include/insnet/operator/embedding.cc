@@ -5,6 +5,18 @@ using std::string;
 
 namespace insnet {
 
+namespace {
+
+dtype *gradColumn(Param &param, int id) {
+    return param.grad()[id];
+}
+
+dtype *gradColumn(SparseParam &param, int id) {
+    return param.gradColumn(id);
+}
+
+}
+
 template <typename ParamType>
 class BatchedLookupNode;
 template <typename ParamType>
@@ -44,8 +56,15 @@ public:
     void compute() override {
         int dim = size() / ids_.size();
         int i = 0;
-        for (int id : ids_) {
-            Vec(val().v + i++ * dim, dim) = Vec(param_->val()[id], dim);
+        if (getNodeContainer().isBFloat16Compute() && param_->hasBFloat16Copy()) {
+            for (int id : ids_) {
+                toFloat(param_->bfloat16Copy() + static_cast<int64_t>(id) * dim, dim,
+                        val().v + i++ * dim);
+            }
+        } else {
+            for (int id : ids_) {
+                Vec(val().v + i++ * dim, dim) = Vec(param_->val()[id], dim);
+            }
         }
     }
 
@@ -54,7 +73,7 @@ public:
             int dim = size() / ids_.size();
             int i = 0;
             for (int id : ids_) {
-                Vec(param_->grad()[id], dim) += Vec(grad().v + i++ * dim, dim);
+                Vec(gradColumn(*param_, id), dim) += Vec(grad().v + i++ * dim, dim);
             }
         }
     }
@@ -63,6 +82,14 @@ public:
         should_backward_ = should_backward;
     }
 
+    vector<BaseParam *> params() override {
+        if (should_backward_) {
+            return {param_};
+        } else {
+            return {};
+        }
+    }
+
 protected:
     int forwardOnlyInputValSize() override {
         return {};
@@ -86,7 +113,7 @@ Node *embedding(Graph &graph, const vector<int> &ids, ParamType &lookup,
         bool freeze = false) {
     LookupNode<ParamType>* input_lookup =
         LookupNode<ParamType>::newNode(lookup.outDim() * ids.size());
-    input_lookup->setShouldBackward(!freeze);
+    input_lookup->setShouldBackward(!freeze && !lookup.isFrozen());
     input_lookup->setParam(lookup);
     input_lookup->connect(graph, ids);
     return input_lookup;
@@ -102,25 +129,17 @@ template <typename ParamType>
 Node *embedding(Graph &graph, const vector<string> &words, Embedding<ParamType> &lookup, int dim,
         bool freeze = false) {
     using namespace std;
-    vector<int> ids;
-    ids.reserve(words.size());
-    for (const string &word : words) {
-        int id;
-        if (!lookup.findElemId(word)) {
-            if (lookup.nUNKId < 0) {
-                cerr << "nUNKId is negative:" << lookup.nUNKId << endl;
-                abort();
-            }
-            id = lookup.nUNKId;
-        } else {
-            id = lookup.getElemId(word);
+    vector<int> ids = lookup.getElemIds(words);
+    for (int id : ids) {
+        if (id < 0) {
+            cerr << "nUNKId is negative:" << lookup.nUNKId << endl;
+            abort();
         }
-        ids.push_back(id);
     }
     LookupNode<ParamType>* input_lookup = LookupNode<ParamType>::newNode(dim * words.size());
     input_lookup->setParam(lookup.E);
     input_lookup->connect(graph, ids);
-    input_lookup->setShouldBackward(!freeze);
+    input_lookup->setShouldBackward(!freeze && !lookup.E.isFrozen());
     return input_lookup;
 }
 
@@ -160,22 +179,21 @@ public:
             cols.push_back(col);
         }
         max_col_ = *max_element(cols.begin(), cols.end());
-        vector<int> ids, backward_switches;
-        ids.reserve(count * max_col_);
-        backward_switches.reserve(count);
+        ids_.clear();
+        ids_.reserve(count * max_col_);
         vector<dtype*> vals;
         vals.reserve(count);
         for (Node *node : batch) {
             LookupNode<ParamType> &l = dynamic_cast<LookupNode<ParamType> &>(*node);
             for (int id : l.ids_) {
-                ids.push_back(id);
+                ids_.push_back(id);
             }
             for (int i = 0; i < max_col_ - l.ids_.size(); ++i) {
-                ids.push_back(-1);
+                ids_.push_back(-1);
             }
             vals.push_back(l.getVal().value);
         }
-        id_arr_.init(ids.data(), ids.size());
+        id_arr_.init(ids_.data(), ids_.size());
         col_arr_.init(cols.data(), count);
         int row = getRow();
         cuda::LookupForward(id_arr_.value, param().val().value, count, row, col_arr_.value,
@@ -205,13 +223,26 @@ public:
             batch[idx]->backward();
         }
 
-        cuda::Assert(param().grad().verify("lookup backward grad"));
+        verifyBackward();
 #endif
     }
 
+    int64_t calculateFLOPs() override {
+        return 0;
+    }
+
+    /// The rows read from the param and the vals written.
+    int64_t calculateBytes() override {
+        return 2 * elementCount() * sizeof(dtype);
+    }
+
 private:
     void genericBackward(vector<dtype*> &);
 
+#if TEST_CUDA
+    void verifyBackward();
+#endif
+
     ParamType &param() {
         return *dynamic_cast<LookupNode<ParamType> &>(*batch.front()).param_;
     }
@@ -220,14 +251,22 @@ private:
         return dynamic_cast<LookupNode<ParamType> &>(*batch.front()).should_backward_;
     }
 
-    cuda::IntArray id_arr_, backward_switch_arr_, col_arr_;
+    vector<int> ids_;
+    cuda::IntArray id_arr_, slot_arr_, col_arr_;
     int max_col_;
 };
 
+/// The grads are accumulated into the compact block of the SparseParam, so the kernel is given the slots of the ids instead of the ids.
 template<>
 void LookupExecutor<SparseParam>::genericBackward(vector<dtype*> &grads) {
-        cuda::LookupBackward(id_arr_.value, grads, batch.size(), getRow(), col_arr_.value,
-                max_col_, param().grad().value, param().dIndexers->value);
+        vector<int> slots;
+        slots.reserve(ids_.size());
+        for (int id : ids_) {
+            slots.push_back(id < 0 ? -1 : param().gradSlot(id));
+        }
+        slot_arr_.init(slots.data(), slots.size());
+        cuda::LookupBackward(slot_arr_.value, grads, batch.size(), getRow(), col_arr_.value,
+                max_col_, param().deviceGradColumns(), nullptr);
 }
 
 template<>
@@ -236,13 +275,30 @@ void LookupExecutor<Param>::genericBackward(vector<dtype*> &grads) {
                 max_col_, param().grad().value, nullptr);
 }
 
+#if TEST_CUDA
+template<>
+void LookupExecutor<SparseParam>::verifyBackward() {
+    cuda::Assert(param().verifyGrad("lookup backward grad"));
+}
+
+template<>
+void LookupExecutor<Param>::verifyBackward() {
+    cuda::Assert(param().grad().verify("lookup backward grad"));
+}
+#endif
+
 #else
 class LookupExecutor :public Executor {
 public:
-    int calculateFLOPs() override {
+    int64_t calculateFLOPs() override {
         return 0;
     }
 
+    /// The rows read from the param and the vals written.
+    int64_t calculateBytes() override {
+        return 2 * elementCount() * sizeof(dtype);
+    }
+
     int calculateActivations() override {
         return 0;
     }
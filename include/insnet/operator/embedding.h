@@ -4,6 +4,7 @@
 #include "insnet/param/sparse-param.h"
 #include "insnet/param/param.h"
 #include "insnet/nlp/vocab.h"
+#include "insnet/nlp/embedding-file.h"
 #include "insnet/computation-graph/graph.h"
 #include "insnet/util/util.h"
 
@@ -68,6 +69,14 @@ public:
         initWeights(inFile, fineTune, norm);
     }
 
+    void init(const Vocab &alpha, const EmbeddingFile &file, bool fineTune = true,
+            dtype norm = -1) {
+        vocab = alpha;
+        nVSize = vocab.size();
+        nUNKId = vocab.from_string(UNKNOWN_WORD);
+        initWeights(file, fineTune, norm);
+    }
+
     void initWeights(int dim, bool tune) {
         if (dim <=0 || nVSize == 0 || (nVSize == 1 && nUNKId >= 0)) {
             std::cerr << fmt::format("Embedding initWeights - dim:{} size:{}\n", dim, nVSize);
@@ -84,78 +93,127 @@ public:
 #endif
     }
 
+    /// Initialize the weights with the pretrained vectors in the text embedding file, which is parsed by multiple threads block by block.
     void initWeights(const std::string& inFile, bool tune, dtype norm = -1) {
-        if (nVSize == 0 || (nVSize == 1 && nUNKId >= 0)) {
-            std::cout << "nVSize:" << nVSize << " nUNKId:" << nUNKId << std::endl;
-            std::cerr << "please check the alphabet" << std::endl;
-            abort();
-        }
+        int dim = textEmbeddingDim(inFile);
+        initPretrainedWeights(dim, [&](const PretrainedVisitor &visit) {
+            readTextEmbeddingFile(inFile, visit);
+        }, tune, norm);
+    }
 
-        std::ifstream inf;
-        inf.open(inFile.c_str());
+    /// Initialize the weights with the pretrained vectors in the binary embedding file, which is typically converted by the convert-embedding tool.
+    void initWeights(const EmbeddingFile &file, bool tune, dtype norm = -1) {
+        initPretrainedWeights(file.dim(), [&](const PretrainedVisitor &visit) {
+            for (int i = 0; i < file.size(); ++i) {
+                visit(file.word(i), file.vec(i));
+            }
+        }, tune, norm);
+    }
 
-        if (!inf.is_open()) {
-            std::cerr << "please check the input file" << std::endl;
+    /// Initialize the frozen embedding table with all the words in the binary embedding file.
+    ///
+    /// On CPU, the weights directly alias the memory-mapped vectors without being allocated, so neither loading time nor memory grows with the vocabulary, and the weights are read-only, i.e., E is frozen and its optimizer steps abort. On GPU, they are copied to the device.
+    void initFrozen(const std::shared_ptr<EmbeddingFile> &file) {
+        std::vector<std::string> words = file->words();
+        vocab = Vocab();
+        vocab.init(words);
+        nVSize = vocab.size();
+        nUNKId = vocab.find(UNKNOWN_WORD);
+        nDim = file->dim();
+        if (nVSize == 0 || nDim <= 0) {
+            std::cerr << fmt::format("Embedding initFrozen - dim:{} size:{}\n", nDim, nVSize);
             abort();
         }
+        std::cout << fmt::format("initFrozen dim:{} vocabulary_size:{}\n", nDim, nVSize);
+#if USE_GPU
+        E.init(nDim, nVSize);
+        std::copy(file->vec(0), file->vec(0) + nDim * nVSize, E.val().v);
+        E.val().copyFromHostToDevice();
+#else
+        E.initFrozenView(file->vec(0), nDim, nVSize, file);
+#endif
+        bFineTune = false;
+        inited = true;
+    }
 
-        std::string strLine, curWord;
-        std::vector<std::string> sLines;
-        while (1) {
-            if (!my_getline(inf, strLine)) {
-                break;
-            }
-            if (!strLine.empty()) {
-                sLines.push_back(strLine);
-            }
+    std::vector<Tunable<BaseParam>*> tunableComponents() override {
+        if (bFineTune) {
+            return {&E};
+        } else {
+            return {};
         }
-        inf.close();
-        if (sLines.size() == 0) {
-            std::cerr << "sLines size is 0" << std::endl;
+    }
+
+    int getElemId(const std::string& strFeat) const {
+        int id = vocab.find(strFeat);
+        return id < 0 ? nUNKId : id;
+    }
+
+    /// Returns the IDs of *words* in batch, using nUNKId for the words not found.
+    std::vector<int> getElemIds(const std::vector<std::string> &words) const {
+        return vocab.lookup(words, nUNKId);
+    }
+
+    bool findElemId(const std::string &str) const {
+        return vocab.find_string(str);
+    }
+
+    template<typename Archive>
+    void save(Archive &ar) const {
+        ar(bFineTune, nDim, nVSize, nUNKId, vocab, E);
+    }
+
+    template<typename Archive>
+    void load(Archive &ar) {
+        ar(bFineTune, nDim, nVSize, nUNKId, vocab);
+        E.init(nDim, nVSize);
+        ar(E);
+    }
+
+private:
+    using PretrainedVisitor = std::function<void(const std::string &, const dtype *)>;
+
+    /// Initialize the weights with the pretrained vectors passed to the visitor by *for_each*, using the averaged value for OOV words.
+    void initPretrainedWeights(int dim,
+            const std::function<void(const PretrainedVisitor &)> &for_each, bool tune,
+            dtype norm) {
+        if (nVSize == 0 || (nVSize == 1 && nUNKId >= 0)) {
+            std::cout << "nVSize:" << nVSize << " nUNKId:" << nUNKId << std::endl;
+            std::cerr << "please check the alphabet" << std::endl;
             abort();
         }
 
-        //find the first line, decide the wordDim;
-        std::vector<std::string>::iterator it = sLines.begin();
-        sLines.erase(it);
-        std::vector<std::string> vecInfo;
-        split_bychar(sLines[0], vecInfo, ' ');
-        nDim = vecInfo.size() - 1;
-
+        nDim = dim;
         std::cout << fmt::format("nDim:{} nVSize:{}", nDim, nVSize);
         E.init(nDim, nVSize);
 
         std::cout << "word embedding dim is " << nDim << std::endl;
 
         bool bHasUnknown = false;
-        std::unordered_set<int> indexers;
+        std::vector<bool> found(nVSize, false);
         nr::NRVec<dtype> sum(nDim);
         sum = 0.0;
         int count = 0;
-        for (int idx = 0; idx < sLines.size(); idx++) {
-            split_bychar(sLines[idx], vecInfo, ' ');
-            if (vecInfo.size() != nDim + 1) {
-                std::cout << "error embedding file" << std::endl;
-            }
-            curWord = vecInfo[0];
-            if (vocab.find_string(curWord)) {
-                int wordId = vocab.insert_string(curWord);
+        for_each([&](const std::string &word, const dtype *vec) {
+            int wordId = vocab.find(word);
+            if (wordId >= 0) {
+                if (found.at(wordId)) {
+                    return;
+                }
                 count++;
                 if (nUNKId == wordId) {
                     bHasUnknown = true;
                 }
-                indexers.insert(wordId);
+                found.at(wordId) = true;
 
                 for (int idy = 0; idy < nDim; idy++) {
-                    dtype curValue = atof(vecInfo[idy + 1].c_str());
-                    sum[idy] += curValue;
-                    E.val()[wordId][idy] += curValue;
+                    sum[idy] += vec[idy];
+                    E.val()[wordId][idy] = vec[idy];
                 }
             }
-        }
+        });
 
         if (count == 0) {
-            E.val().random(std::sqrt(3.0 / nDim));
             std::cout << "find no overlapped lexicons in the embedding file" << std::endl;
             abort();
         }
@@ -164,15 +222,14 @@ public:
             for (int idx = 0; idx < nDim; idx++) {
                 E.val()[nUNKId][idx] = sum[idx] / (count + 1);
             }
-            indexers.insert(nUNKId);
+            found.at(nUNKId) = true;
             count++;
             std::cout << UNKNOWN_WORD << " not found, using averaged value to initialize." << std::endl;
         }
 
-
         int oovWords = 0;
         for (int id = 0; id < nVSize; id++) {
-            if (indexers.find(id) == indexers.end()) {
+            if (!found.at(id)) {
                 oovWords++;
                 for (int idy = 0; idy < nDim; idy++) {
                     E.val()[id][idy] = nUNKId >= 0 ? E.val()[nUNKId][idy] : sum[idy] / (count + 1);
@@ -180,7 +237,6 @@ public:
             }
         }
 
-
         std::cout << "OOV num is " << oovWords << ", total num is " << nVSize << ", embedding oov ratio is " << oovWords * 1.0 / nVSize << std::endl;
         std::cout << "unknown id" << nUNKId << std::endl;
         bFineTune = tune;
@@ -191,34 +247,6 @@ public:
         E.val().copyFromHostToDevice();
 #endif
     }
-
-    std::vector<Tunable<BaseParam>*> tunableComponents() override {
-        if (bFineTune) {
-            return {&E};
-        } else {
-            return {};
-        }
-    }
-
-    int getElemId(const std::string& strFeat) const {
-        return vocab.find_string(strFeat) ? vocab.from_string(strFeat) : nUNKId;
-    }
-
-    bool findElemId(const std::string &str) const {
-        return vocab.find_string(str);
-    }
-
-    template<typename Archive>
-    void save(Archive &ar) const {
-        ar(bFineTune, nDim, nVSize, nUNKId, vocab, E);
-    }
-
-    template<typename Archive>
-    void load(Archive &ar) {
-        ar(bFineTune, nDim, nVSize, nUNKId, vocab);
-        E.init(nDim, nVSize);
-        ar(E);
-    }
 };
 
 /// \ingroup operator
@@ -1,8 +1,11 @@
 #include "insnet/operator/layer_normalization.h"
+#include "insnet/operator/split.h"
 
 using std::string;
 using std::to_string;
 using std::vector;
+using std::pair;
+using std::make_pair;
 using std::cout;
 using std::cerr;
 using std::endl;
@@ -27,6 +30,10 @@ public:
 
     Executor *generate() override;
 
+    vector<BaseParam *> params() override {
+        return {};
+    }
+
     string typeSignature() const override {
         return Node::getNodeType() + to_string(size() / getColumn());
     }
@@ -156,6 +163,11 @@ public:
 #endif
     }
 
+    /// The mean, the deviations and their squares, the variance and the normalization.
+    int64_t calculateFLOPs() override {
+        return 6 * elementCount();
+    }
+
 private:
     Tensor1D sds_;
     cuda::NumberPointerArray val_arr_;
@@ -166,6 +178,7 @@ private:
 class LayerNormExecutor : public Executor {
 public:
     void forward() override {
+        col_sum_ = 0;
         for (Node *node : batch) {
             col_sum_ += node->getColumn();
         }
@@ -212,8 +225,15 @@ public:
         }
     }
 
-    int calculateFLOPs() override {
-        return 0; // TODO
+    /// The mean, the deviations and their squares, the variance and the normalization.
+    int64_t calculateFLOPs() override {
+        return 6 * elementCount();
+    }
+
+    int64_t releaseForwardStates() override {
+        int64_t size = sds_.dim;
+        sds_.releaseMemory();
+        return size;
     }
 
 private:
@@ -255,6 +275,10 @@ public:
 
     Executor *generate() override;
 
+    vector<BaseParam *> params() override {
+        return {&params_->g(), &params_->b()};
+    }
+
     string typeSignature() const override {
         return Node::getNodeType() + "-" + addressToString(params_);
     }
@@ -345,6 +369,14 @@ public:
 #endif
     }
 
+    int64_t calculateFLOPs() override {
+        return 2 * elementCount();
+    }
+
+    int64_t calculateBytes() override {
+        return Executor::calculateBytes() + 2 * getRow() * sizeof(dtype);
+    }
+
 private:
     vector<dtype *> in_vals_;
     cuda::NumberPointerArray in_val_arr_;
@@ -358,8 +390,12 @@ private:
 #else
 class PointwiseLinearExecutor : public Executor {
 public:
-    int calculateFLOPs() override {
-        return 0; // TODO
+    int64_t calculateFLOPs() override {
+        return 2 * elementCount();
+    }
+
+    int64_t calculateBytes() override {
+        return Executor::calculateBytes() + 2 * getRow() * sizeof(dtype);
     }
 
     void backward() override {
@@ -378,6 +414,231 @@ Executor *PointwiseLinearNode::generate() {
     return new PointwiseLinearExecutor;
 }
 
+/// The val's first half holds the normalized columns and the second half the pre-normalization sums, so that the sum is written by the same pass and exposed as a view instead of being recomputed by *add*.
+class AddLayerNormNode : public Node, public Poolable<AddLayerNormNode> {
+public:
+    AddLayerNormNode() : Node("add-layernorm") {}
+
+    void setNodeDim(int dim) override {
+        Node::setDim(dim);
+    }
+
+    void connect(Node &a, Node &b) {
+        if (a.size() * 2 != size() || b.size() * 2 != size()) {
+            cerr << fmt::format("AddLayerNormNode connect - a size:{} b size:{} dim:{}\n",
+                    a.size(), b.size(), size());
+            abort();
+        }
+        vector<Node *> ins = {&a, &b};
+        setInputs(ins);
+        afterConnect(ins);
+    }
+
+    void compute() override {
+        int row = getRow();
+        int col = sumColumnOffset();
+        means_.resize(col);
+        sds_.resize(col);
+        for (int j = 0; j < col; ++j) {
+            dtype *a = input_vals_.at(0)->v + j * row;
+            dtype *b = input_vals_.at(1)->v + j * row;
+            dtype *sum = val().v + (col + j) * row;
+            dtype mean = 0, m2 = 0;
+            for (int k = 0; k < row; ++k) {
+                dtype x = a[k] + b[k];
+                sum[k] = x;
+                dtype delta = x - mean;
+                mean += delta / (k + 1);
+                m2 += delta * (x - mean);
+            }
+            dtype sd = sqrt(m2 / row);
+            means_.at(j) = mean;
+            sds_.at(j) = sd;
+            Vec(val().v + j * row, row) = ((Vec(sum, row) - mean) / sd) *
+                params_->g().val().vec() + params_->b().val().vec();
+        }
+    }
+
+    void backward() override {
+        Tensor1D x_hat, x_hat_grad, in_grad;
+        x_hat.init(getRow());
+        x_hat_grad.init(getRow());
+        in_grad.init(getRow());
+        backward(x_hat, x_hat_grad, in_grad);
+    }
+
+    /// Backward with the scratches of a column, which are shared by the nodes of a batch.
+    void backward(Tensor1D &x_hat, Tensor1D &x_hat_grad, Tensor1D &in_grad) {
+        int row = getRow();
+        int col = sumColumnOffset();
+        for (int j = 0; j < col; ++j) {
+            Vec grad(getGrad().v + j * row, row);
+            x_hat.vec() = (Vec(val().v + (col + j) * row, row) - means_.at(j)) / sds_.at(j);
+            x_hat_grad.vec() = grad * params_->g().val().vec();
+            dtype x_hat_grad_mean = x_hat_grad.mat().sum() / row;
+            dtype product_mean = x_hat_grad.mat().col(0).dot(x_hat.mat().col(0)) / row;
+            in_grad.vec() = (x_hat_grad.vec() - x_hat_grad_mean - x_hat.vec() * product_mean) /
+                sds_.at(j) + Vec(getGrad().v + (col + j) * row, row);
+            Vec(input_grads_.at(0)->v + j * row, row) += in_grad.vec();
+            Vec(input_grads_.at(1)->v + j * row, row) += in_grad.vec();
+            params_->g().grad().vec() += grad * x_hat.vec();
+            params_->b().grad().vec() += grad;
+        }
+    }
+
+    Executor *generate() override;
+
+    vector<BaseParam *> params() override {
+        return {&params_->g(), &params_->b()};
+    }
+
+    string typeSignature() const override {
+        return Node::getNodeType() + "-" + addressToString(params_);
+    }
+
+    LayerNormParams *params_;
+
+protected:
+    /// Backward reads the sums kept in the val instead of the inputs.
+    int forwardOnlyInputValSize() override {
+        return 2;
+    }
+
+    bool isValForwardOnly() const override {
+        return false;
+    }
+
+private:
+    /// The column where the sums begin, i.e., the column number of either input.
+    int sumColumnOffset() const {
+        return getColumn() / 2;
+    }
+
+    vector<dtype> means_, sds_;
+    friend class AddLayerNormExecutor;
+};
+
+#if USE_GPU
+class AddLayerNormExecutor : public Executor {
+public:
+    void forward() override {
+#if TEST_CUDA
+        testForwardInpputs();
+#endif
+        int count = batch.size();
+        vector<dtype *> a_vals(count), b_vals(count), vals(count);
+        vector<int> cols(count);
+        int i = 0;
+        for (Node *node : batch) {
+            AddLayerNormNode &n = dynamic_cast<AddLayerNormNode &>(*node);
+            a_vals.at(i) = n.input_vals_.at(0)->value;
+            b_vals.at(i) = n.input_vals_.at(1)->value;
+            cols.at(i) = n.sumColumnOffset();
+            vals.at(i++) = n.getVal().value;
+        }
+        cuda::NumberPointerArray a_val_arr, b_val_arr;
+        a_val_arr.init(a_vals.data(), count);
+        b_val_arr.init(b_vals.data(), count);
+        col_arr_.init(cols.data(), count);
+        max_col_ = *max_element(cols.begin(), cols.end());
+        means_.init(count * max_col_);
+        sds_.init(count * max_col_);
+        val_arr_.init(vals.data(), count);
+
+        cuda::AddLayerNormForward(a_val_arr.value, b_val_arr.value, count, getRow(),
+                col_arr_.value, max_col_, params().g().val().value, params().b().val().value,
+                val_arr_.value, means_.value, sds_.value);
+#if TEST_CUDA
+        testForward();
+#endif
+    }
+
+    void backward() override {
+        params().g().initAndZeroGrad();
+        params().b().initAndZeroGrad();
+        int count = batch.size();
+        vector<dtype *> grads(count), a_grads(count), b_grads(count);
+        int i = 0;
+        for (Node *node : batch) {
+            AddLayerNormNode &n = dynamic_cast<AddLayerNormNode &>(*node);
+            grads.at(i) = n.getGrad().value;
+            a_grads.at(i) = n.input_grads_.at(0)->value;
+            b_grads.at(i++) = n.input_grads_.at(1)->value;
+        }
+        cuda::NumberPointerArray grad_arr, a_grad_arr, b_grad_arr;
+        grad_arr.init(grads.data(), count);
+        a_grad_arr.init(a_grads.data(), count);
+        b_grad_arr.init(b_grads.data(), count);
+
+        cuda::AddLayerNormBackward(grad_arr.value, val_arr_.value, count, getRow(),
+                col_arr_.value, max_col_, params().g().val().value, means_.value, sds_.value,
+                a_grad_arr.value, b_grad_arr.value, params().g().grad().value,
+                params().b().grad().value);
+#if TEST_CUDA
+        testBackward();
+        params().g().grad().verify("AddLayerNormExecutor backward g");
+        params().b().grad().verify("AddLayerNormExecutor backward bias");
+#endif
+    }
+
+    /// The addition, the layer normalization and the pointwise linear transformation.
+    int64_t calculateFLOPs() override {
+        return 9 * elementCount() / 2;
+    }
+
+    int64_t calculateBytes() override {
+        return Executor::calculateBytes() + 2 * getRow() * sizeof(dtype);
+    }
+
+private:
+    LayerNormParams &params() {
+        return *dynamic_cast<AddLayerNormNode *>(batch.front())->params_;
+    }
+
+    cuda::NumberPointerArray val_arr_;
+    cuda::IntArray col_arr_;
+    Tensor1D means_, sds_;
+    int max_col_;
+};
+#else
+class AddLayerNormExecutor : public Executor {
+public:
+    /// The addition, the layer normalization and the pointwise linear transformation.
+    int64_t calculateFLOPs() override {
+        return 9 * elementCount() / 2;
+    }
+
+    int64_t calculateBytes() override {
+        return Executor::calculateBytes() + 2 * getRow() * sizeof(dtype);
+    }
+
+    void backward() override {
+        params().g().initAndZeroGrad();
+        params().b().initAndZeroGrad();
+        for (Tensor1D *t : {&x_hat_, &x_hat_grad_, &in_grad_}) {
+            if (!t->isInitialized()) {
+                t->init(getRow());
+            }
+        }
+        for (Node *node : batch) {
+            dynamic_cast<AddLayerNormNode &>(*node).backward(x_hat_, x_hat_grad_, in_grad_);
+        }
+    }
+
+private:
+    LayerNormParams &params() {
+        return *dynamic_cast<AddLayerNormNode *>(batch.front())->params_;
+    }
+
+    /// The scratches of a column, allocated once per executor instead of once per node.
+    Tensor1D x_hat_, x_hat_grad_, in_grad_;
+};
+#endif
+
+Executor *AddLayerNormNode::generate() {
+    return new AddLayerNormExecutor;
+}
+
 Node *layerNorm(Node &input, LayerNormParams &params) {
     int row = params.g().row();
     return affine(*layerNorm(input, row), params);
@@ -411,4 +672,19 @@ Node *affine(Node &input, LayerNormParams &params) {
     return b;
 }
 
+pair<Node *, Node *> addLayerNorm(Node &a, Node &b, LayerNormParams &params) {
+    AddLayerNormNode *node = AddLayerNormNode::newNode(2 * a.size());
+    int row = params.g().row();
+    int col = a.size() / row;
+    if (col * row != a.size()) {
+        cerr << fmt::format("addLayerNorm - col:{} row:{} input size:{}\n", col, row, a.size()) <<
+            endl;
+        abort();
+    }
+    node->setColumn(2 * col);
+    node->params_ = &params;
+    node->connect(a, b);
+    return make_pair(split(*node, a.size(), 0), split(*node, a.size(), a.size()));
+}
+
 }
@@ -71,6 +71,18 @@ Node *layerNorm(Node &input, int row);
 /// \return The affine transformed normalized tensor. Its size is equal to input.size().
 Node *layerNorm(Node &input, LayerNormParams &params);
 
+/// \ingroup operator
+/// The fused residual addition and layer normalization with the parameters of the subsequent *affine* transformation, i.e., layerNorm(*add({a, b}), params) computed by a single operator.
+///
+/// The mean and standard deviation are computed in one pass with Welford's algorithm, which also writes the sum, so that the sum can serve as the residual of the next sublayer without calling *add*.
+///
+/// **The operators with the same parameters will be executed in batch.**
+/// \param a The residual tensor.
+/// \param b The sublayer output tensor. Its size should be equal to a.size().
+/// \param params g and b.
+/// \return The affine transformed normalized tensor of a + b and the sum a + b, both views of the fused operator's result. Their sizes are equal to a.size().
+std::pair<Node *, Node *> addLayerNorm(Node &a, Node &b, LayerNormParams &params);
+
 /// \ingroup operator
 /// The affine transformation in layer normalization. \f$[{x_0}{g_0}, {x_1}{g_1}, ..., {x_n}{g_n}] + [b_0, b_1, ..., b_n]\f$
 ///
@@ -1,4 +1,5 @@
 #include "insnet/operator/linear.h"
+#include <mutex>
 
 using std::function;
 using std::cerr;
@@ -8,6 +9,8 @@ using std::string;
 using std::map;
 using std::make_pair;
 using std::cout;
+using std::mutex;
+using std::lock_guard;
 
 namespace insnet {
 
@@ -97,6 +100,14 @@ public:
         return param_->biasEnabled() ? &param_->b() : nullptr;
     }
 
+    vector<BaseParam *> params() override {
+        if (b() == nullptr) {
+            return {&W()};
+        } else {
+            return {&W(), b()};
+        }
+    }
+
 protected:
     virtual bool isDimLegal(const Node &input) const override {
         return true;
@@ -115,6 +126,31 @@ private:
 };
 
 class LinearExecutorBase : public Executor {
+public:
+    int64_t calculateFLOPs() override {
+        int64_t flops = 2 * static_cast<int64_t>(inDim()) * outDim() * colSum();
+        if (b() != nullptr) {
+            flops += static_cast<int64_t>(outDim()) * colSum();
+        }
+        return flops;
+    }
+
+    /// W is read once for the whole batch, in bfloat16 if the graph reads the bfloat16 copies.
+    int64_t calculateBytes() override {
+        int64_t w_size = sizeof(dtype);
+#if !USE_GPU
+        if (batch.front()->getNodeContainer().isBFloat16Compute() && W().hasBFloat16Copy()) {
+            w_size = sizeof(bfloat16);
+        }
+#endif
+        int64_t bytes = w_size * inDim() * outDim() +
+            static_cast<int64_t>(inDim() + outDim()) * colSum() * sizeof(dtype);
+        if (b() != nullptr) {
+            bytes += outDim() * sizeof(dtype);
+        }
+        return bytes;
+    }
+
 protected:
     Param &W() {
         LinearNode &l = dynamic_cast<LinearNode &>(*batch.front());
@@ -133,6 +169,14 @@ protected:
     int outDim() {
         return W().inDim();
     }
+
+    int colSum() {
+        int sum = 0;
+        for (Node *node : batch) {
+            sum += node->getColumn();
+        }
+        return sum;
+    }
 };
 
 #if USE_GPU
@@ -295,23 +339,15 @@ private:
 #else
 class LinearExecutor : public LinearExecutorBase {
 public:
-    int calculateFLOPs() override {
-        int flops = W().inDim() * W().outDim() * batch.size() * 2;
-        if (b() != nullptr) {
-            flops += W().inDim() * batch.size();
-        }
-        return flops;
-    }
-
     void  forward() override {
         Tensor2D y;
         int count = batch.size();
+        col_sum_ = 0;
         for (Node *node : batch) {
             col_sum_ += node->getColumn();
         }
         x_.init(inDim(), col_sum_);
         y.init(outDim(), col_sum_);
-        b_.init(outDim(), col_sum_);
 
         int col_offset = 0;
         for (int i = 0; i < count; i++) {
@@ -321,16 +357,16 @@ public:
             col_offset += l.getColumn();
         }
 
-        if (b() != nullptr) {
-            for (int i = 0; i < col_sum_; ++i) {
-                Vec(b_.v + i * outDim(), outDim()) = b()->val().vec();
-            }
+        if (batch.front()->getNodeContainer().isBFloat16Compute() && W().hasBFloat16Copy()) {
+            bfloat16Forward(y);
+        } else {
+            y.mat() = W().val().mat().transpose() * x_.mat();
         }
 
-        y.mat() = W().val().mat().transpose() * x_.mat();
-
         if (b() != nullptr) {
-            y.vec() += b_.vec();
+            for (int i = 0; i < col_sum_; ++i) {
+                Vec(y.v + i * outDim(), outDim()) += b()->val().vec();
+            }
         }
 
         col_offset = 0;
@@ -377,9 +413,30 @@ public:
         }
     }
 
+    /// Release x_, the copy of the inputs for W's grad.
+    int64_t releaseForwardStates() override {
+        int64_t size = x_.size;
+        x_.release();
+        return size;
+    }
+
 private:
+    /// Multiply the bfloat16 copy of W by x_ block by block, converting each block of W's columns to dtype, so that W is read from memory once in bfloat16 while the GEMM accumulates in dtype.
+    void bfloat16Forward(Tensor2D &y) {
+        const int block_size = 64;
+        const bfloat16 *w = W().bfloat16Copy();
+        vector<dtype> block(static_cast<size_t>(inDim()) * block_size);
+        for (int begin = 0; begin < outDim(); begin += block_size) {
+            int size = std::min(block_size, outDim() - begin);
+            toFloat(w + static_cast<int64_t>(begin) * inDim(),
+                    static_cast<int64_t>(size) * inDim(), block.data());
+            y.mat().middleRows(begin, size) = Mat(block.data(), inDim(), size).transpose() *
+                x_.mat();
+        }
+    }
+
     int col_sum_ = 0;
-    Tensor2D x_, b_;
+    Tensor2D x_;
 };
 #endif
 
@@ -420,6 +477,10 @@ public:
 
     Executor *generate() override;
 
+    vector<BaseParam *> params() override {
+        return {bias_param_};
+    }
+
     void setParam(BiasParam &param) {
         bias_param_ = &param;
         if (size() % bias_param_->row() != 0) {
@@ -508,10 +569,6 @@ private:
 #else
 class BiasExecutor : public Executor {
 public:
-    int calculateFLOPs() override {
-        return defaultFLOPs();
-    }
-
     void backward() override {
         BiasNode &node = dynamic_cast<BiasNode&>(*batch.front());
         node.bias_param_->initAndZeroGrad();
@@ -547,14 +604,18 @@ Node *linear(Node &input, Param &param) {
     }
 
     static map<void *, LinearParams *> param_map;
-    auto it = param_map.find(&param);
+    static mutex param_map_mutex;
     LinearParams *uni_params;
-    if (it == param_map.end()) {
-        uni_params = new LinearParams("uni" + addressToString(&param));
-        uni_params->init(param);
-        param_map.insert(make_pair(&param, uni_params));
-    } else {
-        uni_params = it->second;
+    {
+        lock_guard<mutex> lock(param_map_mutex);
+        auto it = param_map.find(&param);
+        if (it == param_map.end()) {
+            uni_params = new LinearParams("uni" + addressToString(&param));
+            uni_params->init(param);
+            param_map.insert(make_pair(&param, uni_params));
+        } else {
+            uni_params = it->second;
+        }
     }
 
     int col = input.size() / param.outDim();
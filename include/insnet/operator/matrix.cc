@@ -13,6 +13,15 @@ using std::pair;
 
 namespace insnet {
 
+namespace {
+
+/// Returns the distance between the beginnings of two adjacent columns of the matrix with *row* rows.
+int strideOf(const Tensor1D &tensor, int row) {
+    return tensor.stride == 0 ? row : tensor.stride;
+}
+
+}
+
 class MatrixExecutor : public Executor {
 public:
     int getRow() const {
@@ -29,6 +38,20 @@ public:
     }
 };
 
+/// The executors of the matmul nodes, each element of which is the dot product of two vectors of the node's innerDim().
+template<typename NodeType>
+class MatMulExecutorBase : public Executor {
+public:
+    int64_t calculateFLOPs() override {
+        int64_t sum = 0;
+        for (Node *node : batch) {
+            NodeType &m = dynamic_cast<NodeType &>(*node);
+            sum += 2 * static_cast<int64_t>(m.innerDim()) * m.size();
+        }
+        return sum;
+    }
+};
+
 class MatrixMulMatrixNode : public Node, public Poolable<MatrixMulMatrixNode> {
 public:
     MatrixMulMatrixNode() : Node("MatrixMulMatrixNode") {}
@@ -54,19 +77,36 @@ public:
     void compute() override {
         a_row_ = input_dims_.at(0) / k_;
         b_col_ = input_dims_.at(1) / k_;
-        Mat(getVal().v, a_row_, b_col_) = Mat(input_vals_.at(0)->v, a_row_, k_) *
+        val().stridedMat(a_row_) = input_vals_.at(0)->stridedMat(a_row_) *
             Mat(input_vals_.at(1)->v, k_, b_col_);
     }
 
     void backward() override {
-        Mat(input_grads_.at(0)->v, a_row_, k_) += Mat(getGrad().v, a_row_, b_col_) *
+        input_grads_.at(0)->stridedMat(a_row_) += grad().stridedMat(a_row_) *
             Mat(input_vals_.at(1)->v, k_, b_col_).transpose();
         Mat(input_grads_.at(1)->v, k_, b_col_) +=
-            Mat(input_vals_.at(0)->v, a_row_, k_).transpose() * Mat(getGrad().v, a_row_, b_col_);
+            input_vals_.at(0)->stridedMat(a_row_).transpose() * grad().stridedMat(a_row_);
     }
 
     Executor * generate() override;
 
+    vector<BaseParam *> params() override {
+        return {};
+    }
+
+    int innerDim() const {
+        return k_;
+    }
+
+    /// The stride of a and that of the val are taken into account, but not that of b.
+    bool isStridedInputSupported(int i) const override {
+        return i == 0;
+    }
+
+    bool isStridedValSupported() const override {
+        return true;
+    }
+
     string typeSignature() const override {
         return Node::getNodeType() + to_string(input_dims_.at(0) / k_);
     }
@@ -106,7 +146,7 @@ public:
 };
 
 #if USE_GPU
-class MatrixMulMatrixExecutor : public Executor {
+class MatrixMulMatrixExecutor : public MatMulExecutorBase<MatrixMulMatrixNode> {
 public:
     void forward() override {
         int count = batch.size();
@@ -116,6 +156,10 @@ public:
         vals.reserve(count);
         ks_.reserve(count);
         b_cols_.reserve(count);
+        a_strides_.reserve(count);
+        strides_.reserve(count);
+        MatrixMulMatrixNode &first = dynamic_cast<MatrixMulMatrixNode &>(*batch.front());
+        row_ = first.input_dims_.at(0) / first.k_;
         for (Node *node : batch) {
             MatrixMulMatrixNode &m = dynamic_cast<MatrixMulMatrixNode &>(*node);
             a_vals_.push_back(m.input_vals_.at(0)->value);
@@ -123,14 +167,15 @@ public:
             vals.push_back(m.getVal().value);
             ks_.push_back(m.k_);
             b_cols_.push_back(m.input_dims_.at(1) / m.k_);
+            a_strides_.push_back(strideOf(*m.input_vals_.at(0), row_));
+            strides_.push_back(strideOf(m.getVal(), row_));
         }
-        MatrixMulMatrixNode &first = dynamic_cast<MatrixMulMatrixNode &>(*batch.front());
-        row_ = first.input_dims_.at(0) / first.k_;
 #if TEST_CUDA
         testForwardInpputs();
 #endif
 
-        cuda::MatrixMulMatrixForward(a_vals_, b_vals_, count, ks_, b_cols_, row_, vals);
+        cuda::MatrixMulMatrixForward(a_vals_, b_vals_, count, ks_, b_cols_, row_, a_strides_,
+                strides_, vals);
 #if TEST_CUDA
         testForward();
 #endif
@@ -154,7 +199,7 @@ public:
         testBeforeBackward();
 #endif
         cuda::MatrixMulMatrixBackward(grads, a_vals_, b_vals_, count, ks_, b_cols_, row_,
-                a_grads, b_grads);
+                a_strides_, strides_, a_grads, b_grads);
 
 #if TEST_CUDA
         cout << "testing matmul backward" << endl;
@@ -173,16 +218,11 @@ public:
 
 private:
     vector<dtype *> a_vals_, b_vals_;
-    vector<int> ks_, b_cols_;
+    vector<int> ks_, b_cols_, a_strides_, strides_;
     int row_;
 };
 #else
-class MatrixMulMatrixExecutor : public Executor {
-public:
-    int calculateFLOPs() override {
-        return 0; // TODO
-    }
-};
+class MatrixMulMatrixExecutor : public MatMulExecutorBase<MatrixMulMatrixNode> {};
 #endif
 
 Executor *MatrixMulMatrixNode::generate() {
@@ -206,8 +246,9 @@ public:
     void compute() override {
         a_col_ = input_dims_.at(0) / input_row_;
         b_col_ = input_dims_.at(1) / input_row_;
-        Mat(val().v, a_col_, b_col_) = Mat(input_vals_.at(0)->v, input_row_, a_col_).transpose()
-            * Mat(input_vals_.at(1)->v, input_row_, b_col_);
+        Mat(val().v, a_col_, b_col_) =
+            input_vals_.at(0)->stridedMat(input_row_).transpose() *
+            input_vals_.at(1)->stridedMat(input_row_);
         if (use_lower_triangular_mask_) {
             if (a_col_ != b_col_) {
                 cerr << fmt::format("a_col_:{} b_col_:{}\n", a_col_, b_col_);
@@ -222,15 +263,27 @@ public:
     }
 
     void backward() override {
-        Mat(input_grads_.at(0)->v, input_row_, a_col_) +=
-            Mat(input_vals_.at(1)->v, input_row_, b_col_) *
+        input_grads_.at(0)->stridedMat(input_row_) +=
+            input_vals_.at(1)->stridedMat(input_row_) *
             Mat(getGrad().v, a_col_, b_col_).transpose();
-        Mat(input_grads_.at(1)->v, input_row_, b_col_) +=
-            Mat(input_vals_.at(0)->v, input_row_, a_col_) * Mat(getGrad().v, a_col_, b_col_);
+        input_grads_.at(1)->stridedMat(input_row_) +=
+            input_vals_.at(0)->stridedMat(input_row_) * Mat(getGrad().v, a_col_, b_col_);
     }
 
     Executor * generate() override;
 
+    vector<BaseParam *> params() override {
+        return {};
+    }
+
+    int innerDim() const {
+        return input_row_;
+    }
+
+    bool isStridedInputSupported(int i) const override {
+        return true;
+    }
+
     string typeSignature() const override {
         return Node::getNodeType() + to_string(input_row_) +
             (use_lower_triangular_mask_ ? "-mask" : "-no-mask");
@@ -275,7 +328,7 @@ public:
 };
 
 #if USE_GPU
-class TranMatrixMulMatrixExecutor : public Executor {
+class TranMatrixMulMatrixExecutor : public MatMulExecutorBase<TranMatrixMulMatrixNode> {
 public:
     void forward() override {
         int count = batch.size();
@@ -296,10 +349,12 @@ public:
             vals.push_back(t.getVal().value);
             a_cols_.push_back(t.input_dims_.at(0) / input_row_);
             b_cols_.push_back(t.input_dims_.at(1) / input_row_);
+            a_strides_.push_back(strideOf(*t.input_vals_.at(0), input_row_));
+            b_strides_.push_back(strideOf(*t.input_vals_.at(1), input_row_));
         }
 
         cuda::TranMatrixMulMatrixForward(a_vals_, b_vals_, count, a_cols_, b_cols_, input_row_,
-                use_lower_triangular_mask_, vals);
+                a_strides_, b_strides_, use_lower_triangular_mask_, vals);
 
 #if TEST_CUDA
         testForward();
@@ -318,7 +373,7 @@ public:
             grads.push_back(t.getGrad().value);
         }
         cuda::TranMatrixMulMatrixBackward(grads, a_vals_, b_vals_, count, a_cols_, b_cols_,
-                input_row_, a_grads, b_grads);
+                input_row_, a_strides_, b_strides_, a_grads, b_grads);
 
 #if TEST_CUDA
         testBackward();
@@ -327,17 +382,12 @@ public:
 
 private:
     vector<dtype *> a_vals_, b_vals_;
-    vector<int> a_cols_, b_cols_;
+    vector<int> a_cols_, b_cols_, a_strides_, b_strides_;
     int input_row_;
     bool use_lower_triangular_mask_;
 };
 #else
-class TranMatrixMulMatrixExecutor : public Executor {
-public:
-    int calculateFLOPs() override {
-        abort();
-    }
-};
+class TranMatrixMulMatrixExecutor : public MatMulExecutorBase<TranMatrixMulMatrixNode> {};
 #endif
 
 Executor* TranMatrixMulMatrixNode::generate() {
@@ -394,4 +444,379 @@ BatchedNode *matrixMulMatrix(BatchedNode &a, BatchedNode &b, int k) {
     return node;
 }
 
+namespace {
+
+bool isBandedKeyLegal(int key, int query, int col, bool use_mask) {
+    return key >= 0 && key < col && (!use_mask || key <= query);
+}
+
+}
+
+class BandedTranMatrixMulMatrixNode : public Node,
+    public Poolable<BandedTranMatrixMulMatrixNode> {
+public:
+    BandedTranMatrixMulMatrixNode() : Node("BandedTranMatrixMulMatrixNode") {}
+
+    void setNodeDim(int dim) override {
+        setDim(dim);
+    }
+
+    void compute() override {
+        col_ = input_dims_.at(0) / input_row_;
+        int width = band_.width();
+        dtype *k = input_vals_.at(0)->v;
+        dtype *q = input_vals_.at(1)->v;
+        int k_stride = strideOf(*input_vals_.at(0), input_row_);
+        int q_stride = strideOf(*input_vals_.at(1), input_row_);
+        for (int j = 0; j < col_; ++j) {
+            int begin = band_.begin(j);
+            for (int t = 0; t < width; ++t) {
+                int key = begin + t;
+                dtype &score = val()[j * width + t];
+                if (isBandedKeyLegal(key, j, col_, use_lower_triangle_mask_)) {
+                    score = Mat(k + key * k_stride, input_row_, 1).col(0).dot(
+                            Mat(q + j * q_stride, input_row_, 1).col(0));
+                } else {
+                    score = -INF;
+                }
+            }
+        }
+    }
+
+    void backward() override {
+        int width = band_.width();
+        int k_stride = strideOf(*input_vals_.at(0), input_row_);
+        int q_stride = strideOf(*input_vals_.at(1), input_row_);
+        int k_grad_stride = strideOf(*input_grads_.at(0), input_row_);
+        int q_grad_stride = strideOf(*input_grads_.at(1), input_row_);
+        for (int j = 0; j < col_; ++j) {
+            int begin = band_.begin(j);
+            for (int t = 0; t < width; ++t) {
+                int key = begin + t;
+                if (!isBandedKeyLegal(key, j, col_, use_lower_triangle_mask_)) {
+                    continue;
+                }
+                dtype g = getGrad()[j * width + t];
+                Mat(input_grads_.at(0)->v + key * k_grad_stride, input_row_, 1) +=
+                    g * Mat(input_vals_.at(1)->v + j * q_stride, input_row_, 1);
+                Mat(input_grads_.at(1)->v + j * q_grad_stride, input_row_, 1) +=
+                    g * Mat(input_vals_.at(0)->v + key * k_stride, input_row_, 1);
+            }
+        }
+    }
+
+    Executor * generate() override;
+
+    vector<BaseParam *> params() override {
+        return {};
+    }
+
+    int innerDim() const {
+        return input_row_;
+    }
+
+    bool isStridedInputSupported(int i) const override {
+        return true;
+    }
+
+    string typeSignature() const override {
+        return Node::getNodeType() + to_string(input_row_) + "-" + band_.toString() +
+            (use_lower_triangle_mask_ ? "-mask" : "-no-mask");
+    }
+
+    int input_row_, col_;
+    AttentionBand band_;
+    bool use_lower_triangle_mask_ = false;
+
+protected:
+    int forwardOnlyInputValSize() override {
+        return 0;
+    }
+
+    bool isValForwardOnly() const override {
+        return true;
+    }
+
+private:
+    friend class BandedTranMatrixMulMatrixExecutor;
+};
+
+class BatchedBandedTranMatrixMulMatrixNode :
+    public BatchedNodeImpl<BandedTranMatrixMulMatrixNode> {
+public:
+    void init(BatchedNode &k, BatchedNode &q, int input_row, const AttentionBand &band,
+            bool use_lower_triangle_mask) {
+        int k_col = k.size() / input_row;
+        int q_col = q.size() / input_row;
+        if (k_col != q_col) {
+            cerr << fmt::format("BatchedBandedTranMatrixMulMatrixNode init k_col:{} q_col:{}\n",
+                    k_col, q_col);
+            abort();
+        }
+        allocateBatch(band.width() * q_col, q.batch().size());
+        setInputsPerNode({&k, &q});
+        for (Node *node : batch()) {
+            BandedTranMatrixMulMatrixNode &t = dynamic_cast<BandedTranMatrixMulMatrixNode &>(*node);
+            t.input_row_ = input_row;
+            t.band_ = band;
+            t.use_lower_triangle_mask_ = use_lower_triangle_mask;
+        }
+        afterInit({&k, &q});
+    }
+};
+
+#if USE_GPU
+class BandedTranMatrixMulMatrixExecutor :
+    public MatMulExecutorBase<BandedTranMatrixMulMatrixNode> {
+public:
+    void forward() override {
+        int count = batch.size();
+        vector<dtype *> vals;
+        vals.reserve(count);
+        k_vals_.reserve(count);
+        q_vals_.reserve(count);
+        cols_.reserve(count);
+        BandedTranMatrixMulMatrixNode &first =
+            dynamic_cast<BandedTranMatrixMulMatrixNode &>(*batch.front());
+        input_row_ = first.input_row_;
+        band_ = first.band_;
+        use_lower_triangle_mask_ = first.use_lower_triangle_mask_;
+        for (Node *node : batch) {
+            BandedTranMatrixMulMatrixNode &t = dynamic_cast<BandedTranMatrixMulMatrixNode &>(*node);
+            k_vals_.push_back(t.input_vals_.at(0)->value);
+            q_vals_.push_back(t.input_vals_.at(1)->value);
+            vals.push_back(t.getVal().value);
+            cols_.push_back(t.input_dims_.at(0) / input_row_);
+            k_strides_.push_back(strideOf(*t.input_vals_.at(0), input_row_));
+            q_strides_.push_back(strideOf(*t.input_vals_.at(1), input_row_));
+        }
+        cuda::BandedTranMatrixMulMatrixForward(k_vals_, q_vals_, count, cols_, input_row_,
+                k_strides_, q_strides_, band_.block_size, band_.left_blocks, band_.width(), use_lower_triangle_mask_,
+                vals);
+#if TEST_CUDA
+        testForward();
+#endif
+    }
+
+    void backward() override {
+        int count = batch.size();
+        vector<dtype *> grads, k_grads, q_grads;
+        grads.reserve(count);
+        k_grads.reserve(count);
+        q_grads.reserve(count);
+        for (Node *node : batch) {
+            BandedTranMatrixMulMatrixNode &t = dynamic_cast<BandedTranMatrixMulMatrixNode &>(*node);
+            grads.push_back(t.getGrad().value);
+            k_grads.push_back(t.input_grads_.at(0)->value);
+            q_grads.push_back(t.input_grads_.at(1)->value);
+        }
+        cuda::BandedTranMatrixMulMatrixBackward(grads, k_vals_, q_vals_, count, cols_, input_row_,
+                k_strides_, q_strides_, band_.block_size, band_.left_blocks, band_.width(), use_lower_triangle_mask_,
+                k_grads, q_grads);
+#if TEST_CUDA
+        testBackward();
+#endif
+    }
+
+private:
+    vector<dtype *> k_vals_, q_vals_;
+    vector<int> cols_, k_strides_, q_strides_;
+    int input_row_;
+    AttentionBand band_;
+    bool use_lower_triangle_mask_;
+};
+#else
+class BandedTranMatrixMulMatrixExecutor :
+    public MatMulExecutorBase<BandedTranMatrixMulMatrixNode> {};
+#endif
+
+Executor *BandedTranMatrixMulMatrixNode::generate() {
+    return new BandedTranMatrixMulMatrixExecutor;
+}
+
+class BandedMatrixMulMatrixNode : public Node, public Poolable<BandedMatrixMulMatrixNode> {
+public:
+    BandedMatrixMulMatrixNode() : Node("BandedMatrixMulMatrixNode") {}
+
+    void setNodeDim(int dim) override {
+        setDim(dim);
+    }
+
+    void compute() override {
+        col_ = size() / row_;
+        int width = band_.width();
+        const dtype *w = input_vals_.at(1)->v;
+        int v_stride = strideOf(*input_vals_.at(0), row_);
+        int stride = strideOf(val(), row_);
+        for (int j = 0; j < col_; ++j) {
+            Mat y(val().v + j * stride, row_, 1);
+            y.setZero();
+            int begin = band_.begin(j);
+            for (int t = 0; t < width; ++t) {
+                int key = begin + t;
+                if (key >= 0 && key < col_) {
+                    y += w[j * width + t] * Mat(input_vals_.at(0)->v + key * v_stride, row_, 1);
+                }
+            }
+        }
+    }
+
+    void backward() override {
+        int width = band_.width();
+        int v_stride = strideOf(*input_vals_.at(0), row_);
+        int v_grad_stride = strideOf(*input_grads_.at(0), row_);
+        int stride = strideOf(getGrad(), row_);
+        for (int j = 0; j < col_; ++j) {
+            Mat grad(getGrad().v + j * stride, row_, 1);
+            int begin = band_.begin(j);
+            for (int t = 0; t < width; ++t) {
+                int key = begin + t;
+                if (key >= 0 && key < col_) {
+                    Mat v(input_vals_.at(0)->v + key * v_stride, row_, 1);
+                    Mat(input_grads_.at(0)->v + key * v_grad_stride, row_, 1) +=
+                        (*input_vals_.at(1))[j * width + t] * grad;
+                    (*input_grads_.at(1))[j * width + t] += v.col(0).dot(grad.col(0));
+                }
+            }
+        }
+    }
+
+    Executor * generate() override;
+
+    vector<BaseParam *> params() override {
+        return {};
+    }
+
+    int innerDim() const {
+        return band_.width();
+    }
+
+    /// The stride of v and that of the val are taken into account, but not that of the weights.
+    bool isStridedInputSupported(int i) const override {
+        return i == 0;
+    }
+
+    bool isStridedValSupported() const override {
+        return true;
+    }
+
+    string typeSignature() const override {
+        return Node::getNodeType() + to_string(row_) + "-" + band_.toString();
+    }
+
+    int row_, col_;
+    AttentionBand band_;
+
+protected:
+    int forwardOnlyInputValSize() override {
+        return 0;
+    }
+
+    bool isValForwardOnly() const override {
+        return true;
+    }
+
+private:
+    friend class BandedMatrixMulMatrixExecutor;
+};
+
+class BatchedBandedMatrixMulMatrixNode : public BatchedNodeImpl<BandedMatrixMulMatrixNode> {
+public:
+    void init(BatchedNode &v, BatchedNode &weights, int row, const AttentionBand &band) {
+        int col = v.size() / row;
+        if (col * band.width() != weights.size()) {
+            cerr << fmt::format("BatchedBandedMatrixMulMatrixNode init col:{} width:{} weights size:{}\n",
+                    col, band.width(), weights.size());
+            abort();
+        }
+        allocateBatch(v.size(), v.batch().size());
+        setInputsPerNode({&v, &weights});
+        for (Node *node : batch()) {
+            BandedMatrixMulMatrixNode &m = dynamic_cast<BandedMatrixMulMatrixNode &>(*node);
+            m.row_ = row;
+            m.band_ = band;
+        }
+        afterInit({&v, &weights});
+    }
+};
+
+#if USE_GPU
+class BandedMatrixMulMatrixExecutor :
+    public MatMulExecutorBase<BandedMatrixMulMatrixNode> {
+public:
+    void forward() override {
+        int count = batch.size();
+        vector<dtype *> vals;
+        vals.reserve(count);
+        v_vals_.reserve(count);
+        w_vals_.reserve(count);
+        cols_.reserve(count);
+        BandedMatrixMulMatrixNode &first = dynamic_cast<BandedMatrixMulMatrixNode &>(*batch.front());
+        row_ = first.row_;
+        band_ = first.band_;
+        for (Node *node : batch) {
+            BandedMatrixMulMatrixNode &m = dynamic_cast<BandedMatrixMulMatrixNode &>(*node);
+            v_vals_.push_back(m.input_vals_.at(0)->value);
+            w_vals_.push_back(m.input_vals_.at(1)->value);
+            vals.push_back(m.getVal().value);
+            cols_.push_back(m.size() / row_);
+            v_strides_.push_back(strideOf(*m.input_vals_.at(0), row_));
+            strides_.push_back(strideOf(m.getVal(), row_));
+        }
+        cuda::BandedMatrixMulMatrixForward(v_vals_, w_vals_, count, cols_, row_, v_strides_,
+                strides_, band_.block_size, band_.left_blocks, band_.width(), vals);
+#if TEST_CUDA
+        testForward();
+#endif
+    }
+
+    void backward() override {
+        int count = batch.size();
+        vector<dtype *> grads, v_grads, w_grads;
+        grads.reserve(count);
+        v_grads.reserve(count);
+        w_grads.reserve(count);
+        for (Node *node : batch) {
+            BandedMatrixMulMatrixNode &m = dynamic_cast<BandedMatrixMulMatrixNode &>(*node);
+            grads.push_back(m.getGrad().value);
+            v_grads.push_back(m.input_grads_.at(0)->value);
+            w_grads.push_back(m.input_grads_.at(1)->value);
+        }
+        cuda::BandedMatrixMulMatrixBackward(grads, v_vals_, w_vals_, count, cols_, row_,
+                v_strides_, strides_, band_.block_size, band_.left_blocks, band_.width(), v_grads, w_grads);
+#if TEST_CUDA
+        testBackward();
+#endif
+    }
+
+private:
+    vector<dtype *> v_vals_, w_vals_;
+    vector<int> cols_, v_strides_, strides_;
+    int row_;
+    AttentionBand band_;
+};
+#else
+class BandedMatrixMulMatrixExecutor :
+    public MatMulExecutorBase<BandedMatrixMulMatrixNode> {};
+#endif
+
+Executor *BandedMatrixMulMatrixNode::generate() {
+    return new BandedMatrixMulMatrixExecutor;
+}
+
+BatchedNode *bandedTranMatrixMulMatrix(BatchedNode &k, BatchedNode &q, int input_row,
+        const AttentionBand &band,
+        bool use_lower_triangle_mask) {
+    BatchedBandedTranMatrixMulMatrixNode *node = new BatchedBandedTranMatrixMulMatrixNode;
+    node->init(k, q, input_row, band, use_lower_triangle_mask);
+    return node;
+}
+
+BatchedNode *bandedMatrixMulMatrix(BatchedNode &v, BatchedNode &weights, int row,
+        const AttentionBand &band) {
+    BatchedBandedMatrixMulMatrixNode *node = new BatchedBandedMatrixMulMatrixNode;
+    node->init(v, weights, row, band);
+    return node;
+}
+
 }
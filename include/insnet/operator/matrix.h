@@ -26,5 +26,46 @@ Node *matmul(Node &A, Node &B, int b_row, bool transpose_a = false,
 
 BatchedNode *matrixMulMatrix(BatchedNode &a, BatchedNode &b, int k);
 
+/// The key span that each query attends to in the banded attention, which keeps both time and memory linear in the sentence length.
+///
+/// Columns are grouped into blocks of *block_size*, and the query in block i attends to the keys from block i - left_blocks to block i + right_blocks, i.e., *width()* keys at most. Keys out of the sentence are masked.
+struct AttentionBand {
+    int block_size = 1;
+    int left_blocks = 0;
+    int right_blocks = 0;
+
+    /// The sliding window where each query attends to *radius* keys on each side.
+    static AttentionBand slidingWindow(int radius) {
+        return {1, radius, radius};
+    }
+
+    /// The block-sparse pattern where each query attends to its own block and *neighbor_blocks* blocks on each side.
+    static AttentionBand blockSparse(int block_size, int neighbor_blocks) {
+        return {block_size, neighbor_blocks, neighbor_blocks};
+    }
+
+    int width() const {
+        return (left_blocks + right_blocks + 1) * block_size;
+    }
+
+    int begin(int query_col) const {
+        return (query_col / block_size - left_blocks) * block_size;
+    }
+
+    std::string toString() const {
+        return std::to_string(block_size) + "-" + std::to_string(left_blocks) + "-" +
+            std::to_string(right_blocks);
+    }
+};
+
+/// The banded counterpart of tranMatrixMulMatrix, whose result only contains the *band.width()* scores of each query, i.e., a *band.width()* x col matrix. Masked scores are -inf.
+BatchedNode *bandedTranMatrixMulMatrix(BatchedNode &k, BatchedNode &q, int input_row,
+        const AttentionBand &band,
+        bool use_lower_triangle_mask = false);
+
+/// The banded counterpart of matrixMulMatrix, which multiplies the value matrix by the *band.width()* x col weight matrix returned by bandedTranMatrixMulMatrix.
+BatchedNode *bandedMatrixMulMatrix(BatchedNode &v, BatchedNode &weights, int row,
+        const AttentionBand &band);
+
 }
 #endif
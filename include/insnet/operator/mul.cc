@@ -40,6 +40,10 @@ public:
 
     Executor * generate() override;
 
+    vector<BaseParam *> params() override {
+        return {};
+    }
+
 protected:
     int forwardOnlyInputValSize() override {
         return 0;
@@ -61,13 +65,6 @@ public:
     Tensor1D y, x1, x2;
     int sumDim;
 
-
-#if !USE_GPU
-    int calculateFLOPs() override {
-        return defaultFLOPs();
-    }
-#endif
-
 #if USE_GPU
     void  forward() {
         int count = batch.size();
@@ -37,6 +37,10 @@ public:
 
     Executor* generate() override;
 
+    vector<BaseParam *> params() override {
+        return {param_};
+    }
+
 protected:
     int forwardOnlyInputValSize() override {
         return 0;
@@ -85,13 +89,25 @@ public:
         node.param_->grad().verify("param backward");
 #endif
     }
+
+    int64_t calculateFLOPs() override {
+        return 0;
+    }
+
+    int64_t calculateBytes() override {
+        return 2 * elementCount() * sizeof(dtype);
+    }
 };
 #else
 class ParamExecutor : public Executor {
 public:
-    int calculateFLOPs() override {
+    int64_t calculateFLOPs() override {
         return 0;
     }
+
+    int64_t calculateBytes() override {
+        return 2 * elementCount() * sizeof(dtype);
+    }
 };
 #endif
 
@@ -121,6 +121,10 @@ public:
 
     Executor * generate() override;
 
+    vector<BaseParam *> params() override {
+        return {};
+    }
+
 protected:
     int forwardOnlyInputValSize() override {
         return inputSize();
@@ -142,6 +146,10 @@ public:
         setDim(dim);
     }
 
+    vector<BaseParam *> params() override {
+        return {};
+    }
+
     void setMask() override {
         int size = inputSize();
         for (int idx = 0; idx < this->size(); idx++) {
@@ -241,6 +249,10 @@ public:
 #endif
     }
 
+    int64_t calculateFLOPs() override {
+        return inputElementCount();
+    }
+
 private:
     cuda::IntArray hit_inputs;
     vector<int> in_counts;
@@ -255,12 +267,9 @@ Executor * MaxPoolNode::generate() {
 
 class PoolExecutor : public Executor {
 public:
-#if !USE_GPU
-    int calculateFLOPs() override {
-        cerr << "unsupported op" << endl;
-        abort();
+    int64_t calculateFLOPs() override {
+        return inputElementCount();
     }
-#endif
 };
 
 Executor * PoolNode::generate() {
@@ -315,6 +324,10 @@ public:
 
     Executor * generate() override;
 
+    vector<BaseParam *> params() override {
+        return {};
+    }
+
 protected:
     int forwardOnlyInputValSize() override {
         return inputSize();
@@ -409,17 +422,16 @@ public:
         }
 #endif
     }
+
+    int64_t calculateFLOPs() override {
+        return inputElementCount();
+    }
 };
 #else
 class SumPoolExecutor : public Executor {
 public:
-    int calculateFLOPs() override {
-        int sum = 0;
-        for (Node *node : batch) {
-            SumPoolNode *s = dynamic_cast<SumPoolNode*>(node);
-            sum += s->size() * s->inputSize();
-        }
-        return sum;
+    int64_t calculateFLOPs() override {
+        return inputElementCount();
     }
 };
 #endif
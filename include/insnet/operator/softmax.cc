@@ -18,6 +18,10 @@ public:
 
     Executor *generate() override;
 
+    vector<BaseParam *> params() override {
+        return {};
+    }
+
     void compute() override {
         int row = size() / getColumn();
         for (int i = 0; i < getColumn(); ++i) {
@@ -141,6 +145,11 @@ public:
 #endif
     }
 
+    /// The maximum, the subtraction and exp, the sum and the division of each column.
+    int64_t calculateFLOPs() override {
+        return 5 * elementCount();
+    }
+
 private:
     vector<dtype *> vals_;
     vector<int> rows_, cols_;
@@ -151,8 +160,9 @@ private:
 #else
 class SoftmaxExecutor : public Executor {
 public:
-    int calculateFLOPs() override {
-        return 0; // TODO
+    /// The maximum, the subtraction and exp, the sum and the division of each column.
+    int64_t calculateFLOPs() override {
+        return 5 * elementCount();
     }
 };
 #endif
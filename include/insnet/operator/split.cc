@@ -19,7 +19,7 @@ public:
     }
 
     string typeSignature() const override {
-        return getNodeType();
+        return getNodeType() + (isInputView() ? "-view" : "");
     }
 
     void connect(Node &input, int offset) {
@@ -31,11 +31,35 @@ public:
 
         offset_ = offset;
         UniInputNode::connect(input);
+        planView(input);
+    }
+
+    /// Whether the val is planned as a view of the input, in which case neither forward nor backward copies. Otherwise it may still be planned as a view of a concatenation consuming it, into which it copies.
+    bool isInputView() const {
+        return !input_vals_.empty() && getVal().plannedViewSource() == input_vals_.front();
+    }
+
+    /// Plan the result as a view of the input if the splitted region is contiguous, or as a strided view if *strided* is true, so that neither forward nor backward copies.
+    void planView(Node &input, bool strided = false) {
+        int row = size() / getColumn();
+        int in_row = input.size() / getColumn();
+        if (getColumn() == 1 || row == in_row) {
+            planAsViewOf(input, offset_);
+        } else if (strided) {
+            planAsViewOf(input, offset_, row, in_row);
+        }
     }
 
     Executor *generate() override;
 
+    vector<BaseParam *> params() override {
+        return {};
+    }
+
     void compute () override {
+        if (isInputView()) {
+            return;
+        }
         int row = size() / getColumn();
         int in_row = inputDim() / getColumn();
         for (int i = 0; i < getColumn(); ++i) {
@@ -44,6 +68,9 @@ public:
     }
 
     void backward() override {
+        if (isInputView()) {
+            return;
+        }
         int row = size() / getColumn();
         int in_row = inputDim() / getColumn();
         for (int i = 0; i < getColumn(); ++i) {
@@ -79,6 +106,9 @@ public:
             s->offset_ = offset;
         }
         setInputsPerNode({&input});
+        for (int i = 0; i < batch().size(); ++i) {
+            dynamic_cast<SplitNode &>(*batch().at(i)).planView(*input.batch().at(i));
+        }
         afterInit({&input});
     }
 
@@ -95,13 +125,16 @@ public:
                 SplitNode *s = dynamic_cast<SplitNode *>(batch().at(i++));
                 s->offset_ = offset;
                 s->setInputs({input_node});
+                s->planView(*input_node);
             }
         }
 
         afterInit({&input});
     }
 
-    void init(Node &input, int row, const vector<int> &offsets, int col = 1) {
+    /// Strided views are not planned in eager mode, for they could not be cancelled once executed.
+    void init(Node &input, int row, const vector<int> &offsets, int col, bool strided_view) {
+        strided_view = strided_view && !input.getNodeContainer().isEager();
         allocateBatch(row * col, offsets.size());
         int i = 0;
         for (int offset : offsets) {
@@ -109,6 +142,7 @@ public:
             s->setColumn(col);
             s->offset_ = offset;
             s->setInputs({&input});
+            s->planView(input, strided_view);
         }
 
         input.addParent(this);
@@ -136,17 +170,43 @@ BatchedNode *split(BatchedNode &input, int dim, const vector<int> &offsets) {
     return node;
 }
 
-BatchedNode *split(Node &input, int row, const vector<int> &offsets, int col) {
+BatchedNode *split(Node &input, int row, const vector<int> &offsets, int col,
+        bool strided_view) {
     BatchedSplitNode *node = new BatchedSplitNode;
-    node->init(input, row, offsets, col);
+    node->init(input, row, offsets, col, strided_view);
     return node;
 }
 
+namespace {
+
+/// Returns the number of the elements copied by the splits, i.e., those not viewing their inputs.
+int64_t copiedElementCount(const vector<Node *> &batch) {
+    int64_t count = 0;
+    for (Node *node : batch) {
+        if (!dynamic_cast<SplitNode &>(*node).isInputView()) {
+            count += node->size();
+        }
+    }
+    return count;
+}
+
+}
+
 #if USE_GPU
 class SplitExecutor : public Executor {
 public:
+    /// Only the nodes which are not views of their inputs copy, for the strided views of a batch may be cancelled one by one.
     void forward() override {
-        int count = batch.size();
+        for (Node *node : batch) {
+            SplitNode &split = dynamic_cast<SplitNode &>(*node);
+            if (!split.isInputView()) {
+                copies_.push_back(&split);
+            }
+        }
+        if (copies_.empty()) {
+            return;
+        }
+        int count = copies_.size();
         vector<dtype*> inputs;
         vector<dtype*> results;
 
@@ -157,15 +217,14 @@ public:
         in_rows_.reserve(count);
         cols_.reserve(count);
 
-        for (Node *node : batch) {
-            SplitNode &split = dynamic_cast<SplitNode &>(*node);
-            inputs.push_back(split.inputVal().value);
-            offsets_.push_back(split.offset_);
-            results.push_back(split.getVal().value);
-            int col = split.getColumn();
+        for (SplitNode *split : copies_) {
+            inputs.push_back(split->inputVal().value);
+            offsets_.push_back(split->offset_);
+            results.push_back(split->getVal().value);
+            int col = split->getColumn();
             cols_.push_back(col);
-            rows_.push_back(split.size() / col);
-            in_rows_.push_back(split.inputDim() / col);
+            rows_.push_back(split->size() / col);
+            in_rows_.push_back(split->inputDim() / col);
         }
         cuda::SplitForward(inputs, offsets_, count, rows_, in_rows_, cols_, results);
 #if TEST_CUDA
@@ -175,16 +234,18 @@ public:
     }
 
     void backward() override {
+        if (copies_.empty()) {
+            return;
+        }
         vector<dtype*> grads;
         vector<dtype *> input_grads;
 
-        for (Node *node : batch) {
-            SplitNode *split = static_cast<SplitNode*>(node);
+        for (SplitNode *split : copies_) {
             grads.push_back(split->getGrad().value);
             input_grads.push_back(split->inputGrad().value);
         }
 
-        cuda::SplitBackward(grads, offsets_, batch.size(), rows_, in_rows_, cols_,
+        cuda::SplitBackward(grads, offsets_, copies_.size(), rows_, in_rows_, cols_,
                 input_grads);
 #if TEST_CUDA
         Executor::testBackward();
@@ -192,7 +253,17 @@ public:
 #endif
     }
 
+    int64_t calculateFLOPs() override {
+        return 0;
+    }
+
+    /// The part of the input read and the vals written, unless the vals are views.
+    int64_t calculateBytes() override {
+        return 2 * copiedElementCount(batch) * sizeof(dtype);
+    }
+
 private:
+        vector<SplitNode *> copies_;
         vector<int> offsets_;
         vector<int> rows_;
         vector<int> in_rows_;
@@ -201,10 +272,15 @@ private:
 #else
 class SplitExecutor : public Executor {
 public:
-    int calculateFLOPs() override {
+    int64_t calculateFLOPs() override {
         return 0;
     }
 
+    /// The part of the input read and the vals written, unless the vals are views.
+    int64_t calculateBytes() override {
+        return 2 * copiedElementCount(batch) * sizeof(dtype);
+    }
+
     int calculateActivations() override {
         return 0;
     }
@@ -7,6 +7,8 @@ namespace insnet {
 
 /// Returns a contiguous region of a matrix.
 ///
+/// If the region is contiguous in memory, e.g., *input_col* is 1, the result is a view of the input sharing its memory, so that no copy happens in either forward or backward.
+///
 /// For example, split([0.1, 0.2, 0.3, 0.4], 2, 2) will return [0.3, 0.4] and split([0.1, 0.2, 0.3, 0.4], 1, 1, 2) will return [0.2, 0.4].
 ///
 /// **All the operators will be executed in batch.**
@@ -17,7 +19,11 @@ namespace insnet {
 /// \return The result tensor. Its size is *result_row \* input_col*.
 Node* split(Node &input, int result_row, int row_offset, int input_col = 1);
 
-BatchedNode *split(Node &input, int row, const std::vector<int> &offsets, int col = 1);
+/// Returns the regions of a matrix beginning at the row-wise offsets.
+///
+/// The results are views of the input sharing its memory if the regions are contiguous, i.e., col is 1 or row equals the input's row number. Otherwise they are copies, unless *strided_view* is true, with which the results are strided views as long as they are only consumed by matmul-family operators such as tranMatrixMulMatrix, for a result consumed by any other operator is copied.
+BatchedNode *split(Node &input, int row, const std::vector<int> &offsets, int col = 1,
+        bool strided_view = false);
 
 }
 
@@ -53,6 +53,10 @@ public:
 
     Executor *generate() override;
 
+    vector<BaseParam *> params() override {
+        return {};
+    }
+
 protected:
     int forwardOnlyInputValSize() override {
         return 0;
@@ -129,11 +133,7 @@ private:
     vector<int> dims_;
 };
 #else
-class SubExecutor : public Executor {
-    int calculateFLOPs() override {
-        return defaultFLOPs();
-    }
-};
+class SubExecutor : public Executor {};
 #endif
 
 Executor *SubNode::generate() {
@@ -3,6 +3,9 @@
 namespace insnet {
 
 void AdagradOptimizer::optimize() {
+    if (flat_params_ != nullptr) {
+        flat_params_->adagrad(lr_, reg_, eps_, grad_scale_);
+    }
     for (int idx = 0; idx < params_.size(); idx++) {
         params_[idx]->adagrad(lr_, reg_, eps_);
     }
@@ -3,6 +3,9 @@
 namespace insnet {
 
 void AdamOptimizer::optimize() {
+    if (flat_params_ != nullptr) {
+        flat_params_->adam(beta1_, beta2_, lr_, l2_penalty_, eps_, grad_scale_);
+    }
     for (int idx = 0; idx < params_.size(); idx++) {
         params_[idx]->adam(beta1_, beta2_, lr_, l2_penalty_, eps_);
     }
@@ -3,6 +3,9 @@
 namespace insnet {
 
 void AdamWOptimizer::optimize() {
+    if (flat_params_ != nullptr) {
+        flat_params_->adamW(beta1_, beta2_, lr_, weight_decay_, eps_, grad_scale_);
+    }
     for (int idx = 0; idx < params_.size(); idx++) {
         params_[idx]->adamW(beta1_, beta2_, lr_, weight_decay_, eps_);
     }
@@ -1,17 +1,61 @@
 #include "insnet/optimizer/optimizer.h"
 
+using std::vector;
+using std::make_unique;
+using std::cerr;
+using std::endl;
+
 namespace insnet {
 
 void Optimizer::step() {
     optimize();
 
     for (BaseParam *p : params_) {
-        p->releaseGrad();
+        if (grad_accumulation_) {
+            p->zeroGrad();
+        } else {
+            p->releaseGrad();
+        }
+    }
+    if (flat_params_ != nullptr) {
+        flat_params_->zeroGrad();
+    }
+    grad_scale_ = 1;
+}
+
+void Optimizer::flattenParams(int thread_count) {
+    if (flat_params_ != nullptr) {
+        cerr << "Optimizer flattenParams - params are already flattened" << endl;
+        abort();
+    }
+    vector<Param *> dense_params;
+    vector<BaseParam *> other_params;
+    for (BaseParam *p : params_) {
+        Param *dense = dynamic_cast<Param *>(p);
+        if (dense == nullptr) {
+            other_params.push_back(p);
+        } else {
+            dense_params.push_back(dense);
+        }
+    }
+    if (dense_params.empty()) {
+        return;
+    }
+    flat_params_ = make_unique<FlatParams>(dense_params);
+    flat_params_->setThreadCount(thread_count);
+    params_ = move(other_params);
+}
+
+void Optimizer::scaleGrad(dtype scale) {
+    for (BaseParam *p : params_) {
+        p->rescaleGrad(scale);
     }
+    grad_scale_ *= scale;
 }
 
 void Optimizer::clipGrad(dtype clip_value) {
-    dtype sum = 0;
+    dtype sum = flat_params_ == nullptr ? 0 :
+        flat_params_->gradSquareSum() * grad_scale_ * grad_scale_;
     for (int idx = 0; idx < params_.size(); idx++) {
         sum += params_.at(idx)->gradSquareSum();
     }
@@ -21,6 +65,7 @@ void Optimizer::clipGrad(dtype clip_value) {
         for (int idx = 0; idx < params_.size(); idx++) {
             params_[idx]->rescaleGrad(scale);
         }
+        grad_scale_ *= scale;
     }
 }
 
@@ -1,7 +1,7 @@
 #ifndef INSNET_OPTIMIZER_H
 #define INSNET_OPTIMIZER_H
 
-#include "insnet/param/base-param.h"
+#include "insnet/param/flat-params.h"
 
 namespace insnet {
 
@@ -19,6 +19,34 @@ public:
         step();
     }
 
+    /// Keep the grads allocated after each step and zero them in place instead of releasing them, so that the backward of several graphs, i.e., micro-batches, accumulates into the same buffers before one step without reallocation. The flattened grads are zeroed by one memset. *The default value is false.*
+    ///
+    /// For example, to train with the average loss of a batch split into micro-batches:
+    /// \code{.cpp}
+    /// optimizer.setGradAccumulation(true);
+    /// int total = 0;
+    /// for (auto &micro_batch : micro_batches) {
+    ///     total += answerCount(micro_batch.answers);
+    /// }
+    /// for (auto &micro_batch : micro_batches) {
+    ///     Graph graph;
+    ///     // build and forward ...
+    ///     NLLLoss(probs, row, micro_batch.answers, averageLossFactor(total));
+    ///     graph.backward();
+    /// }
+    /// optimizer.step();
+    /// \endcode
+    void setGradAccumulation(bool accumulation) {
+        grad_accumulation_ = accumulation;
+    }
+
+    bool isGradAccumulation() const {
+        return grad_accumulation_;
+    }
+
+    /// Multiply the accumulated grads by *scale*, e.g., 1.0 / n to average the grads of n micro-batches whose losses are averaged respectively. The flattened grads are scaled on the fly by the next step instead of by an extra pass.
+    void scaleGrad(dtype scale);
+
     void setLearningRate(dtype learning_rate) {
         lr_ = learning_rate;
     }
@@ -27,11 +55,30 @@ public:
         return lr_;
     }
 
+    /// Flatten the dense params into contiguous buffers, so that their grads persist across steps and are zeroed by one memset, and the gradient clipping and updating run as fused passes over the buffers.
+    ///
+    /// It should be called after the params are initialized or loaded, and before backward. The sparse params are still updated one by one.
+    ///
+    /// \param thread_count The number of CPU threads running the fused updates. *The default value is 1.*
+    void flattenParams(int thread_count = 1);
+
+    /// Returns the flattened params, or nullptr if flattenParams has not been called.
+    FlatParams *flatParams() {
+        return flat_params_.get();
+    }
+
 protected:
+    /// The params not flattened.
     std::vector<BaseParam *> params_;
     dtype lr_;
+    std::unique_ptr<FlatParams> flat_params_ = nullptr;
+
+    /// The scale of the flattened grads computed by gradient clipping, which the optimizers should apply when updating.
+    dtype grad_scale_ = 1;
 
 private:
+    bool grad_accumulation_ = false;
+
     void clipGrad(dtype clip_value);
 };
 
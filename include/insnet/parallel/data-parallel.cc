@@ -0,0 +1,339 @@
+#include "insnet/parallel/data-parallel.h"
+
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <thread>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "fmt/core.h"
+
+using std::vector;
+using std::atomic;
+using std::thread;
+using std::cerr;
+using std::cout;
+using std::endl;
+
+namespace insnet {
+
+struct DataParallel::Control {
+    atomic<int64_t> arrived_count;
+    atomic<int64_t> generation;
+    atomic<int> failed;
+};
+
+namespace {
+
+struct SparseEntry {
+    int32_t param_index;
+    int32_t id;
+};
+
+size_t align(size_t size) {
+    return (size + 63) / 64 * 64;
+}
+
+}
+
+DataParallel::DataParallel(const vector<BaseParam *> &params, int worker_count, int bucket_size,
+        int sparse_capacity) : sparse_capacity_(sparse_capacity), worker_count_(worker_count) {
+#if USE_GPU
+    cerr << "DataParallel - only supported on CPU" << endl;
+    abort();
+#endif
+    if (worker_count < 1 || bucket_size < 1 || sparse_capacity < 0) {
+        cerr << fmt::format("DataParallel - worker_count:{} bucket_size:{} sparse_capacity:{}\n",
+                worker_count, bucket_size, sparse_capacity);
+        abort();
+    }
+
+    for (BaseParam *param : params) {
+        SparseParam *sparse = dynamic_cast<SparseParam *>(param);
+        if (sparse != nullptr) {
+            sparse_params_.push_back(sparse);
+            max_sparse_row_ = std::max(max_sparse_row_, sparse->row());
+            continue;
+        }
+        if (buckets_.empty() || buckets_.back().size >= bucket_size) {
+            buckets_.push_back({dense_size_, 0, 0});
+        }
+        Bucket &bucket = buckets_.back();
+        bucket.size += param->val().size;
+        ++bucket.param_count;
+        dense_indexes_.insert(std::make_pair(param, dense_params_.size()));
+        dense_params_.push_back(param);
+        dense_offsets_.push_back(dense_size_);
+        dense_buckets_.push_back(buckets_.size() - 1);
+        dense_size_ += param->val().size;
+    }
+    initSharedMemory();
+
+    main_pid_ = getpid();
+    cout.flush();
+    cerr.flush();
+    fflush(nullptr);
+    for (int i = 1; i < worker_count; ++i) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            cerr << fmt::format("DataParallel - failed to fork the worker {}\n", i);
+            abort();
+        } else if (pid == 0) {
+            rank_ = i;
+            worker_pids_.clear();
+            prctl(PR_SET_PDEATHSIG, SIGKILL);
+            if (getppid() != main_pid_) {
+                _exit(1);
+            }
+            break;
+        }
+        worker_pids_.push_back(pid);
+    }
+}
+
+DataParallel::~DataParallel() {
+    if (rank_ > 0) {
+        cout.flush();
+        cerr.flush();
+        fflush(nullptr);
+        _exit(0);
+    }
+    for (pid_t pid : worker_pids_) {
+        int status;
+        if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            cerr << fmt::format("DataParallel - the worker process {} failed\n", pid);
+        }
+    }
+    munmap(shared_, shared_size_);
+}
+
+void DataParallel::initSharedMemory() {
+    size_t control_offset = 0;
+    size_t copied_offset = control_offset + align(sizeof(Control));
+    size_t reduced_offset = copied_offset + align(sizeof(atomic<int64_t>) * buckets_.size());
+    size_t sums_offset = reduced_offset + align(sizeof(atomic<int64_t>) * buckets_.size());
+    size_t dense_slots_offset = sums_offset + align(sizeof(double) * worker_count_);
+    size_t dense_result_offset = dense_slots_offset +
+        align(sizeof(dtype) * dense_size_ * worker_count_);
+    size_t sparse_slots_offset = dense_result_offset + align(sizeof(dtype) * dense_size_);
+    if (!sparse_params_.empty()) {
+        sparse_slot_size_ = align(sizeof(int64_t) + sizeof(SparseEntry) * sparse_capacity_) +
+            align(sizeof(dtype) * sparse_capacity_ * max_sparse_row_);
+    }
+    shared_size_ = sparse_slots_offset + sparse_slot_size_ * worker_count_;
+
+    shared_ = mmap(nullptr, shared_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+            -1, 0);
+    if (shared_ == MAP_FAILED) {
+        cerr << fmt::format("DataParallel - failed to map {} bytes of shared memory\n",
+                shared_size_);
+        abort();
+    }
+    char *base = static_cast<char *>(shared_);
+    control_ = new(base + control_offset) Control;
+    control_->arrived_count = 0;
+    control_->generation = 0;
+    control_->failed = 0;
+    copied_counts_ = reinterpret_cast<atomic<int64_t> *>(base + copied_offset);
+    reduced_counts_ = reinterpret_cast<atomic<int64_t> *>(base + reduced_offset);
+    for (int i = 0; i < buckets_.size(); ++i) {
+        new(copied_counts_ + i) atomic<int64_t>(0);
+        new(reduced_counts_ + i) atomic<int64_t>(0);
+    }
+    sums_ = reinterpret_cast<double *>(base + sums_offset);
+    dense_slots_ = reinterpret_cast<dtype *>(base + dense_slots_offset);
+    dense_result_ = reinterpret_cast<dtype *>(base + dense_result_offset);
+    sparse_slots_ = base + sparse_slots_offset;
+}
+
+void DataParallel::checkWorkers() {
+    if (control_->failed.load()) {
+        cerr << fmt::format("DataParallel - a worker failed, so the worker {} aborts\n", rank_);
+        abort();
+    }
+    if (rank_ == 0) {
+        for (pid_t pid : worker_pids_) {
+            int status;
+            if (waitpid(pid, &status, WNOHANG) != 0) {
+                control_->failed = 1;
+                cerr << fmt::format("DataParallel - the worker process {} exited\n", pid);
+                abort();
+            }
+        }
+    } else if (getppid() != main_pid_) {
+        cerr << "DataParallel - the main process exited" << endl;
+        abort();
+    }
+}
+
+template <typename F>
+void DataParallel::waitUntil(const F &done) {
+    for (int64_t i = 1; !done(); ++i) {
+        if (i % 4096 == 0) {
+            checkWorkers();
+        }
+        std::this_thread::yield();
+    }
+}
+
+void DataParallel::barrier() {
+    int64_t generation = control_->generation.load();
+    if (control_->arrived_count.fetch_add(1) + 1 == worker_count_) {
+        control_->arrived_count = 0;
+        control_->generation.fetch_add(1);
+    } else {
+        waitUntil([&]() {
+            return control_->generation.load() != generation;
+        });
+    }
+}
+
+dtype DataParallel::sum(dtype value) {
+    sums_[rank_] = value;
+    barrier();
+    double result = 0;
+    for (int i = 0; i < worker_count_; ++i) {
+        result += sums_[i];
+    }
+    barrier();
+    return result;
+}
+
+void DataParallel::completeParam(int dense_index) {
+    if (completed_params_.at(dense_index)) {
+        return;
+    }
+    completed_params_.at(dense_index) = true;
+    BaseParam &param = *dense_params_.at(dense_index);
+    dtype *slot = dense_slots_ + rank_ * dense_size_ + dense_offsets_.at(dense_index);
+    memcpy(slot, param.grad().v, sizeof(dtype) * param.grad().size);
+    int bucket = dense_buckets_.at(dense_index);
+    if (--pending_param_counts_.at(bucket) == 0) {
+        copied_counts_[bucket].fetch_add(1);
+    }
+}
+
+void DataParallel::reduceBuckets() {
+    int64_t target = step_ * worker_count_;
+    vector<bool> reduced(buckets_.size(), false);
+    int remaining = buckets_.size();
+    for (int64_t i = 1; remaining > 0; ++i) {
+        bool progressed = false;
+        for (int b = 0; b < buckets_.size(); ++b) {
+            if (reduced.at(b) || copied_counts_[b].load() < target) {
+                continue;
+            }
+            const Bucket &bucket = buckets_.at(b);
+            int64_t begin = bucket.offset + bucket.size * rank_ / worker_count_;
+            int64_t end = bucket.offset + bucket.size * (rank_ + 1) / worker_count_;
+            Vec result(dense_result_ + begin, end - begin);
+            result = Vec(dense_slots_ + begin, end - begin);
+            for (int k = 1; k < worker_count_; ++k) {
+                result += Vec(dense_slots_ + k * dense_size_ + begin, end - begin);
+            }
+            reduced_counts_[b].fetch_add(1);
+            reduced.at(b) = true;
+            --remaining;
+            progressed = true;
+        }
+        if (!progressed) {
+            if (i % 4096 == 0) {
+                checkWorkers();
+            }
+            std::this_thread::yield();
+        }
+    }
+}
+
+void DataParallel::allReduceSparseGrads() {
+    char *slot = sparse_slots_ + rank_ * sparse_slot_size_;
+    int64_t &count = *reinterpret_cast<int64_t *>(slot);
+    SparseEntry *entries = reinterpret_cast<SparseEntry *>(slot + sizeof(int64_t));
+    dtype *columns = reinterpret_cast<dtype *>(slot +
+            align(sizeof(int64_t) + sizeof(SparseEntry) * sparse_capacity_));
+    count = 0;
+    for (int i = 0; i < sparse_params_.size(); ++i) {
+        SparseParam &param = *sparse_params_.at(i);
+        for (int id : param.touchedIds()) {
+            if (count == sparse_capacity_) {
+                cerr << fmt::format("DataParallel - more than {} sparse grad columns\n",
+                        sparse_capacity_);
+                abort();
+            }
+            entries[count] = {i, id};
+            memcpy(columns + count * max_sparse_row_, param.gradColumn(id),
+                    sizeof(dtype) * param.row());
+            ++count;
+        }
+    }
+    barrier();
+
+    // All the workers sum the columns in the order of the ranks, so the sums are identical.
+    for (SparseParam *param : sparse_params_) {
+        param->releaseGrad();
+    }
+    for (int k = 0; k < worker_count_; ++k) {
+        char *other = sparse_slots_ + k * sparse_slot_size_;
+        int64_t other_count = *reinterpret_cast<int64_t *>(other);
+        const SparseEntry *other_entries = reinterpret_cast<SparseEntry *>(other +
+                sizeof(int64_t));
+        dtype *other_columns = reinterpret_cast<dtype *>(other +
+                align(sizeof(int64_t) + sizeof(SparseEntry) * sparse_capacity_));
+        for (int64_t i = 0; i < other_count; ++i) {
+            const SparseEntry &entry = other_entries[i];
+            SparseParam &param = *sparse_params_.at(entry.param_index);
+            Vec(param.gradColumn(entry.id), param.row()) +=
+                Vec(other_columns + i * max_sparse_row_, param.row());
+        }
+    }
+    barrier();
+}
+
+void DataParallel::backward(Graph &graph) {
+    ++step_;
+    for (BaseParam *param : dense_params_) {
+        param->initAndZeroGrad();
+    }
+    completed_params_.assign(dense_params_.size(), false);
+    pending_param_counts_.clear();
+    for (const Bucket &bucket : buckets_) {
+        pending_param_counts_.push_back(bucket.param_count);
+    }
+
+    graph.setCompleteGradsCallback([this](const vector<BaseParam *> &params) {
+        for (BaseParam *param : params) {
+            auto it = dense_indexes_.find(param);
+            if (it != dense_indexes_.end()) {
+                completeParam(it->second);
+            }
+        }
+    });
+    thread reducer(&DataParallel::reduceBuckets, this);
+    graph.backward();
+    graph.setCompleteGradsCallback(nullptr);
+    for (int i = 0; i < dense_params_.size(); ++i) {
+        completeParam(i);
+    }
+    reducer.join();
+
+    int64_t target = step_ * worker_count_;
+    for (int b = 0; b < buckets_.size(); ++b) {
+        waitUntil([&]() {
+            return reduced_counts_[b].load() >= target;
+        });
+    }
+    for (int i = 0; i < dense_params_.size(); ++i) {
+        Tensor2D &grad = dense_params_.at(i)->grad();
+        memcpy(grad.v, dense_result_ + dense_offsets_.at(i), sizeof(dtype) * grad.size);
+    }
+
+    if (!sparse_params_.empty()) {
+        allReduceSparseGrads();
+    }
+}
+
+}
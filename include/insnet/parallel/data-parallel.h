@@ -0,0 +1,141 @@
+#ifndef INSNET_DATA_PARALLEL_H
+#define INSNET_DATA_PARALLEL_H
+
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <sys/types.h>
+#include "insnet/computation-graph/graph.h"
+#include "insnet/param/sparse-param.h"
+
+namespace insnet {
+
+/// \brief The data-parallel training on the local worker processes, whose grads are all-reduced through shared memory.
+///
+/// The constructor forks *worker_count - 1* worker processes, each of which returns from it with its own rank and continues running the same program, so the params should have been initialized identically before. Each worker then builds and runs the graph of its shard of every mini-batch, and backward(graph) sums the grads of all the workers, so that the identical optimizer steps keep the params identical.
+///
+/// The dense grads are reduced in buckets: once a bucket's grads are complete in backward, each worker copies them to the shared memory, and a background thread reduces the worker's slice of the bucket as soon as all the workers have copied it, which overlaps the rest of backward. The sums are computed in the same order on all the workers, so the params stay bitwise identical. The row-sparse grads of SparseParam are exchanged after backward.
+///
+/// The worker processes exit in the destructor, so the code after the DataParallel's lifetime runs only in the main process, whose rank is 0. Since the workers inherit the state of the random number generator, they should call srand with their ranks if they use dropout.
+///
+/// For example:
+/// \code{.cpp}
+/// DataParallel dp(model.tunableParams(), 4);
+/// srand(dp.rank());
+/// AdamOptimizer optimizer(model.tunableParams(), 1e-3);
+/// for (auto &batch : batches) {
+///     Graph graph;
+///     auto shard = dp.shard(batch);
+///     // build the graph of the shard and forward ...
+///     dtype loss = NLLLoss(probs, row, answers, averageLossFactor(answerCount(all_answers)));
+///     dp.backward(graph);
+///     optimizer.step();
+///     loss = dp.sum(loss);
+/// }
+/// \endcode
+///
+/// It is only supported on CPU.
+class DataParallel {
+public:
+    /// \param params The params of the model, which should be in the same order on all the workers, e.g., returned by tunableParams().
+    /// \param worker_count The number of worker processes including the main process.
+    /// \param bucket_size The minimal number of the grads' elements reduced together. *The default value is 2^18.*
+    /// \param sparse_capacity The maximal number of the grad columns of all the sparse params touched by a worker in a step. *The default value is 2^16.*
+    DataParallel(const std::vector<BaseParam *> &params, int worker_count,
+            int bucket_size = 1 << 18,
+            int sparse_capacity = 1 << 16);
+
+    DataParallel(const DataParallel &) = delete;
+
+    /// Exit the worker processes, or wait for them to exit in the main process.
+    ~DataParallel();
+
+    int rank() const {
+        return rank_;
+    }
+
+    int workerCount() const {
+        return worker_count_;
+    }
+
+    /// Returns the elements of *batch* of this worker, i.e., those whose indexes modulo the worker count are equal to the rank.
+    template <typename T>
+    std::vector<T> shard(const std::vector<T> &batch) const {
+        std::vector<T> result;
+        for (int i = rank_; i < batch.size(); i += worker_count_) {
+            result.push_back(batch.at(i));
+        }
+        return result;
+    }
+
+    /// Run backward of *graph*, all-reducing the grads of the params while it proceeds. When it returns, the grads of all the params are the sums of all the workers'.
+    void backward(Graph &graph);
+
+    /// Returns the sum of *value* of all the workers, e.g., the losses of the shards.
+    dtype sum(dtype value);
+
+    /// Wait until all the workers call barrier.
+    void barrier();
+
+private:
+    struct Bucket {
+        int64_t offset;
+        int64_t size;
+        int param_count;
+    };
+
+    struct Control;
+
+    void initSharedMemory();
+
+    /// Copy the grad of the dense param to the shared memory of this worker, and publish its bucket once all the bucket's params are complete.
+    void completeParam(int dense_index);
+
+    /// Reduce this worker's slice of each bucket copied by all the workers, until all the buckets are reduced.
+    void reduceBuckets();
+
+    void allReduceSparseGrads();
+
+    /// Spin until *done* returns true, aborting if another worker has died.
+    template <typename F>
+    void waitUntil(const F &done);
+
+    void checkWorkers();
+
+    std::vector<BaseParam *> dense_params_;
+    std::unordered_map<BaseParam *, int> dense_indexes_;
+    std::vector<int64_t> dense_offsets_;
+    std::vector<int> dense_buckets_;
+    std::vector<Bucket> buckets_;
+    std::vector<SparseParam *> sparse_params_;
+
+    /// The states of the current step.
+    std::vector<bool> completed_params_;
+    std::vector<int> pending_param_counts_;
+
+    int64_t dense_size_ = 0;
+    int max_sparse_row_ = 0;
+    int sparse_capacity_ = 0;
+
+    int rank_ = 0;
+    int worker_count_ = 1;
+    pid_t main_pid_ = 0;
+    std::vector<pid_t> worker_pids_;
+    int64_t step_ = 0;
+
+    void *shared_ = nullptr;
+    size_t shared_size_ = 0;
+    Control *control_ = nullptr;
+    std::atomic<int64_t> *copied_counts_ = nullptr;
+    std::atomic<int64_t> *reduced_counts_ = nullptr;
+    double *sums_ = nullptr;
+    dtype *dense_slots_ = nullptr;
+    dtype *dense_result_ = nullptr;
+    char *sparse_slots_ = nullptr;
+    size_t sparse_slot_size_ = 0;
+};
+
+}
+
+#endif
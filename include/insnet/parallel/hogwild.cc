@@ -0,0 +1,49 @@
+#include "insnet/parallel/hogwild.h"
+
+#include <iostream>
+#include <thread>
+#include "insnet/util/profiler.h"
+#include "fmt/core.h"
+
+using std::vector;
+using std::function;
+using std::thread;
+using std::cerr;
+using std::endl;
+
+namespace insnet {
+
+void shareParams(const vector<BaseParam *> &params, const vector<BaseParam *> &replica_params) {
+    if (params.size() != replica_params.size()) {
+        cerr << fmt::format("shareParams - params size:{} replica params size:{}\n",
+                params.size(), replica_params.size());
+        abort();
+    }
+    for (int i = 0; i < params.size(); ++i) {
+        replica_params.at(i)->shareValues(*params.at(i));
+    }
+}
+
+void hogwild(int thread_count, const function<void(int thread_index)> &train) {
+#if USE_GPU
+    cerr << "hogwild - only supported on CPU" << endl;
+    abort();
+#endif
+    if (thread_count < 1) {
+        cerr << fmt::format("hogwild - thread_count:{}\n", thread_count);
+        abort();
+    }
+    bool profiled = Profiler::Ins().isEnabled();
+    vector<thread> threads;
+    for (int i = 0; i < thread_count; ++i) {
+        threads.emplace_back([&train, profiled, i]() {
+            Profiler::Ins().SetEnabled(profiled);
+            train(i);
+        });
+    }
+    for (thread &t : threads) {
+        t.join();
+    }
+}
+
+}
@@ -0,0 +1,43 @@
+#ifndef INSNET_HOGWILD_H
+#define INSNET_HOGWILD_H
+
+#include <functional>
+#include <vector>
+#include "insnet/param/base-param.h"
+
+namespace insnet {
+
+/// Make the values and the optimizer moments of *replica_params* views of those of *params* one by one, which are typically returned by tunableParams() of the shared model and of a replica of the same structure.
+///
+/// The grads and the iteration counts of the optimizers are still the replica's own, so that the backward on different threads accumulates into separate buffers, while the optimizer steps update the shared params without locks. The shared model should outlive the replicas and should not be flattened afterwards, and the replicas should not be flattened either.
+void shareParams(const std::vector<BaseParam *> &params,
+        const std::vector<BaseParam *> &replica_params);
+
+/// Run *train* on *thread_count* threads, passing the thread indexes, and wait for them to finish.
+///
+/// It is intended for Hogwild training of sparse models, e.g., taggers with large embedding tables, where each thread builds a replica of the model, shares the params by shareParams, and then trains on its part of the data by its own graphs and optimizer, applying the updates to the shared params without locks. The racy updates are by design, and they rarely collide if the grads are sparse. See <a href="https://arxiv.org/abs/1106.5730">HOGWILD!: A Lock-Free Approach to Parallelizing Stochastic Gradient Descent</a>.
+///
+/// The node pools are thread-local and each thread has its own profiler, which is enabled if the calling thread's is. Each graph should be built, run and destroyed on the same thread.
+///
+/// For example:
+/// \code{.cpp}
+/// hogwild(4, [&](int thread_index) {
+///     Model replica;
+///     replica.init(...); // the same hyper-parameters as model
+///     shareParams(model.tunableParams(), replica.tunableParams());
+///     AdagradOptimizer optimizer(replica.tunableParams(), 0.01);
+///     for (int i = thread_index; i < instances.size(); i += 4) {
+///         Graph graph;
+///         // build the graph of instances[i], forward and compute the loss ...
+///         graph.backward();
+///         optimizer.step();
+///     }
+/// });
+/// \endcode
+///
+/// It is only supported on CPU.
+void hogwild(int thread_count, const std::function<void(int thread_index)> &train);
+
+}
+
+#endif
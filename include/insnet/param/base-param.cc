@@ -1,10 +1,14 @@
 #include "base-param.h"
+#include "fmt/core.h"
 
 #if USE_GPU
 #include "insnet/cuda/insnet_cuda.h"
 #endif
 
 using std::make_unique;
+using std::shared_ptr;
+using std::cerr;
+using std::endl;
 
 namespace insnet {
 
@@ -12,6 +16,7 @@ void BaseParam::initAndZeroGrad() {
     if (grad_ != nullptr) {
         return;
     }
+    MemoryScope scope(MemoryCategory::GRADIENT_MEMORY);
     grad_ = make_unique<Tensor2D>();
     grad_->init(val_.row, val_.col);
 # if USE_GPU
@@ -20,4 +25,85 @@ void BaseParam::initAndZeroGrad() {
 #endif
 }
 
+void BaseParam::setBFloat16Compute(bool enabled) {
+#if USE_GPU
+    if (enabled) {
+        cerr << "BaseParam setBFloat16Compute - only supported on CPU" << endl;
+        abort();
+    }
+#endif
+    if (enabled) {
+        bfloat16_copy_.resize(val_.size);
+        refreshBFloat16Copy();
+    } else {
+        bfloat16_copy_.clear();
+        bfloat16_copy_.shrink_to_fit();
+    }
+}
+
+void BaseParam::refreshBFloat16Copy() {
+    if (hasBFloat16Copy()) {
+        toBFloat16(val_.v, val_.size, bfloat16_copy_.data());
+    }
+}
+
+void BaseParam::shareValues(BaseParam &param) {
+#if USE_GPU
+    cerr << "BaseParam shareValues - only supported on CPU" << endl;
+    abort();
+#else
+    if (param.row() != row() || param.col() != col()) {
+        cerr << fmt::format("BaseParam shareValues - {} is {}x{} but {} is {}x{}\n", name_,
+                row(), col(), param.name_, param.row(), param.col());
+        abort();
+    }
+    // The shared tensors are owned by param, so the owners do not delete them.
+    auto share = [](Tensor2D &dst, Tensor2D &src) {
+        dst.initAsView(src.v, src.row, src.col, shared_ptr<void>(src.v, [](void *) {}));
+    };
+    share(val_, param.val_);
+    share(aux_mean_, param.aux_mean_);
+    share(aux_square_, param.aux_square_);
+    frozen_ = param.frozen_;
+#endif
+}
+
+void BaseParam::initFrozenView(const dtype *v, int row, int col,
+        const shared_ptr<void> &owner) {
+#if USE_GPU
+    cerr << "BaseParam initFrozenView - only supported on CPU" << endl;
+    abort();
+#else
+    // The values are never written through the view, for checkWritable guards the optimizer
+    // steps.
+    val_.initAsView(const_cast<dtype *>(v), row, col, owner);
+    aux_mean_.release();
+    aux_square_.release();
+    grad_.reset();
+    initMetadata(row, col);
+    frozen_ = true;
+#endif
+}
+
+void BaseParam::checkWritable(const char *caller) const {
+    if (frozen_) {
+        cerr << fmt::format("{} - {} is frozen and its values are read-only\n", caller, name_);
+        abort();
+    }
+}
+
+void BaseParam::zeroGrad() {
+    if (grad_ == nullptr) {
+        return;
+    }
+#if USE_GPU
+    cuda::Memset(grad_->value, grad_->size, 0.0f);
+#if TEST_CUDA
+    grad_->zero();
+#endif
+#else
+    grad_->zero();
+#endif
+}
+
 }
@@ -2,6 +2,7 @@
 #define BasePARAM_H_
 
 #include "insnet/base/tensor.h"
+#include "insnet/base/bfloat16.h"
 
 namespace insnet {
 
@@ -122,15 +123,67 @@ public:
 
     virtual void initAndZeroGrad();
 
-    void releaseGrad() {
+    /// Zero the grad in place if it is allocated, keeping the memory for the next backward.
+    virtual void zeroGrad();
+
+    /// Enable the bfloat16 compute path of the param for inference, i.e., keep a bfloat16 copy of the values, which the linear and embedding operators read in the inference graphs with the bfloat16 compute path (see Graph::setBFloat16Compute), halving the memory traffic of the weights, while the computations still accumulate in dtype.
+    ///
+    /// Note that the copy is kept in addition to the values, so it does not save memory but costs another half of the values' memory. It is a snapshot of the values that the optimizers do not refresh, so enable it after training or call refreshBFloat16Copy after the values are modified, while Checkpoint::load refreshes it. It is only supported on CPU.
+    void setBFloat16Compute(bool enabled);
+
+    bool hasBFloat16Copy() const {
+        return !bfloat16_copy_.empty();
+    }
+
+    /// Returns the bfloat16 copy of the values in the same column-major layout.
+    const bfloat16 *bfloat16Copy() const {
+        return bfloat16_copy_.data();
+    }
+
+    /// Convert the values to the bfloat16 copy.
+    void refreshBFloat16Copy();
+
+
+    /// Make the values and the optimizer moments views of *param*'s, which should be of the same shape and outlive this param, while the grads are still this param's own. See hogwild.
+    ///
+    /// It is only supported on CPU.
+    void shareValues(BaseParam &param);
+
+    virtual void releaseGrad() {
         grad_.reset();
     }
 
+    /// Make the values a read-only view of the host memory *v*, which is kept valid by *owner*, e.g., a memory-mapped file, allocating neither the values nor the optimizer moments, and freeing them if the param has been initialized.
+    ///
+    /// The param is then frozen, and the optimizer steps abort instead of writing to *v*. It is only supported on CPU.
+    void initFrozenView(const dtype *v, int row, int col, const std::shared_ptr<void> &owner);
+
+    bool isFrozen() const {
+        return frozen_;
+    }
+
 protected:
+    /// Initialize the states of a *row* x *col* param besides the values and the optimizer moments, which initFrozenView also calls.
+    virtual void initMetadata(int row, int col) {}
+
+    /// Abort if the param is frozen, which the optimizer steps call before writing the values.
+    void checkWritable(const char *caller) const;
+
+    /// Returns the step counters of the optimizers, which Checkpoint saves with the optimizer states.
+    virtual std::vector<int> optimizerIters() {
+        return {};
+    }
+
+    virtual void setOptimizerIters(const std::vector<int> &iters) {}
+
     bool is_bias_ = false;
     std::string name_;
     Tensor2D val_, aux_square_, aux_mean_;
     std::unique_ptr<Tensor2D> grad_ = nullptr;
+    std::vector<bfloat16> bfloat16_copy_;
+    bool frozen_ = false;
+
+    friend class Checkpoint;
 };
 
 typedef Tunable<BaseParam> TunableParam;
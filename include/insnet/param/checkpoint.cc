@@ -0,0 +1,335 @@
+#include "insnet/param/checkpoint.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include "fmt/core.h"
+
+using std::string;
+using std::vector;
+using std::unordered_map;
+using std::cerr;
+using std::make_shared;
+using std::make_pair;
+using std::pair;
+using std::thread;
+using std::move;
+
+namespace insnet {
+
+namespace {
+
+const char MAGIC[8] = {'I', 'N', 'S', 'C', 'K', 'P', 'T', '1'};
+
+const int64_t BLOB_ALIGNMENT = 64;
+
+struct CheckpointHeader {
+    char magic[8];
+    int64_t entry_count;
+    int64_t manifest_offset;
+    int64_t manifest_size;
+    int32_t dtype_size;
+    int32_t iters_count;
+    char padding[24];
+};
+
+static_assert(sizeof(CheckpointHeader) == 64, "CheckpointHeader should be 64 bytes");
+
+/// Returns the manifest keys of *params*, suffixing the k-th repeated name with "#k".
+vector<string> manifestKeys(const vector<BaseParam *> &params) {
+    unordered_map<string, int> counts;
+    vector<string> keys;
+    keys.reserve(params.size());
+    for (BaseParam *param : params) {
+        const string &name = param->getParamName();
+        int &count = counts[name];
+        keys.push_back(count == 0 ? name : fmt::format("{}#{}", name, count));
+        ++count;
+    }
+    return keys;
+}
+
+template<typename T>
+void appendPod(string &buf, const T &x) {
+    buf.append(reinterpret_cast<const char *>(&x), sizeof(T));
+}
+
+/// \brief The reader of a checkpoint's manifest, which aborts instead of reading beyond it.
+class ManifestReader {
+public:
+    ManifestReader(const char *begin, const char *end, const string &path) : p_(begin),
+        end_(end), path_(path) {}
+
+    template<typename T>
+    T read() {
+        T x;
+        memcpy(&x, take(sizeof(T)), sizeof(T));
+        return x;
+    }
+
+    string readString() {
+        int32_t len = read<int32_t>();
+        return string(take(len), len);
+    }
+
+    /// Returns the next *len* bytes, aborting if they are beyond the manifest.
+    const char *take(int64_t len) {
+        if (len < 0 || len > end_ - p_) {
+            cerr << fmt::format("Checkpoint - {} has a truncated or corrupt manifest\n", path_);
+            abort();
+        }
+        const char *p = p_;
+        p_ += len;
+        return p;
+    }
+
+private:
+    const char *p_;
+    const char *end_;
+    const string &path_;
+};
+
+double secondsSince(const std::chrono::steady_clock::time_point &begin) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+}
+
+void Checkpoint::stage(const vector<BaseParam *> &params, bool with_optimizer_states,
+        vector<char> &buf) {
+    vector<string> keys = manifestKeys(params);
+    vector<pair<string, Tensor2D *>> tensors;
+    for (int i = 0; i < params.size(); ++i) {
+        BaseParam &param = *params.at(i);
+        tensors.push_back(make_pair(keys.at(i), &param.val_));
+        if (with_optimizer_states) {
+            tensors.push_back(make_pair(keys.at(i) + ".aux_mean", &param.aux_mean_));
+            tensors.push_back(make_pair(keys.at(i) + ".aux_square", &param.aux_square_));
+        }
+    }
+
+    vector<pair<string, vector<int>>> iters;
+    if (with_optimizer_states) {
+        for (int i = 0; i < params.size(); ++i) {
+            iters.push_back(make_pair(keys.at(i), params.at(i)->optimizerIters()));
+        }
+    }
+
+    string manifest;
+    vector<int64_t> offsets;
+    int64_t pos = sizeof(CheckpointHeader);
+    for (auto &it : tensors) {
+        Tensor2D &tensor = *it.second;
+#if USE_GPU
+        tensor.copyFromDeviceToHost();
+#endif
+        pos = (pos + BLOB_ALIGNMENT - 1) / BLOB_ALIGNMENT * BLOB_ALIGNMENT;
+        offsets.push_back(pos);
+        appendPod<int32_t>(manifest, it.first.size());
+        manifest += it.first;
+        appendPod<int32_t>(manifest, tensor.row);
+        appendPod<int32_t>(manifest, tensor.col);
+        appendPod<int64_t>(manifest, pos);
+        pos += static_cast<int64_t>(tensor.size) * sizeof(dtype);
+    }
+    for (auto &it : iters) {
+        appendPod<int32_t>(manifest, it.first.size());
+        manifest += it.first;
+        appendPod<int32_t>(manifest, it.second.size());
+        manifest.append(reinterpret_cast<const char *>(it.second.data()),
+                it.second.size() * sizeof(int));
+    }
+
+    buf.resize(pos + manifest.size());
+    CheckpointHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.entry_count = tensors.size();
+    header.manifest_offset = pos;
+    header.manifest_size = manifest.size();
+    header.dtype_size = sizeof(dtype);
+    header.iters_count = iters.size();
+    memcpy(buf.data(), &header, sizeof(header));
+    int64_t end = sizeof(header);
+    for (int i = 0; i < tensors.size(); ++i) {
+        const Tensor2D &tensor = *tensors.at(i).second;
+        memset(buf.data() + end, 0, offsets.at(i) - end);
+        int64_t len = static_cast<int64_t>(tensor.size) * sizeof(dtype);
+        memcpy(buf.data() + offsets.at(i), tensor.v, len);
+        end = offsets.at(i) + len;
+    }
+    memcpy(buf.data() + pos, manifest.data(), manifest.size());
+}
+
+void Checkpoint::writeAtomically(const string &path, const vector<char> &buf) {
+    string tmp_path = path + ".tmp";
+    int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        cerr << fmt::format("Checkpoint writeAtomically - failed to open {}\n", tmp_path);
+        abort();
+    }
+    for (size_t written = 0; written < buf.size(); ) {
+        ssize_t len = write(fd, buf.data() + written, buf.size() - written);
+        if (len < 0) {
+            cerr << fmt::format("Checkpoint writeAtomically - failed to write {}\n", tmp_path);
+            abort();
+        }
+        written += len;
+    }
+    if (fsync(fd) != 0 || close(fd) != 0 || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        cerr << fmt::format("Checkpoint writeAtomically - failed to save {}\n", path);
+        abort();
+    }
+
+    // The rename itself is durable only after the directory entry is synced.
+    size_t slash = path.rfind('/');
+    string dir = slash == string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int dir_fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dir_fd < 0 || fsync(dir_fd) != 0 || close(dir_fd) != 0) {
+        cerr << fmt::format("Checkpoint writeAtomically - failed to sync {}\n", dir);
+        abort();
+    }
+}
+
+void saveCheckpoint(const string &path, const vector<BaseParam *> &params,
+        bool with_optimizer_states) {
+    vector<char> buf;
+    Checkpoint::stage(params, with_optimizer_states, buf);
+    Checkpoint::writeAtomically(path, buf);
+}
+
+Checkpoint::Checkpoint(const string &path) : file_(make_shared<MappedFile>(path)) {
+    const char *base = file_->data();
+    int64_t file_size = file_->size();
+    if (file_size < sizeof(CheckpointHeader)) {
+        cerr << fmt::format("Checkpoint - {} is too short\n", path);
+        abort();
+    }
+    const CheckpointHeader &header = *reinterpret_cast<const CheckpointHeader *>(base);
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.dtype_size != sizeof(dtype) ||
+            header.entry_count < 0 || header.iters_count < 0 ||
+            !sectionFits(header.manifest_offset, header.manifest_size, file_size,
+                sizeof(header), 1)) {
+        cerr << fmt::format("Checkpoint - {} is not a valid checkpoint of dtype size {}\n", path,
+                sizeof(dtype));
+        abort();
+    }
+    ManifestReader reader(base + header.manifest_offset,
+            base + header.manifest_offset + header.manifest_size, path);
+    for (int64_t i = 0; i < header.entry_count; ++i) {
+        string name = reader.readString();
+        Entry entry;
+        entry.row = reader.read<int32_t>();
+        entry.col = reader.read<int32_t>();
+        entry.offset = reader.read<int64_t>();
+        if (entry.row < 0 || entry.col < 0 || !sectionFits(entry.offset,
+                    static_cast<int64_t>(entry.row) * entry.col * sizeof(dtype), file_size,
+                    sizeof(header), BLOB_ALIGNMENT)) {
+            cerr << fmt::format("Checkpoint - {} has {} of shape ({},{}) at {} not fitting in "
+                    "{} bytes\n", path, name, entry.row, entry.col, entry.offset, file_size);
+            abort();
+        }
+        entries_.insert(make_pair(name, entry));
+    }
+    for (int32_t i = 0; i < header.iters_count; ++i) {
+        string name = reader.readString();
+        int32_t count = reader.read<int32_t>();
+        if (count < 0) {
+            cerr << fmt::format("Checkpoint - {} has {} iters of {}\n", path, count, name);
+            abort();
+        }
+        const char *p = reader.take(static_cast<int64_t>(count) * sizeof(int));
+        vector<int> iters(count);
+        memcpy(iters.data(), p, count * sizeof(int));
+        iters_.insert(make_pair(name, move(iters)));
+    }
+}
+
+const Checkpoint::Entry &Checkpoint::entry(const string &key, const Tensor2D &tensor) const {
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+        cerr << fmt::format("Checkpoint load - {} not found in {}\n", key, file_->path());
+        abort();
+    }
+    const Entry &e = it->second;
+    if (tensor.v != nullptr && (tensor.row != e.row || tensor.col != e.col)) {
+        cerr << fmt::format("Checkpoint load - {} shape:({},{}) saved shape:({},{})\n", key,
+                tensor.row, tensor.col, e.row, e.col);
+        abort();
+    }
+    return e;
+}
+
+void Checkpoint::load(const vector<BaseParam *> &params, bool with_optimizer_states) const {
+    vector<string> keys = manifestKeys(params);
+    for (int i = 0; i < params.size(); ++i) {
+        BaseParam &param = *params.at(i);
+#if !USE_GPU
+        if (!with_optimizer_states) {
+            const Entry &e = entry(keys.at(i), param.val_);
+            param.initFrozenView(reinterpret_cast<const dtype *>(file_->data() + e.offset), e.row,
+                    e.col, file_);
+            param.refreshBFloat16Copy();
+            continue;
+        }
+#endif
+        vector<pair<string, Tensor2D *>> tensors = {make_pair(keys.at(i), &param.val_)};
+        if (with_optimizer_states) {
+            tensors.push_back(make_pair(keys.at(i) + ".aux_mean", &param.aux_mean_));
+            tensors.push_back(make_pair(keys.at(i) + ".aux_square", &param.aux_square_));
+        }
+        if (with_optimizer_states) {
+            auto it = iters_.find(keys.at(i));
+            if (it == iters_.end() || it->second.size() != param.optimizerIters().size()) {
+                cerr << fmt::format("Checkpoint load - optimizer iters of {} not found in {}\n",
+                        keys.at(i), file_->path());
+                abort();
+            }
+            param.setOptimizerIters(it->second);
+        }
+        for (auto &it : tensors) {
+            Tensor2D &tensor = *it.second;
+            if (tensor.v == nullptr) {
+                cerr << fmt::format("Checkpoint load - {} is not initialized\n", it.first);
+                abort();
+            }
+            const Entry &e = entry(it.first, tensor);
+            memcpy(tensor.v, file_->data() + e.offset,
+                    static_cast<int64_t>(tensor.size) * sizeof(dtype));
+#if USE_GPU
+            tensor.copyFromHostToDevice();
+#endif
+        }
+        param.refreshBFloat16Copy();
+    }
+}
+
+CheckpointWriter::~CheckpointWriter() {
+    wait();
+}
+
+void CheckpointWriter::wait() {
+    if (thread_.joinable()) {
+        thread_.join();
+        written_bytes_ += staging_.size();
+        write_seconds_ += running_write_seconds_;
+    }
+}
+
+void CheckpointWriter::save(const string &path, const vector<BaseParam *> &params,
+        bool with_optimizer_states) {
+    auto begin = std::chrono::steady_clock::now();
+    wait();
+    Checkpoint::stage(params, with_optimizer_states, staging_);
+    thread_ = thread([this, path]() {
+        auto begin = std::chrono::steady_clock::now();
+        Checkpoint::writeAtomically(path, staging_);
+        running_write_seconds_ = secondsSince(begin);
+    });
+    last_stall_seconds_ = secondsSince(begin);
+    stall_seconds_ += last_stall_seconds_;
+}
+
+}
@@ -0,0 +1,129 @@
+#ifndef INSNET_CHECKPOINT_H
+#define INSNET_CHECKPOINT_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "insnet/param/base-param.h"
+#include "insnet/util/mapped-file.h"
+
+namespace insnet {
+
+/// Save the values of *params* to a checkpoint file that Checkpoint can memory-map.
+///
+/// The file contains a 64-byte header, the values of the params in 64-byte aligned blobs, and the manifest mapping the param names to the shapes and the offsets of the blobs. The k-th repeated name is suffixed with "#k" in the manifest, so params that share a name are matched in order. The file is written to a temporary file first and then renamed, and both the file and its directory are synced, so an existing checkpoint is never left half-written.
+///
+/// Note that frozen params are not returned by tunableParams() and should be passed explicitly.
+/// \param with_optimizer_states Whether to also save the first and second moments and the step counters of the optimizers, so that training can be resumed. *The default value is false.*
+void saveCheckpoint(const std::string &path, const std::vector<BaseParam *> &params,
+        bool with_optimizer_states = false);
+
+/// \brief The memory-mapped checkpoint file saved by saveCheckpoint or CheckpointWriter.
+///
+/// Loading by Checkpoint neither reads nor copies the values on CPU, so worker processes loading the same file start instantly and share the page cache.
+class Checkpoint {
+public:
+    Checkpoint(const std::string &path);
+
+    /// Returns whether the checkpoint has the param value of *name*.
+    bool contains(const std::string &name) const {
+        return entries_.find(name) != entries_.end();
+    }
+
+    /// Load the values of *params*.
+    ///
+    /// Without optimizer states on CPU, the params need not be initialized, and their values become frozen views of the read-only mapping by BaseParam::initFrozenView, which is kept alive by the params, so neither the values nor the optimizer moments are allocated, and the optimizer steps abort afterwards. Otherwise, the params should have been initialized with the same shapes as those saved, and the values and the states are copied, with the step counters restored to resume training. On GPU, they are always copied to the device. The bfloat16 copies of the values are refreshed if any.
+    void load(const std::vector<BaseParam *> &params, bool with_optimizer_states = false) const;
+
+private:
+    struct Entry {
+        int row;
+        int col;
+        int64_t offset;
+    };
+
+    const Entry &entry(const std::string &key, const Tensor2D &tensor) const;
+
+    /// Lay out the checkpoint of *params* in *buf*, which is reused across calls to avoid reallocation.
+    static void stage(const std::vector<BaseParam *> &params, bool with_optimizer_states,
+            std::vector<char> &buf);
+
+    /// Write *buf* to a temporary file in the directory of *path*, sync it and then rename it to *path*.
+    static void writeAtomically(const std::string &path, const std::vector<char> &buf);
+
+    std::shared_ptr<MappedFile> file_;
+    std::unordered_map<std::string, Entry> entries_;
+    std::unordered_map<std::string, std::vector<int>> iters_;
+
+    friend void saveCheckpoint(const std::string &path, const std::vector<BaseParam *> &params,
+            bool with_optimizer_states);
+    friend class CheckpointWriter;
+};
+
+/// \brief The checkpoint writer that writes files on a background thread.
+///
+/// save() only copies the params into a staging buffer on the calling thread, and the file is written as saveCheckpoint does by a background thread, so training stalls only for the copy, plus the wait for the previous write if it has not finished.
+///
+/// For example:
+/// \code{.cpp}
+/// CheckpointWriter writer;
+/// for (int epoch = 0; ; ++epoch) {
+///     // train ...
+///     writer.save(fmt::format("model-{}.ckpt", epoch), model.tunableParams());
+///     std::cout << fmt::format("stall:{}s throughput:{}MB/s\n", writer.lastStallSeconds(),
+///             writer.writeThroughput() / (1 << 20));
+/// }
+/// \endcode
+class CheckpointWriter {
+public:
+    CheckpointWriter() = default;
+
+    CheckpointWriter(const CheckpointWriter &) = delete;
+
+    /// Wait for the last write.
+    ~CheckpointWriter();
+
+    /// Snapshot *params* and write them to *path* in the background.
+    void save(const std::string &path, const std::vector<BaseParam *> &params,
+            bool with_optimizer_states = false);
+
+    /// Wait for the last write to finish.
+    void wait();
+
+    /// Returns the time that the last save() blocked the calling thread in seconds.
+    double lastStallSeconds() const {
+        return last_stall_seconds_;
+    }
+
+    /// Returns the total time that save() blocked the calling thread in seconds.
+    double stallSeconds() const {
+        return stall_seconds_;
+    }
+
+    /// Returns the number of bytes of the finished writes.
+    int64_t writtenBytes() const {
+        return written_bytes_;
+    }
+
+    /// Returns the write throughput of the finished writes in bytes per second.
+    double writeThroughput() const {
+        return write_seconds_ > 0 ? written_bytes_ / write_seconds_ : 0;
+    }
+
+private:
+    std::thread thread_;
+    std::vector<char> staging_;
+    double running_write_seconds_ = 0;
+
+    double last_stall_seconds_ = 0;
+    double stall_seconds_ = 0;
+    int64_t written_bytes_ = 0;
+    double write_seconds_ = 0;
+};
+
+}
+
+#endif
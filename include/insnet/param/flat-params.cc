@@ -0,0 +1,297 @@
+#include "insnet/param/flat-params.h"
+#include "insnet/util/util.h"
+#include "insnet/util/worker-pool.h"
+#include "insnet/param/update-kernel.h"
+#include <cstring>
+
+#if USE_GPU
+#include "insnet/cuda/insnet_cuda.h"
+#endif
+
+using std::vector;
+using std::function;
+using std::make_shared;
+using std::make_unique;
+using std::cerr;
+using std::endl;
+
+namespace insnet {
+
+namespace {
+
+/// The params smaller than this are updated by the calling thread only.
+const int MIN_THREAD_WORKLOAD = 1 << 16;
+
+/// Both paths run the same kernels on the same blocks, so they are compared bitwise.
+void checkEqual(const char *optimizer, const char *tensor, const vector<dtype> &fused,
+        const dtype *serial) {
+    if (memcmp(fused.data(), serial, fused.size() * sizeof(dtype)) == 0) {
+        return;
+    }
+    for (int i = 0; i < fused.size(); ++i) {
+        if (memcmp(&fused.at(i), serial + i, sizeof(dtype)) != 0) {
+            cerr << fmt::format("FlatParams {} validation - {} i:{} serial:{} fused:{}\n",
+                    optimizer, tensor, i, serial[i], fused.at(i));
+            abort();
+        }
+    }
+}
+}
+
+FlatParams::FlatParams(const vector<Param *> &params) {
+    for (Param *param : params) {
+        if (param->isFrozen()) {
+            cerr << fmt::format("FlatParams - {} is frozen\n", param->getParamName());
+            abort();
+        }
+    }
+    for (Param *param : params) {
+        if (!param->isBias()) {
+            params_.push_back(param);
+            bias_offset_ += param->val_.size;
+        }
+    }
+    int size = bias_offset_;
+    for (Param *param : params) {
+        if (param->isBias()) {
+            params_.push_back(param);
+            size += param->val_.size;
+        }
+    }
+    if (params_.empty()) {
+        cerr << "FlatParams - params are empty" << endl;
+        abort();
+    }
+    iter_ = params_.front()->iter_;
+    for (Param *param : params_) {
+        if (param->iter_ != iter_) {
+            cerr << fmt::format("FlatParams - {} iter:{} but {} iter:{}\n",
+                    param->getParamName(), param->iter_, params_.front()->getParamName(), iter_);
+            abort();
+        }
+    }
+
+    val_ = make_shared<Tensor2D>();
+    grad_ = make_shared<Tensor2D>();
+    aux_mean_ = make_shared<Tensor2D>();
+    aux_square_ = make_shared<Tensor2D>();
+#if USE_GPU
+    {
+        MemoryScope scope(MemoryCategory::PARAMETER_MEMORY);
+        val_->initOnMemoryAndDevice(size, 1);
+    }
+    {
+        MemoryScope scope(MemoryCategory::OPTIMIZER_STATE_MEMORY);
+        aux_mean_->initOnMemoryAndDevice(size, 1);
+        aux_square_->initOnMemoryAndDevice(size, 1);
+    }
+    {
+        MemoryScope scope(MemoryCategory::GRADIENT_MEMORY);
+        grad_->init(size, 1);
+    }
+    cuda::Memset(grad_->value, size, 0.0f);
+#else
+    {
+        MemoryScope scope(MemoryCategory::PARAMETER_MEMORY);
+        val_->init(size, 1);
+    }
+    {
+        MemoryScope scope(MemoryCategory::OPTIMIZER_STATE_MEMORY);
+        aux_mean_->init(size, 1);
+        aux_square_->init(size, 1);
+    }
+    {
+        MemoryScope scope(MemoryCategory::GRADIENT_MEMORY);
+        grad_->init(size, 1);
+    }
+#endif
+
+    int offset = 0;
+    for (Param *param : params_) {
+        int row = param->val_.row;
+        int col = param->val_.col;
+        int len = param->val_.size;
+        memcpy(val_->v + offset, param->val_.v, len * sizeof(dtype));
+        memcpy(aux_mean_->v + offset, param->aux_mean_.v, len * sizeof(dtype));
+        memcpy(aux_square_->v + offset, param->aux_square_.v, len * sizeof(dtype));
+#if USE_GPU
+        cuda::MyCudaMemcpy(val_->value + offset, param->val_.value, len * sizeof(dtype),
+                cuda::MyCudaMemcpyKind::DEVICE_TO_DEVICE);
+        cuda::MyCudaMemcpy(aux_mean_->value + offset, param->aux_mean_.value,
+                len * sizeof(dtype), cuda::MyCudaMemcpyKind::DEVICE_TO_DEVICE);
+        cuda::MyCudaMemcpy(aux_square_->value + offset, param->aux_square_.value,
+                len * sizeof(dtype), cuda::MyCudaMemcpyKind::DEVICE_TO_DEVICE);
+#endif
+        param->val_.initAsView(val_, offset, row, col);
+        param->aux_mean_.initAsView(aux_mean_, offset, row, col);
+        param->aux_square_.initAsView(aux_square_, offset, row, col);
+        param->grad_ = make_unique<Tensor2D>();
+        param->grad_->initAsView(grad_, offset, row, col);
+        for (int i = 0; i < len; i += UPDATE_BLOCK_SIZE) {
+            blocks_.push_back({offset + i, std::min(UPDATE_BLOCK_SIZE, len - i),
+                    param->isBias()});
+        }
+        offset += len;
+    }
+}
+
+FlatParams::~FlatParams() = default;
+
+void FlatParams::setThreadCount(int thread_count) {
+    thread_count_ = thread_count;
+    if (thread_count_ > 1) {
+        pool_ = make_unique<WorkerPool>(thread_count_);
+    } else {
+        pool_ = nullptr;
+    }
+}
+
+void FlatParams::zeroGrad() {
+#if USE_GPU
+    cuda::Memset(grad_->value, size(), 0.0f);
+#if TEST_CUDA
+    grad_->zero();
+#endif
+#else
+    grad_->zero();
+#endif
+}
+
+dtype FlatParams::gradSquareSum() {
+#if USE_GPU && !TEST_CUDA
+    return cuda::SquareSum(grad_->value, size());
+#else
+    dtype sum = 0;
+    for (int i = 0; i < size(); ++i) {
+        sum += grad_->v[i] * grad_->v[i];
+    }
+#if TEST_CUDA
+    dtype cuda_sum = cuda::SquareSum(grad_->value, size());
+    if (!isEqual(sum, cuda_sum)) {
+        cerr << fmt::format("FlatParams gradSquareSum - cpu:{} cuda:{}\n", sum, cuda_sum);
+    }
+#endif
+    return sum;
+#endif
+}
+
+void FlatParams::adagrad(dtype alpha, dtype reg, dtype eps, dtype grad_scale) {
+#if USE_GPU
+    cuda::UpdateFlatAdagrad(val_->value, grad_->value, size(), bias_offset_,
+            aux_square_->value, alpha, reg, eps, grad_scale);
+#endif
+#if !USE_GPU || TEST_CUDA
+    updateOnCpu("adagrad", [&](Vec val, Vec grad, Vec aux_mean, Vec aux_square,
+                bool is_bias) {
+        adagradUpdate(val, grad, aux_square, is_bias, grad_scale, alpha, reg, eps);
+    }, grad_scale, [&](Param &param) {
+        param.adagrad(alpha, reg, eps);
+    });
+#endif
+#if TEST_CUDA
+    cuda::Assert(val_->verify("FlatParams adagrad"));
+#endif
+}
+
+void FlatParams::adam(dtype belta1, dtype belta2, dtype alpha, dtype reg, dtype eps,
+        dtype grad_scale) {
+#if USE_GPU
+    cuda::UpdateFlatAdam(val_->value, grad_->value, size(), bias_offset_, aux_mean_->value,
+            aux_square_->value, iter_, belta1, belta2, alpha, reg, eps, grad_scale);
+#endif
+#if !USE_GPU || TEST_CUDA
+    dtype lr_t = adamLearningRate(belta1, belta2, alpha, iter_);
+    updateOnCpu("adam", [&](Vec val, Vec grad, Vec aux_mean, Vec aux_square, bool is_bias) {
+        adamUpdate(val, grad, aux_mean, aux_square, is_bias, grad_scale, belta1, belta2, lr_t,
+                reg, eps);
+    }, grad_scale, [&](Param &param) {
+        param.adam(belta1, belta2, alpha, reg, eps);
+    });
+#endif
+#if TEST_CUDA
+    cuda::Assert(val_->verify("FlatParams adam"));
+#endif
+    increaseIter();
+}
+
+void FlatParams::adamW(dtype belta1, dtype belta2, dtype alpha, dtype reg, dtype eps,
+        dtype grad_scale) {
+#if USE_GPU
+    cuda::UpdateFlatAdamW(val_->value, grad_->value, size(), bias_offset_, aux_mean_->value,
+            aux_square_->value, iter_, belta1, belta2, alpha, reg, eps, grad_scale);
+#endif
+#if !USE_GPU || TEST_CUDA
+    dtype lr_t = adamLearningRate(belta1, belta2, alpha, iter_);
+    updateOnCpu("adamW", [&](Vec val, Vec grad, Vec aux_mean, Vec aux_square, bool is_bias) {
+        adamWUpdate(val, grad, aux_mean, aux_square, is_bias, grad_scale, belta1, belta2, lr_t,
+                reg, eps);
+    }, grad_scale, [&](Param &param) {
+        param.adamW(belta1, belta2, alpha, reg, eps);
+    });
+#endif
+#if TEST_CUDA
+    cuda::Assert(val_->verify("FlatParams adamW"));
+#endif
+    increaseIter();
+}
+
+void FlatParams::updateOnCpu(const char *optimizer,
+        const function<void(Vec, Vec, Vec, Vec, bool)> &update, dtype grad_scale,
+        const function<void(Param &)> &serial_update) {
+    vector<dtype> val, grad, aux_mean, aux_square;
+    if (validation_) {
+        val.assign(val_->v, val_->v + size());
+        grad.assign(grad_->v, grad_->v + size());
+        aux_mean.assign(aux_mean_->v, aux_mean_->v + size());
+        aux_square.assign(aux_square_->v, aux_square_->v + size());
+    }
+
+    auto update_blocks = [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            const Block &block = blocks_.at(i);
+            update(Vec(val_->v + block.offset, block.size),
+                    Vec(grad_->v + block.offset, block.size),
+                    Vec(aux_mean_->v + block.offset, block.size),
+                    Vec(aux_square_->v + block.offset, block.size), block.is_bias);
+        }
+    };
+    int thread_count = std::min(thread_count_, std::max(size() / MIN_THREAD_WORKLOAD, 1));
+    if (pool_ == nullptr || thread_count == 1) {
+        update_blocks(0, blocks_.size());
+    } else {
+        pool_->parallelFor(blocks_.size(), thread_count, update_blocks);
+    }
+
+#if !USE_GPU
+    if (validation_) {
+        // The params are views of the buffers, so the fused results are set aside, the
+        // buffers are restored and the params are updated one by one in place.
+        vector<dtype> fused_val(val_->v, val_->v + size());
+        vector<dtype> fused_aux_mean(aux_mean_->v, aux_mean_->v + size());
+        vector<dtype> fused_aux_square(aux_square_->v, aux_square_->v + size());
+        memcpy(val_->v, val.data(), size() * sizeof(dtype));
+        memcpy(grad_->v, grad.data(), size() * sizeof(dtype));
+        memcpy(aux_mean_->v, aux_mean.data(), size() * sizeof(dtype));
+        memcpy(aux_square_->v, aux_square.data(), size() * sizeof(dtype));
+        if (grad_scale != 1) {
+            grad_->vec() = grad_->vec() * grad_scale;
+        }
+        for (Param *param : params_) {
+            serial_update(*param);
+            param->iter_ = iter_;
+        }
+        checkEqual(optimizer, "val", fused_val, val_->v);
+        checkEqual(optimizer, "aux_mean", fused_aux_mean, aux_mean_->v);
+        checkEqual(optimizer, "aux_square", fused_aux_square, aux_square_->v);
+    }
+#endif
+}
+
+void FlatParams::increaseIter() {
+    ++iter_;
+    for (Param *param : params_) {
+        param->iter_ = iter_;
+    }
+}
+
+}
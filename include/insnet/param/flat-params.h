@@ -0,0 +1,77 @@
+#ifndef INSNET_FLAT_PARAMS_H
+#define INSNET_FLAT_PARAMS_H
+
+#include "insnet/param/param.h"
+
+namespace insnet {
+
+class WorkerPool;
+
+/// \brief The contiguous buffers of the values, grads and optimizer moments of dense params.
+///
+/// Once flattened, each param's tensors are views of the buffers, so the grads persist across steps and are zeroed by one memset, and the optimizers update all the params by one fused pass instead of a call per param.
+class FlatParams {
+public:
+    /// Copy the values and moments of *params* into the buffers and make the params views of them.
+    ///
+    /// The biases are put behind the other params, so the L2 penalty and weight decay apply only to the elements before biasOffset(). The params should have the same iteration count, and their grads are reset to zero.
+    FlatParams(const std::vector<Param *> &params);
+
+    ~FlatParams();
+
+    int size() const {
+        return val_->size;
+    }
+
+    int biasOffset() const {
+        return bias_offset_;
+    }
+
+    /// Set the number of CPU threads updating the params, each of which updates a contiguous chunk. The threads other than the calling one are kept in a pool across steps. *The default value is 1.*
+    void setThreadCount(int thread_count);
+
+    /// If *validation* is true, the CPU updates will be checked to be bitwise equal to those of Param::adagrad, Param::adam and Param::adamW run param by param, which is slow, CPU-only and intended for testing.
+    void setValidation(bool validation) {
+        validation_ = validation;
+    }
+
+    void zeroGrad();
+
+    dtype gradSquareSum();
+
+    /// The grads are multiplied by *grad_scale* on the fly, which saves a pass for gradient clipping.
+    void adagrad(dtype alpha, dtype reg, dtype eps, dtype grad_scale = 1);
+
+    void adam(dtype belta1, dtype belta2, dtype alpha, dtype reg, dtype eps,
+            dtype grad_scale = 1);
+
+    void adamW(dtype belta1, dtype belta2, dtype alpha, dtype reg, dtype eps,
+            dtype grad_scale = 1);
+
+private:
+    void increaseIter();
+
+    /// Run *update* on the blocks of (val, grad, aux_mean, aux_square, is_bias) in parallel, and in the validation mode check the results against those of running *serial_update* on each param with the grads multiplied by *grad_scale*.
+    void updateOnCpu(const char *optimizer,
+            const std::function<void(Vec, Vec, Vec, Vec, bool)> &update, dtype grad_scale,
+            const std::function<void(Param &)> &serial_update);
+
+    struct Block {
+        int offset;
+        int size;
+        bool is_bias;
+    };
+
+    std::vector<Param *> params_;
+    std::shared_ptr<Tensor2D> val_, grad_, aux_mean_, aux_square_;
+    std::vector<Block> blocks_;
+    int bias_offset_ = 0;
+    int iter_ = 0;
+    int thread_count_ = 1;
+    std::unique_ptr<WorkerPool> pool_;
+    bool validation_ = false;
+};
+
+}
+
+#endif
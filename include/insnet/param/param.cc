@@ -1,6 +1,7 @@
 #include "insnet/param/param.h"
 #include "insnet/cuda/insnet_cuda.h"
 #include "insnet/util/util.h"
+#include "insnet/param/update-kernel.h"
 
 using std::function;
 using std::vector;
@@ -10,17 +11,40 @@ using std::endl;
 
 namespace insnet {
 
+namespace {
+
+/// Run *update* on the blocks of (val, grad, aux_mean, aux_square) in order, as FlatParams does on those of the param.
+void updateInBlocks(Tensor2D &val, Tensor2D &grad, Tensor2D &aux_mean, Tensor2D &aux_square,
+        const function<void(Vec, Vec, Vec, Vec)> &update) {
+    for (int i = 0; i < val.size; i += UPDATE_BLOCK_SIZE) {
+        int size = std::min(UPDATE_BLOCK_SIZE, val.size - i);
+        update(Vec(val.v + i, size), Vec(grad.v + i, size), Vec(aux_mean.v + i, size),
+                Vec(aux_square.v + i, size));
+    }
+}
+
+}
+
 void Param::init(int outDim, int inDim, const function<dtype(int, int)> *cal_bound,
         InitDistribution dist) {
+    {
+        MemoryScope scope(MemoryCategory::PARAMETER_MEMORY);
 #if USE_GPU
-    val_.initOnMemoryAndDevice(outDim, inDim);
-    aux_square_.initOnMemoryAndDevice(outDim, inDim);
-    aux_mean_.initOnMemoryAndDevice(outDim, inDim);
+        val_.initOnMemoryAndDevice(outDim, inDim);
 #else
-    val_.init(outDim, inDim);
-    aux_square_.init(outDim, inDim);
-    aux_mean_.init(outDim, inDim);
+        val_.init(outDim, inDim);
 #endif
+    }
+    {
+        MemoryScope scope(MemoryCategory::OPTIMIZER_STATE_MEMORY);
+#if USE_GPU
+        aux_square_.initOnMemoryAndDevice(outDim, inDim);
+        aux_mean_.initOnMemoryAndDevice(outDim, inDim);
+#else
+        aux_square_.init(outDim, inDim);
+        aux_mean_.init(outDim, inDim);
+#endif
+    }
     if (isBias()) {
         val_.assignAll(0.0f);
     } else {
@@ -52,23 +76,27 @@ void Param::rescaleGrad(dtype scale) {
 }
 
 void Param::adagrad(dtype alpha, dtype reg, dtype eps) {
+    checkWritable("Param adagrad");
 #if USE_GPU
     cuda::UpdateAdagrad(val_.value, grad_->value, val_.row, val_.col,
             aux_square_.value, alpha, reg, eps);
 #if TEST_CUDA
-    if (!isBias()) grad_->vec() = grad_->vec() + val_.vec() * reg;
-    aux_square_.vec() = aux_square_.vec() + grad_->vec().square();
-    val_.vec() = val_.vec() - grad_->vec() * alpha / (aux_square_.vec() + eps).sqrt();
+    updateInBlocks(val_, *grad_, aux_mean_, aux_square_,
+            [&](Vec val, Vec grad, Vec aux_mean, Vec aux_square) {
+        adagradUpdate(val, grad, aux_square, isBias(), 1, alpha, reg, eps);
+    });
     cuda::Assert(val_.verify("Param adagrad"));
 #endif
 #else
-    if (!isBias()) grad_->vec() = grad_->vec() + val_.vec() * reg;
-    aux_square_.vec() = aux_square_.vec() + grad_->vec().square();
-    val_.vec() = val_.vec() - grad_->vec() * alpha / (aux_square_.vec() + eps).sqrt();
+    updateInBlocks(val_, *grad_, aux_mean_, aux_square_,
+            [&](Vec val, Vec grad, Vec aux_mean, Vec aux_square) {
+        adagradUpdate(val, grad, aux_square, isBias(), 1, alpha, reg, eps);
+    });
 #endif
 }
 
 void Param::adam(dtype belta1, dtype belta2, dtype alpha, dtype reg, dtype eps) {
+    checkWritable("Param adam");
 #if USE_GPU
 #if TEST_CUDA
     cuda::Assert(val_.verify("Param adam begin val"));
@@ -86,24 +114,27 @@ void Param::adam(dtype belta1, dtype belta2, dtype alpha, dtype reg, dtype eps)
             reg,
             eps);
 #if TEST_CUDA
-    if (!isBias()) grad_->vec() = grad_->vec() + val_.vec() * reg;
-    aux_mean_.vec() = belta1 * aux_mean_.vec() + (1 - belta1) * grad_->vec();
-    aux_square_.vec() = belta2 * aux_square_.vec() + (1 - belta2) * grad_->vec().square();
-    dtype lr_t = alpha * sqrt(1 - pow(belta2, iter_ + 1)) / (1 - pow(belta1, iter_ + 1));
-    val_.vec() = val_.vec() - aux_mean_.vec() * lr_t / (aux_square_.vec() + eps).sqrt();
+    dtype lr_t = adamLearningRate(belta1, belta2, alpha, iter_);
+    updateInBlocks(val_, *grad_, aux_mean_, aux_square_,
+            [&](Vec val, Vec grad, Vec aux_mean, Vec aux_square) {
+        adamUpdate(val, grad, aux_mean, aux_square, isBias(), 1, belta1, belta2, lr_t, reg,
+                eps);
+    });
     cuda::Assert(val_.verify("Param adam"));
 #endif
 #else
-    if (!isBias()) grad_->vec() = grad_->vec() + val_.vec() * reg;
-    aux_mean_.vec() = belta1 * aux_mean_.vec() + (1 - belta1) * grad_->vec();
-    aux_square_.vec() = belta2 * aux_square_.vec() + (1 - belta2) * grad_->vec().square();
-    dtype lr_t = alpha * sqrt(1 - pow(belta2, iter_ + 1)) / (1 - pow(belta1, iter_ + 1));
-    val_.vec() = val_.vec() - aux_mean_.vec() * lr_t / (aux_square_.vec() + eps).sqrt();
+    dtype lr_t = adamLearningRate(belta1, belta2, alpha, iter_);
+    updateInBlocks(val_, *grad_, aux_mean_, aux_square_,
+            [&](Vec val, Vec grad, Vec aux_mean, Vec aux_square) {
+        adamUpdate(val, grad, aux_mean, aux_square, isBias(), 1, belta1, belta2, lr_t, reg,
+                eps);
+    });
 #endif
     iter_++;
 }
 
 void Param::adamW(dtype belta1, dtype belta2, dtype alpha, dtype reg, dtype eps) {
+    checkWritable("Param adamW");
 #if USE_GPU
 #if TEST_CUDA
     cuda::Assert(val_.verify("Param adam begin val"));
@@ -114,19 +145,21 @@ void Param::adamW(dtype belta1, dtype belta2, dtype alpha, dtype reg, dtype eps)
     cuda::UpdateAdamW(val_.value, grad_->value, val_.row, val_.col, isBias(), aux_mean_.value,
             aux_square_.value, iter_, belta1, belta2, alpha, reg, eps);
 #if TEST_CUDA
-    aux_mean_.vec() = belta1 * aux_mean_.vec() + (1 - belta1) * grad_->vec();
-    aux_square_.vec() = belta2 * aux_square_.vec() + (1 - belta2) * grad_->vec().square();
-    dtype lr_t = alpha * sqrt(1 - pow(belta2, iter_ + 1)) / (1 - pow(belta1, iter_ + 1));
-    val_.vec() = (1 - (isBias() ? 0.0f : reg)) * val_.vec() -
-        aux_mean_.vec() * lr_t / (aux_square_.vec() + eps).sqrt();
+    dtype lr_t = adamLearningRate(belta1, belta2, alpha, iter_);
+    updateInBlocks(val_, *grad_, aux_mean_, aux_square_,
+            [&](Vec val, Vec grad, Vec aux_mean, Vec aux_square) {
+        adamWUpdate(val, grad, aux_mean, aux_square, isBias(), 1, belta1, belta2, lr_t, reg,
+                eps);
+    });
     cuda::Assert(val_.verify("Param adam"));
 #endif
 #else
-    aux_mean_.vec() = belta1 * aux_mean_.vec() + (1 - belta1) * grad_->vec();
-    aux_square_.vec() = belta2 * aux_square_.vec() + (1 - belta2) * grad_->vec().square();
-    dtype lr_t = alpha * sqrt(1 - pow(belta2, iter_ + 1)) / (1 - pow(belta1, iter_ + 1));
-    val_.vec() = (1 - (isBias() ? 0.0f : reg)) * val_.vec() -
-        aux_mean_.vec() * lr_t / (aux_square_.vec() + eps).sqrt();
+    dtype lr_t = adamLearningRate(belta1, belta2, alpha, iter_);
+    updateInBlocks(val_, *grad_, aux_mean_, aux_square_,
+            [&](Vec val, Vec grad, Vec aux_mean, Vec aux_square) {
+        adamWUpdate(val, grad, aux_mean, aux_square, isBias(), 1, belta1, belta2, lr_t, reg,
+                eps);
+    });
 #endif
     iter_++;
 }
@@ -58,8 +58,19 @@ public:
         ar(val_, aux_square_, aux_mean_, iter_);
     }
 
+protected:
+    std::vector<int> optimizerIters() override {
+        return {iter_};
+    }
+
+    void setOptimizerIters(const std::vector<int> &iters) override {
+        iter_ = iters.front();
+    }
+
 private:
     int iter_ = 0;
+
+    friend class FlatParams;
 };
 
 template<typename ParamType>
@@ -2,15 +2,16 @@
 #include "insnet/util/util.h"
 
 using std::vector;
+using std::max;
+using std::make_unique;
+using std::swap;
+using std::copy;
 
 namespace insnet {
 
 SparseParam::~SparseParam() {
 #if USE_GPU
-    if (dIndexers == nullptr) {
-        delete dIndexers;
-    }
-    if (dIters == nullptr) {
+    if (dIters != nullptr) {
         delete dIters;
     }
 #endif
@@ -35,140 +36,186 @@ void SparseParam::copyFromDeviceToHost() {
 #endif
 
 void SparseParam::init(int outDim, int inDim) {
+    {
+        MemoryScope scope(MemoryCategory::PARAMETER_MEMORY);
+#if USE_GPU
+        val_.initOnMemoryAndDevice(outDim, inDim);
+#else
+        val_.init(outDim, inDim);
+#endif
+    }
+    {
+        MemoryScope scope(MemoryCategory::OPTIMIZER_STATE_MEMORY);
 #if USE_GPU
-    val_.initOnMemoryAndDevice(outDim, inDim);
-    aux_square_.initOnMemoryAndDevice(outDim, inDim);
-    aux_mean_.initOnMemoryAndDevice(outDim, inDim);
+        aux_square_.initOnMemoryAndDevice(outDim, inDim);
+        aux_mean_.initOnMemoryAndDevice(outDim, inDim);
 #else
-    val_.init(outDim, inDim);
-    aux_square_.init(outDim, inDim);
-    aux_mean_.init(outDim, inDim);
+        aux_square_.init(outDim, inDim);
+        aux_mean_.init(outDim, inDim);
 #endif
+    }
     dtype bound = sqrt(6.0 / (outDim + inDim));
     val_.random(bound);
-    indexers.resize(inDim);
-    indexers = false;
-    last_update.resize(inDim);
+    initMetadata(outDim, inDim);
+#if USE_GPU
+    cuda::Memset(aux_square_.value, inDim * outDim, 0.0f);
+    cuda::Memset(aux_mean_.value, inDim * outDim, 0.0f);
+#endif
+}
+
+void SparseParam::initMetadata(int row, int col) {
+    slots_.assign(col, -1);
+    last_update.resize(col);
     last_update = 0;
 #if USE_GPU
-    dIndexers = new cuda::BoolArray;
     dIters = new cuda::IntArray;
-    dIndexers->init(indexers.c_buf(), indexers.size());
     dIters->init(last_update.c_buf(), last_update.size());
-    cuda::Memset(aux_square_.value, inDim * outDim, 0.0f);
-    cuda::Memset(aux_mean_.value, inDim * outDim, 0.0f);
 #endif
 }
 
-void SparseParam::initAndZeroGrad() {
-    BaseParam::initAndZeroGrad();
+vector<int> SparseParam::optimizerIters() {
 #if USE_GPU
-    cuda::Memset(dIndexers->value, grad_->col, false);
-#if TEST_CUDA
-    int inDim = indexers.size();
-    for (int index = 0; index < inDim; index++) {
-        for (int idx = 0; idx < grad().row; idx++) {
-            (*grad_)[index][idx] = 0;
-        }
+    cuda::MyCudaMemcpy(last_update.c_buf(), dIters->value, sizeof(int) * dIters->len,
+            cuda::MyCudaMemcpyKind::DEVICE_TO_HOST);
+#endif
+    return vector<int>(last_update.c_buf(), last_update.c_buf() + last_update.size());
+}
+
+void SparseParam::setOptimizerIters(const vector<int> &iters) {
+    copy(iters.begin(), iters.end(), last_update.c_buf());
+#if USE_GPU
+    cuda::MyCudaMemcpy(dIters->value, last_update.c_buf(), sizeof(int) * dIters->len,
+            cuda::MyCudaMemcpyKind::HOST_TO_DEVICE);
+#endif
+}
+
+void SparseParam::releaseGrad() {
+    for (int id : touched_ids_) {
+        slots_[id] = -1;
     }
-    indexers = false;
-    cuda::Assert(grad_->verify("SparseParam clearGrad"));
-    cuda::Assert(cuda::Verify(indexers.c_buf(),
-                dIndexers->value, grad_->col, "SparseParam indexers"));
+    touched_ids_.clear();
+    grad_columns_.clear();
+#if USE_GPU
+    d_zeroed_slot_count_ = 0;
 #endif
-#else
-    indexers = false;
+}
+
+int SparseParam::gradSlot(int id) {
+    int &slot = slots_[id];
+    if (slot < 0) {
+        slot = touched_ids_.size();
+        touched_ids_.push_back(id);
+#if !USE_GPU || TEST_CUDA
+        grad_columns_.resize(touched_ids_.size() * val_.row, 0);
 #endif
+    }
+    return slot;
 }
 
-void SparseParam::adagrad(dtype alpha, dtype reg, dtype eps) {
 #if USE_GPU
-    cuda::UpdateAdagrad(val_.value, grad_->value, indexers.size(),
-            grad_->col, aux_square_.value, dIndexers->value, alpha, reg, eps);
-#if TEST_CUDA
-    int inDim = indexers.size();
-    for (int index = 0; index < inDim; index++) {
-        if (!indexers[index]) continue;
-        for (int idx = 0; idx < grad_->row; idx++) {
-            (*grad_)[index][idx] = (*grad_)[index][idx] + val_[index][idx] * reg;
-            aux_square_[index][idx] = aux_square_[index][idx] +
-                (*grad_)[index][idx] * (*grad_)[index][idx];
-            val_[index][idx] = val_[index][idx] - (*grad_)[index][idx] * alpha /
-                sqrt(aux_square_[index][idx] + eps);
+dtype *SparseParam::deviceGradColumns() {
+    int row = val_.row;
+    int count = touched_ids_.size();
+    if (d_grad_columns_ == nullptr) {
+        d_grad_columns_ = make_unique<cuda::NumberArray>();
+    }
+    if (count * row > d_grad_columns_->len) {
+        cuda::NumberArray enlarged;
+        enlarged.init(max(2 * d_grad_columns_->len, count * row));
+        if (d_zeroed_slot_count_ > 0) {
+            cuda::MyCudaMemcpy(enlarged.value, d_grad_columns_->value,
+                    d_zeroed_slot_count_ * row * sizeof(dtype),
+                    cuda::MyCudaMemcpyKind::DEVICE_TO_DEVICE);
         }
+        swap(enlarged.value, d_grad_columns_->value);
+        swap(enlarged.len, d_grad_columns_->len);
+    }
+    if (count > d_zeroed_slot_count_) {
+        cuda::Memset(d_grad_columns_->value + d_zeroed_slot_count_ * row,
+                (count - d_zeroed_slot_count_) * row, 0.0f);
+        d_zeroed_slot_count_ = count;
     }
+    return d_grad_columns_->value;
+}
 
-    cuda::Assert(val_.verify("SparseParam updateAdagrad"));
+int *SparseParam::deviceTouchedIds() {
+    if (d_touched_ids_ == nullptr) {
+        d_touched_ids_ = make_unique<cuda::IntArray>();
+    }
+    d_touched_ids_->init(touched_ids_.data(), touched_ids_.size());
+    return d_touched_ids_->value;
+}
+
+#if TEST_CUDA
+bool SparseParam::verifyGrad(const char *message) {
+    return cuda::Verify(grad_columns_.data(), deviceGradColumns(), grad_columns_.size(),
+            message);
+}
 #endif
-#else
-    int inDim = indexers.size();
-    for (int index = 0; index < inDim; index++) {
-        if (!indexers[index]) continue;
-        for (int idx = 0; idx < grad_->row; idx++) {
-            (*grad_)[index][idx] = (*grad_)[index][idx] + val_[index][idx] * reg;
-            aux_square_[index][idx] = aux_square_[index][idx] + (*grad_)[index][idx] *
-                (*grad_)[index][idx];
-            val_[index][idx] = val_[index][idx] - (*grad_)[index][idx] * alpha /
+#endif
+
+void SparseParam::adagrad(dtype alpha, dtype reg, dtype eps) {
+    checkWritable("SparseParam adagrad");
+    if (touched_ids_.empty()) {
+        return;
+    }
+#if USE_GPU
+    cuda::UpdateSparseAdagrad(val_.value, deviceGradColumns(), val_.row, deviceTouchedIds(),
+            touched_ids_.size(), aux_square_.value, alpha, reg, eps);
+#endif
+#if !USE_GPU || TEST_CUDA
+    int row = val_.row;
+    for (int slot = 0; slot < touched_ids_.size(); ++slot) {
+        int index = touched_ids_.at(slot);
+        dtype *grad = grad_columns_.data() + slot * row;
+        for (int idx = 0; idx < row; idx++) {
+            grad[idx] = grad[idx] + val_[index][idx] * reg;
+            aux_square_[index][idx] = aux_square_[index][idx] + grad[idx] * grad[idx];
+            val_[index][idx] = val_[index][idx] - grad[idx] * alpha /
                 sqrt(aux_square_[index][idx] + eps);
         }
     }
 #endif
+#if TEST_CUDA
+    cuda::Assert(val_.verify("SparseParam updateAdagrad"));
+#endif
 }
 
 void SparseParam::adam(dtype belta1, dtype belta2, dtype alpha, dtype reg, dtype eps) {
-#if USE_GPU
-    cuda::UpdateAdam(val_.value, grad_->value, grad_->row, indexers.size(), aux_mean_.value,
-            aux_square_.value, dIndexers->value, dIters->value, belta1, belta2, alpha, reg, eps);
-#if TEST_CUDA
-    dtype lr_t;
-    int inDim = indexers.size();
-    for (int index = 0; index < inDim; index++) {
-        if (!indexers[index]) continue;
-        for (int idx = 0; idx < grad_->row; idx++) {
-            (*grad_)[index][idx] = (*grad_)[index][idx] + val_[index][idx] * reg;
-            aux_mean_[index][idx] = belta1 * aux_mean_[index][idx] +
-                (1 - belta1) * (*grad_)[index][idx];
-            aux_square_[index][idx] = belta2 * aux_square_[index][idx] +
-                (1 - belta2) * (*grad_)[index][idx] * (*grad_)[index][idx];
-            lr_t = alpha * sqrt(1 - pow(belta2, last_update[index] + 1)) /
-                (1 - pow(belta1, last_update[index] + 1));
-            val_[index][idx] = val_[index][idx] - aux_mean_[index][idx] * lr_t /
-                sqrt(aux_square_[index][idx] + eps);
-        }
-        last_update[index]++;
+    checkWritable("SparseParam adam");
+    if (touched_ids_.empty()) {
+        return;
     }
-
-    cuda::Assert(val_.verify("SparseParam updateAdam"));
+#if USE_GPU
+    cuda::UpdateSparseAdam(val_.value, deviceGradColumns(), val_.row, deviceTouchedIds(),
+            touched_ids_.size(), aux_mean_.value, aux_square_.value, dIters->value, belta1,
+            belta2, alpha, reg, eps);
 #endif
-#else
-    dtype lr_t;
-    int inDim = indexers.size();
-    for (int index = 0; index < inDim; index++) {
-        if (!indexers[index]) continue;
-        for (int idx = 0; idx < grad_->row; idx++) {
-            (*grad_)[index][idx] = (*grad_)[index][idx] + val_[index][idx] * reg;
-            aux_mean_[index][idx] = belta1 * aux_mean_[index][idx] + (1 - belta1) *
-                (*grad_)[index][idx];
+#if !USE_GPU || TEST_CUDA
+    int row = val_.row;
+    for (int slot = 0; slot < touched_ids_.size(); ++slot) {
+        int index = touched_ids_.at(slot);
+        dtype *grad = grad_columns_.data() + slot * row;
+        dtype lr_t = alpha * sqrt(1 - pow(belta2, last_update[index] + 1)) /
+            (1 - pow(belta1, last_update[index] + 1));
+        for (int idx = 0; idx < row; idx++) {
+            grad[idx] = grad[idx] + val_[index][idx] * reg;
+            aux_mean_[index][idx] = belta1 * aux_mean_[index][idx] + (1 - belta1) * grad[idx];
             aux_square_[index][idx] = belta2 * aux_square_[index][idx] + (1 - belta2) *
-                (*grad_)[index][idx] * (*grad_)[index][idx];
-            lr_t = alpha * sqrt(1 - pow(belta2, last_update[index] + 1)) /
-                (1 - pow(belta1, last_update[index] + 1));
+                grad[idx] * grad[idx];
             val_[index][idx] = val_[index][idx] - aux_mean_[index][idx] * lr_t /
                 sqrt(aux_square_[index][idx] + eps);
         }
         last_update[index]++;
     }
 #endif
+#if TEST_CUDA
+    cuda::Assert(val_.verify("SparseParam updateAdam"));
+#endif
 }
 
 void SparseParam::randpoint(int& idx, int &idy) {
-    vector<int> idRows, idCols;
-    int inDim = indexers.size();
-    for (int index = 0; index < inDim; index++) {
-        if (!indexers[index]) continue;
-        idCols.push_back(index);
-    }
-
+    vector<int> idRows, idCols = touched_ids_;
     for (int i = 0; i < val_.row; i++) {
         idRows.push_back(i);
     }
@@ -181,64 +228,42 @@ void SparseParam::randpoint(int& idx, int &idy) {
 }
 
 dtype SparseParam::gradSquareSum() {
-#if USE_GPU && !TEST_CUDA
-    dtype result = cuda::SquareSum(grad_->value, dIndexers->value,
-            indexers.size(), val_.row);
-    return result;
-#elif USE_GPU && TEST_CUDA
-    grad_->copyFromDeviceToHost();
-    dtype sumNorm = 0.0;
-    int inDim = indexers.size();
-    for (int index = 0; index < inDim; index++) {
-        if (!indexers[index]) continue;
-        for (int idx = 0; idx < val_.row; idx++) {
-            sumNorm += (*grad_)[index][idx] * (*grad_)[index][idx];
-        }
+    int len = touched_ids_.size() * val_.row;
+    if (len == 0) {
+        return 0;
     }
-
-
-    cuda::Assert(cuda::Verify(indexers.c_buf(), dIndexers->value, indexers.size(),
-                "sparse squareGradNorm"));
-    cuda::Assert(grad_->verify("squareGradNorm grad"));
-    dtype cuda = cuda::SquareSum(grad_->value, dIndexers->value, inDim, val_.row);
-    cuda::Assert(insnet::isEqual(cuda, sumNorm));
-
-    return sumNorm;
+#if USE_GPU && !TEST_CUDA
+    return cuda::SquareSum(deviceGradColumns(), len);
 #else
     dtype sumNorm = 0.0;
-    int inDim = indexers.size();
-    for (int index = 0; index < inDim; index++) {
-        if (!indexers[index]) continue;
-        for (int idx = 0; idx < val_.row; idx++) {
-            sumNorm += (*grad_)[index][idx] * (*grad_)[index][idx];
-        }
+    for (int i = 0; i < len; ++i) {
+        sumNorm += grad_columns_.at(i) * grad_columns_.at(i);
     }
-
+#if TEST_CUDA
+    cuda::Assert(verifyGrad("squareGradNorm grad"));
+    dtype cuda = cuda::SquareSum(deviceGradColumns(), len);
+    cuda::Assert(insnet::isEqual(cuda, sumNorm));
+#endif
     return sumNorm;
 #endif
 }
 
 void SparseParam::rescaleGrad(dtype scale) {
-#if USE_GPU
-    cuda::Rescale(grad_->value, grad_->size, scale);
-#if TEST_CUDA
-    int inDim = indexers.size();
-    for (int index = 0; index < inDim; index++) {
-        for (int idx = 0; idx < val_.row; idx++) {
-            (*grad_)[index][idx] = (*grad_)[index][idx] * scale;
-        }
+    int len = touched_ids_.size() * val_.row;
+    if (len == 0) {
+        return;
     }
-    cuda::Assert(grad_->verify("SparseParam rescaleGrad"));
+#if USE_GPU
+    cuda::Rescale(deviceGradColumns(), len, scale);
 #endif
-#else
-    int inDim = indexers.size();
-    for (int index = 0; index < inDim; index++) {
-        if (!indexers[index]) continue;
-        for (int idx = 0; idx < val_.row; idx++) {
-            (*grad_)[index][idx] = (*grad_)[index][idx] * scale;
-        }
+#if !USE_GPU || TEST_CUDA
+    for (int i = 0; i < len; ++i) {
+        grad_columns_.at(i) = grad_columns_.at(i) * scale;
     }
 #endif
+#if TEST_CUDA
+    cuda::Assert(verifyGrad("SparseParam rescaleGrad"));
+#endif
 }
 
 }
@@ -7,6 +7,9 @@
 
 namespace insnet {
 
+/// \brief The parameter matrix whose gradients are sparse, typically an embedding table.
+///
+/// The grads are row-sparse: only the columns touched by embedding lookups since the last step have grads, which are kept in a compact block in the order of the first touch, so neither memory nor time per step grows with the vocabulary. grad() is not available for SparseParam.
 class SparseParam : public BaseParam {
 public:
     SparseParam(const std::string &name = "sparse") : BaseParam(name) {}
@@ -21,7 +24,15 @@ public:
 
     void init(int outDim, int inDim) override;
 
-    void initAndZeroGrad() override;
+    /// The row-sparse grads need no initialization.
+    void initAndZeroGrad() override {}
+
+    /// Forget the touched columns, keeping the memory of the compact block for the next step.
+    void releaseGrad() override;
+
+    void zeroGrad() override {
+        releaseGrad();
+    }
 
     void adagrad(dtype alpha, dtype reg, dtype eps) override;
 
@@ -42,18 +53,63 @@ public:
         return true;
     }
 
+    /// Returns the slot of the column of *id* in the compact grad block, assigning a zeroed one if the column has not been touched since the last step.
+    int gradSlot(int id);
+
+    /// Returns the host grad of the column of *id*, which is called by the backward of embedding.
+    dtype *gradColumn(int id) {
+        int slot = gradSlot(id);
+        return grad_columns_.data() + slot * val_.row;
+    }
+
+    /// Returns the IDs of the touched columns, where the i-th ID's grad is in slot i.
+    const std::vector<int> &touchedIds() const {
+        return touched_ids_;
+    }
+
+#if USE_GPU
+    /// Returns the device memory of the compact grad block, enlarging it if necessary and zeroing the slots assigned since the last call.
+    dtype *deviceGradColumns();
+
+#if TEST_CUDA
+    bool verifyGrad(const char *message);
+#endif
+#endif
+
     template<typename Archive>
     void serialize(Archive &ar) {
         ar(val_, aux_square_, aux_mean_);
     }
 
 #if USE_GPU
-    cuda::BoolArray *dIndexers = nullptr;
     cuda::IntArray *dIters = nullptr;
 #endif
 
+protected:
+    void initMetadata(int row, int col) override;
+
+    /// Returns the per-column step counters of adam.
+    std::vector<int> optimizerIters() override;
+
+    void setOptimizerIters(const std::vector<int> &iters) override;
+
 private:
-    nr::NRVec<bool> indexers;
+#if USE_GPU
+    /// Upload the touched IDs, returning their device memory.
+    int *deviceTouchedIds();
+#endif
+
+    std::vector<int> touched_ids_;
+
+    /// The slots of the columns in the compact grad block, or -1 if they are not touched.
+    std::vector<int> slots_;
+
+    std::vector<dtype> grad_columns_;
+#if USE_GPU
+    std::unique_ptr<cuda::NumberArray> d_grad_columns_ = nullptr;
+    int d_zeroed_slot_count_ = 0;
+    std::unique_ptr<cuda::IntArray> d_touched_ids_ = nullptr;
+#endif
     nr::NRVec<int> last_update; // TODO historical code which should be modified to use STL instead.
 };
 
@@ -0,0 +1,34 @@
+#include "insnet/param/update-kernel.h"
+
+namespace insnet {
+
+dtype adamLearningRate(dtype belta1, dtype belta2, dtype alpha, int iter) {
+    return alpha * sqrt(1 - pow(belta2, iter + 1)) / (1 - pow(belta1, iter + 1));
+}
+
+void adagradUpdate(Vec val, Vec grad, Vec aux_square, bool is_bias, dtype grad_scale,
+        dtype alpha, dtype reg, dtype eps) {
+    if (grad_scale != 1) grad = grad * grad_scale;
+    if (!is_bias) grad = grad + val * reg;
+    aux_square = aux_square + grad.square();
+    val = val - grad * alpha / (aux_square + eps).sqrt();
+}
+
+void adamUpdate(Vec val, Vec grad, Vec aux_mean, Vec aux_square, bool is_bias,
+        dtype grad_scale, dtype belta1, dtype belta2, dtype lr_t, dtype reg, dtype eps) {
+    if (grad_scale != 1) grad = grad * grad_scale;
+    if (!is_bias) grad = grad + val * reg;
+    aux_mean = belta1 * aux_mean + (1 - belta1) * grad;
+    aux_square = belta2 * aux_square + (1 - belta2) * grad.square();
+    val = val - aux_mean * lr_t / (aux_square + eps).sqrt();
+}
+
+void adamWUpdate(Vec val, Vec grad, Vec aux_mean, Vec aux_square, bool is_bias,
+        dtype grad_scale, dtype belta1, dtype belta2, dtype lr_t, dtype reg, dtype eps) {
+    if (grad_scale != 1) grad = grad * grad_scale;
+    aux_mean = belta1 * aux_mean + (1 - belta1) * grad;
+    aux_square = belta2 * aux_square + (1 - belta2) * grad.square();
+    val = (1 - (is_bias ? 0.0f : reg)) * val - aux_mean * lr_t / (aux_square + eps).sqrt();
+}
+
+}
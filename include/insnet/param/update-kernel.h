@@ -0,0 +1,30 @@
+#ifndef INSNET_UPDATE_KERNEL_H
+#define INSNET_UPDATE_KERNEL_H
+
+#include "insnet/base/def.h"
+#include "insnet/base/eigen-def.h"
+
+namespace insnet {
+
+/// \brief The CPU optimizer updates of a block of elements, shared by Param and FlatParams so that a fused update is bitwise equal to the updates run param by param.
+///
+/// The updates run block by block, so that the Eigen expressions of a block are evaluated in the L1 cache. It is a multiple of any packet size, so each element is vectorized or not just as it would be in an update of the whole param.
+constexpr int UPDATE_BLOCK_SIZE = 1024;
+
+dtype adamLearningRate(dtype belta1, dtype belta2, dtype alpha, int iter);
+
+/// Multiply *grad* by *grad_scale* unless it is 1, add the L2 penalty unless *is_bias* and update *val* and *aux_square* by adagrad.
+void adagradUpdate(Vec val, Vec grad, Vec aux_square, bool is_bias, dtype grad_scale,
+        dtype alpha, dtype reg, dtype eps);
+
+/// Multiply *grad* by *grad_scale* unless it is 1, add the L2 penalty unless *is_bias* and update *val* and the moments by adam with the bias-corrected learning rate *lr_t*.
+void adamUpdate(Vec val, Vec grad, Vec aux_mean, Vec aux_square, bool is_bias,
+        dtype grad_scale, dtype belta1, dtype belta2, dtype lr_t, dtype reg, dtype eps);
+
+/// Multiply *grad* by *grad_scale* unless it is 1 and update *val* and the moments by adamW, decaying *val* unless *is_bias*.
+void adamWUpdate(Vec val, Vec grad, Vec aux_mean, Vec aux_square, bool is_bias,
+        dtype grad_scale, dtype belta1, dtype belta2, dtype lr_t, dtype reg, dtype eps);
+
+}
+
+#endif
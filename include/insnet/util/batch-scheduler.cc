@@ -0,0 +1,126 @@
+#include "insnet/util/batch-scheduler.h"
+
+#include <algorithm>
+#include <map>
+#include "fmt/core.h"
+
+using std::vector;
+using std::string;
+using std::map;
+using std::cerr;
+using std::endl;
+using std::max_element;
+
+namespace insnet {
+
+BatchScheduler::BatchScheduler(const vector<int> &lengths, int max_tokens, int bucket_width) :
+    lengths_(lengths), max_tokens_(max_tokens) {
+    if (max_tokens <= 0 || bucket_width <= 0) {
+        cerr << fmt::format("BatchScheduler - max_tokens:{} bucket_width:{}\n", max_tokens,
+                bucket_width);
+        abort();
+    }
+    vector<int> bucket_ids;
+    bucket_ids.reserve(lengths.size());
+    for (int len : lengths) {
+        if (len <= 0) {
+            cerr << fmt::format("BatchScheduler - len:{}\n", len);
+            abort();
+        }
+        bucket_ids.push_back(len / bucket_width);
+    }
+    addToBuckets(bucket_ids);
+}
+
+BatchScheduler::BatchScheduler(const vector<int> &lengths, const vector<string> &shape_keys,
+        int max_tokens) : lengths_(lengths), max_tokens_(max_tokens) {
+    if (lengths.size() != shape_keys.size() || max_tokens <= 0) {
+        cerr << fmt::format("BatchScheduler - lengths size:{} shape_keys size:{} max_tokens:{}\n",
+                lengths.size(), shape_keys.size(), max_tokens);
+        abort();
+    }
+    map<string, int> key_ids;
+    for (const string &key : shape_keys) {
+        key_ids.insert(make_pair(key, 0));
+    }
+    int id = 0;
+    for (auto &it : key_ids) {
+        it.second = id++;
+    }
+    vector<int> bucket_ids;
+    bucket_ids.reserve(shape_keys.size());
+    for (const string &key : shape_keys) {
+        bucket_ids.push_back(key_ids.at(key));
+    }
+    addToBuckets(bucket_ids);
+}
+
+void BatchScheduler::addToBuckets(const vector<int> &bucket_ids) {
+    map<int, vector<int>> buckets;
+    for (int i = 0; i < bucket_ids.size(); ++i) {
+        buckets[bucket_ids.at(i)].push_back(i);
+    }
+    buckets_.reserve(buckets.size());
+    for (auto &it : buckets) {
+        buckets_.push_back(move(it.second));
+    }
+}
+
+vector<vector<int>> BatchScheduler::schedule() const {
+    vector<vector<int>> batches;
+    vector<int> remainders;
+    for (const vector<int> &bucket : buckets_) {
+        vector<int> shuffled = bucket;
+        random_shuffle(shuffled.begin(), shuffled.end());
+        vector<int> batch;
+        int tokens = 0;
+        for (int i : shuffled) {
+            int len = lengths_.at(i);
+            if (!batch.empty() && tokens + len > max_tokens_) {
+                batches.push_back(move(batch));
+                batch.clear();
+                tokens = 0;
+            }
+            batch.push_back(i);
+            tokens += len;
+        }
+
+        // The last mini-batch of a bucket is left to be packed with those of the following
+        // buckets, unless it is full enough.
+        if (2 * tokens > max_tokens_) {
+            batches.push_back(move(batch));
+        } else {
+            remainders.insert(remainders.end(), batch.begin(), batch.end());
+        }
+    }
+
+    vector<int> batch;
+    int tokens = 0;
+    for (int i : remainders) {
+        int len = lengths_.at(i);
+        if (!batch.empty() && tokens + len > max_tokens_) {
+            batches.push_back(move(batch));
+            batch.clear();
+            tokens = 0;
+        }
+        batch.push_back(i);
+        tokens += len;
+    }
+    if (!batch.empty()) {
+        batches.push_back(move(batch));
+    }
+
+    random_shuffle(batches.begin(), batches.end());
+    return batches;
+}
+
+void BatchScheduler::recordBatching(const Graph &graph) {
+    executor_count_ += graph.getExecutorCount();
+    node_count_ += graph.getExecutedNodeCount();
+}
+
+float BatchScheduler::averageExecutorBatchSize() const {
+    return executor_count_ == 0 ? 0 : static_cast<float>(node_count_) / executor_count_;
+}
+
+}
@@ -0,0 +1,72 @@
+#ifndef INSNET_BATCH_SCHEDULER_H
+#define INSNET_BATCH_SCHEDULER_H
+
+#include <string>
+#include <vector>
+#include "insnet/computation-graph/graph.h"
+
+namespace insnet {
+
+/// \brief The mini-batch scheduler which groups training instances sharing graph shapes.
+///
+/// InsNet executes the nodes of the same type signature in batch, and the signatures of operators such as tranMatrixMulMatrix and softmax depend on sentence lengths, so random mini-batches often result in many executors of only one node. The scheduler groups instances into buckets by their lengths, or by user-supplied graph-shape keys, and fills each mini-batch from the same bucket until the token budget is used up. The remainders of the buckets are then packed together in the bucket order.
+///
+/// For example, the following codes form mini-batches of at most 4096 tokens for an epoch and report the achieved batching:
+///
+/// \code{.cpp}
+/// BatchScheduler scheduler(lengths, 4096);
+/// for (const std::vector<int> &minibatch : scheduler.schedule()) {
+///     Graph graph;
+///     // Build the graph with instances.at(i) for i in minibatch.
+///     graph.forward();
+///     scheduler.recordBatching(graph);
+///     ...
+/// }
+/// std::cout << scheduler.averageExecutorBatchSize() << std::endl;
+/// \endcode
+class BatchScheduler {
+public:
+    /// \param lengths The lengths, e.g., token counts, of all the instances.
+    /// \param max_tokens The token budget of a mini-batch, i.e., the maximum sum of lengths. A mini-batch will contain at least one instance even if its length exceeds the budget.
+    /// \param bucket_width The instances whose lengths divided by *bucket_width* are equal are in the same bucket. *The default value is 1, i.e., the instances of the same length are in the same bucket.*
+    BatchScheduler(const std::vector<int> &lengths, int max_tokens, int bucket_width = 1);
+
+    /// \param lengths The lengths, e.g., token counts, of all the instances.
+    /// \param shape_keys The graph-shape keys of all the instances, e.g., the concatenation of source and target lengths. The instances of the same key are in the same bucket, and the buckets are ordered by their keys.
+    /// \param max_tokens The token budget of a mini-batch.
+    BatchScheduler(const std::vector<int> &lengths, const std::vector<std::string> &shape_keys,
+            int max_tokens);
+
+    /// Returns the mini-batches of instance indices for an epoch.
+    ///
+    /// The instances are shuffled within their buckets and the mini-batches are shuffled, using std::random_shuffle.
+    std::vector<std::vector<int>> schedule() const;
+
+    int bucketCount() const {
+        return buckets_.size();
+    }
+
+    /// Accumulate the numbers of executors and executed nodes of a graph after forward.
+    void recordBatching(const Graph &graph);
+
+    /// Returns the average number of nodes executed by an executor in the recorded graphs.
+    float averageExecutorBatchSize() const;
+
+    void resetBatching() {
+        executor_count_ = 0;
+        node_count_ = 0;
+    }
+
+private:
+    void addToBuckets(const std::vector<int> &bucket_ids);
+
+    std::vector<int> lengths_;
+    std::vector<std::vector<int>> buckets_;
+    int max_tokens_;
+    int64_t executor_count_ = 0;
+    int64_t node_count_ = 0;
+};
+
+}
+
+#endif
@@ -2,11 +2,17 @@
 #define INSNET_CHECK_GRAD_H
 
 #include "insnet/param/base-param.h"
+#include "insnet/param/sparse-param.h"
+#include <algorithm>
+#include <cmath>
 
 namespace insnet {
 
 constexpr float CHECK_GRAD_STEP = 1e-4;
 
+/// The relative tolerance between the computed grads and the finite differences.
+constexpr float CHECK_GRAD_TOLERANCE = 1e-2;
+
 class CheckGrad {
 public:
     std::vector<BaseParam*> _params;
@@ -32,17 +38,30 @@ public:
         }
     };
 
+    /// Returns the computed grad of the element, which is 0 for the columns of a SparseParam not touched by the last backward, for its grads are row-sparse.
+    static dtype computedGrad(BaseParam &param, int idx, int idy) {
+        if (param.isSparse()) {
+            SparseParam &sparse = dynamic_cast<SparseParam &>(param);
+            const std::vector<int> &ids = sparse.touchedIds();
+            return std::find(ids.begin(), ids.end(), idx) == ids.end() ? 0 :
+                sparse.gradColumn(idx)[idy];
+        }
+        return param.grad()[idx][idy];
+    }
+
+    /// \return Whether every computed grad is equal to the finite difference within CHECK_GRAD_TOLERANCE.
     template<typename Sample>
-    void check(const std::function<dtype(const Sample &sample)> &loss,
+    bool check(const std::function<dtype(const Sample &sample)> &loss,
             const std::vector<Sample> &samples,
             const std::string &description) {
         Classifier<Sample> classifier(loss);
-        check(&classifier, samples, description);
+        return check(&classifier, samples, description);
     }
 
     template<typename Example, typename Classifier>
-    void check(Classifier* classifier, const std::vector<Example>& examples,
+    bool check(Classifier* classifier, const std::vector<Example>& examples,
             const std::string& description) {
+        bool passed = true;
         dtype orginValue, plused_loss, minused_loss;
         int idx, idy;
         dtype mockGrad, computeGrad;
@@ -67,12 +86,17 @@ public:
             printf("plused_loss:%.10f, minused_loss:%.10f\n", plused_loss, minused_loss);
 
             mockGrad = (plused_loss - minused_loss) * 0.5 / CHECK_GRAD_STEP;
-            computeGrad = _params[i]->grad()[idx][idy];
+            computeGrad = computedGrad(*_params[i], idx, idy);
 
             printf("    mock grad = %.20f,\ncomputed grad = %.20f\n\n", mockGrad, computeGrad);
+            if (std::fabs(mockGrad - computeGrad) > CHECK_GRAD_TOLERANCE *
+                    std::max<dtype>(1, std::fabs(mockGrad))) {
+                passed = false;
+            }
 
             _params[i]->val()[idx][idy] = orginValue;
         }
+        return passed;
     }
 };
 
@@ -0,0 +1,57 @@
+#include "insnet/util/mapped-file.h"
+
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "fmt/core.h"
+
+using std::string;
+using std::cerr;
+
+namespace insnet {
+
+MappedFile::MappedFile(const string &path) : path_(path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        cerr << fmt::format("MappedFile - failed to open {}\n", path);
+        abort();
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        cerr << fmt::format("MappedFile - {} is empty or not a regular file\n", path);
+        abort();
+    }
+    len_ = st.st_size;
+    addr_ = mmap(nullptr, len_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr_ == MAP_FAILED) {
+        cerr << fmt::format("MappedFile - failed to mmap {}\n", path);
+        abort();
+    }
+}
+
+MappedFile::~MappedFile() {
+    munmap(addr_, len_);
+}
+
+bool sectionFits(int64_t offset, int64_t length, int64_t file_size, int64_t header_size,
+        int64_t alignment) {
+    return offset >= header_size && offset % alignment == 0 && offset <= file_size &&
+        length >= 0 && length <= file_size - offset;
+}
+
+bool areOffsetsValid(const int64_t *offsets, int64_t count, int64_t arena_size) {
+    if (offsets[0] != 0) {
+        return false;
+    }
+    for (int64_t i = 0; i < count; ++i) {
+        if (offsets[i + 1] < offsets[i]) {
+            return false;
+        }
+    }
+    return offsets[count] <= arena_size;
+}
+
+}
@@ -0,0 +1,48 @@
+#ifndef INSNET_MAPPED_FILE_H
+#define INSNET_MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace insnet {
+
+/// \brief The read-only memory mapping of a whole file, which is unmapped when destroyed.
+class MappedFile {
+public:
+    MappedFile(const std::string &path);
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile();
+
+    const char *data() const {
+        return static_cast<const char *>(addr_);
+    }
+
+    size_t size() const {
+        return len_;
+    }
+
+    const std::string &path() const {
+        return path_;
+    }
+
+private:
+    std::string path_;
+    void *addr_ = nullptr;
+    size_t len_ = 0;
+};
+
+/// Returns whether the section [offset, offset + length) of a mapped file of *file_size* bytes lies after its header of *header_size* bytes and begins at a multiple of *alignment*.
+bool sectionFits(int64_t offset, int64_t length, int64_t file_size, int64_t header_size,
+        int64_t alignment);
+
+/// Returns whether the *count* + 1 offsets delimit *count* strings in an arena of *arena_size* bytes, i.e., they begin with 0, never decrease and end within the arena.
+bool areOffsetsValid(const int64_t *offsets, int64_t count, int64_t arena_size);
+
+}
+
+#endif
@@ -0,0 +1,197 @@
+#include "insnet/util/perf-counters.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <unistd.h>
+#include "fmt/core.h"
+#include "insnet/util/profiler.h"
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+using std::string;
+using std::vector;
+using std::cerr;
+
+namespace insnet {
+
+const string &perfCounterName(PerfCounter counter) {
+    static const string names[PERF_COUNTER_COUNT] = {"cycles", "instructions", "cache misses",
+        "branch misses"};
+    return names[counter];
+}
+
+std::unique_ptr<PerfCounters> &PerfCounters::ptr() {
+    static thread_local std::unique_ptr<PerfCounters> p;
+    return p;
+}
+
+PerfCounters &PerfCounters::Ins() {
+    std::unique_ptr<PerfCounters> &p = ptr();
+    if (p == nullptr) {
+        p.reset(new PerfCounters);
+    }
+    return *p;
+}
+
+PerfCounters::~PerfCounters() {
+    for (int fd : fds_) {
+        close(fd);
+    }
+}
+
+bool PerfCounters::setEnabled(bool enabled) {
+    if (enabled && !opened_) {
+        opened_ = true;
+        string reason = open();
+        if (!reason.empty()) {
+            static std::atomic<bool> printed(false);
+            if (!printed.exchange(true)) {
+                cerr << fmt::format("PerfCounters - hardware counters are unavailable: {}\n",
+                        reason);
+            }
+        }
+    }
+    enabled_ = enabled && leader_fd_ >= 0;
+    if (!enabled_) {
+        running_events_.clear();
+    }
+    return enabled_;
+}
+
+string PerfCounters::open() {
+#ifdef __linux__
+    static const uint64_t configs[PERF_COUNTER_COUNT] = {PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+    string reason;
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[i];
+        attr.disabled = leader_fd_ < 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        int fd = syscall(__NR_perf_event_open, &attr, 0, -1, leader_fd_, 0);
+        if (fd < 0) {
+            if (reason.empty()) {
+                reason = fmt::format("perf_event_open {} - {}",
+                        perfCounterName(static_cast<PerfCounter>(i)), strerror(errno));
+            }
+            continue;
+        }
+        if (leader_fd_ < 0) {
+            leader_fd_ = fd;
+        }
+        indexes_[i] = fds_.size();
+        fds_.push_back(fd);
+    }
+    if (leader_fd_ < 0) {
+        return reason;
+    }
+    ioctl(leader_fd_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader_fd_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return "";
+#else
+    return "perf_event_open is only supported on Linux";
+#endif
+}
+
+void PerfCounters::read(int64_t *values) {
+    // The group is read as the number of the counters followed by their values.
+    uint64_t buffer[PERF_COUNTER_COUNT + 1];
+    ssize_t size = ::read(leader_fd_, buffer, sizeof(buffer));
+    if (size < static_cast<ssize_t>((fds_.size() + 1) * sizeof(uint64_t))) {
+        cerr << fmt::format("PerfCounters read - size:{} counter count:{}\n", size,
+                fds_.size());
+        abort();
+    }
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        values[i] = indexes_[i] < 0 ? 0 : buffer[indexes_[i] + 1];
+    }
+}
+
+void PerfCounters::begin(const string &name) {
+    if (!enabled_) return;
+    auto it = cached_ids_.find(name);
+    if (it == cached_ids_.end()) {
+        it = cached_ids_.insert(std::make_pair(name, Profiler::eventId(name))).first;
+    }
+    beginEvent(it->second);
+}
+
+void PerfCounters::beginEvent(int id) {
+    running_events_.emplace_back();
+    Running &running = running_events_.back();
+    running.id = id;
+    read(running.values);
+}
+
+void PerfCounters::endEvent() {
+    int64_t values[PERF_COUNTER_COUNT];
+    read(values);
+    if (running_events_.empty()) {
+        cerr << "PerfCounters endEvent - running_events_ empty\n";
+        abort();
+    }
+    const Running &top = running_events_.back();
+    if (top.id >= stats_.size()) {
+        stats_.resize(top.id + 1);
+    }
+    PerfStats &stats = stats_.at(top.id);
+    ++stats.count;
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        stats.values[i] += values[i] - top.values[i];
+    }
+    running_events_.pop_back();
+}
+
+string PerfCounters::report() const {
+    vector<int> ids;
+    for (int i = 0; i < stats_.size(); ++i) {
+        if (stats_.at(i).count > 0) {
+            ids.push_back(i);
+        }
+    }
+    std::stable_sort(ids.begin(), ids.end(), [this](int a, int b) {
+        return stats_.at(a).values[CYCLES_COUNTER] > stats_.at(b).values[CYCLES_COUNTER];
+    });
+
+    auto value = [this](const PerfStats &stats, PerfCounter counter) {
+        return isSupported(counter) ? std::to_string(stats.values[counter]) : string("n/a");
+    };
+    auto perThousandInstructions = [this](const PerfStats &stats, PerfCounter counter) {
+        int64_t instructions = stats.values[INSTRUCTIONS_COUNTER];
+        if (!isSupported(counter) || !isSupported(INSTRUCTIONS_COUNTER) || instructions == 0) {
+            return string("n/a");
+        }
+        return fmt::format("{:.2f}", 1000.0 * stats.values[counter] / instructions);
+    };
+    string report;
+    for (int id : ids) {
+        const PerfStats &stats = stats_.at(id);
+        report += fmt::format("name:{} count:{} cycles:{} instructions:{} IPC:{:.2f} "
+                "cache misses:{} ({} per 1k instructions) branch misses:{} "
+                "({} per 1k instructions)\n", Profiler::eventName(id), stats.count,
+                value(stats, CYCLES_COUNTER), value(stats, INSTRUCTIONS_COUNTER),
+                stats.instructionsPerCycle(), value(stats, CACHE_MISSES_COUNTER),
+                perThousandInstructions(stats, CACHE_MISSES_COUNTER),
+                value(stats, BRANCH_MISSES_COUNTER),
+                perThousandInstructions(stats, BRANCH_MISSES_COUNTER));
+    }
+    return report;
+}
+
+void PerfCounters::reset() {
+    running_events_.clear();
+    stats_.clear();
+}
+
+}
@@ -0,0 +1,131 @@
+#ifndef INSNET_PERF_COUNTERS_H
+#define INSNET_PERF_COUNTERS_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace insnet {
+
+enum PerfCounter {
+    CYCLES_COUNTER,
+    INSTRUCTIONS_COUNTER,
+    CACHE_MISSES_COUNTER,
+    BRANCH_MISSES_COUNTER,
+    PERF_COUNTER_COUNT
+};
+
+const std::string &perfCounterName(PerfCounter counter);
+
+/// \brief The hardware counter values of an event summed up over its occurrences.
+struct PerfStats {
+    int64_t count = 0;
+    int64_t values[PERF_COUNTER_COUNT] = {};
+
+    float instructionsPerCycle() const {
+        return values[CYCLES_COUNTER] == 0 ? 0 :
+            static_cast<float>(values[INSTRUCTIONS_COUNTER]) / values[CYCLES_COUNTER];
+    }
+};
+
+/// \brief The hardware performance counters of a thread, i.e., cycles, instructions, cache misses and branch misses, sampled by Linux perf_event_open.
+///
+/// Once enabled, the executors sample the counters around their forward and backward passes, which are aggregated by the profiler's event names, e.g., "linear-forward" and "linear-backward", so that the counters explain the times in Profiler::Print or the Chrome trace. Only the user space of the current thread is counted, so on GPU the counters only cover launching the kernels.
+///
+/// The counters are unavailable on other systems than Linux, in virtual machines without a PMU, or when perf_event_paranoid forbids them, in which case setEnabled(true) prints the reason once and returns false, leaving the counters disabled without affecting training. A counter the CPU does not support is reported as n/a while the others are still sampled.
+///
+/// For example:
+/// \code{.cpp}
+/// PerfCounters &counters = PerfCounters::Ins();
+/// counters.setEnabled(true);
+/// // forward and backward ...
+/// std::cout << counters.report();
+/// \endcode
+class PerfCounters {
+public:
+    /// Returns the counters of the current thread, which are disabled by default.
+    static PerfCounters &Ins();
+
+    PerfCounters(const PerfCounters &) = delete;
+
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    ~PerfCounters();
+
+    /// Enable or disable sampling, opening the counters on the first enabling.
+    /// \return Whether the counters are enabled.
+    bool setEnabled(bool enabled);
+
+    bool isEnabled() const {
+        return enabled_;
+    }
+
+    /// Returns whether *counter* is sampled, which is known once the counters are enabled.
+    bool isSupported(PerfCounter counter) const {
+        return indexes_[counter] >= 0;
+    }
+
+    /// Begin sampling the event *name*, whose ID is shared with the profiler and cached.
+    void begin(const std::string &name);
+
+    void begin(int id) {
+        if (enabled_) {
+            beginEvent(id);
+        }
+    }
+
+    void end() {
+        if (enabled_) {
+            endEvent();
+        }
+    }
+
+    /// Returns the summed up counters of the events sampled by the current thread, indexed by the event IDs, whose counts are 0 if never sampled.
+    const std::vector<PerfStats> &stats() const {
+        return stats_;
+    }
+
+    /// Returns the counters of the events in the descending order of cycles, with the instructions per cycle and the misses per thousand instructions.
+    std::string report() const;
+
+    /// Discard the sampled counters.
+    void reset();
+
+private:
+    struct Running {
+        int id;
+        int64_t values[PERF_COUNTER_COUNT];
+    };
+
+    PerfCounters() = default;
+
+    /// Open the counters as a group led by the first opened one, returning the reason if none is available.
+    std::string open();
+
+    /// Read the current values of the counters into *values*.
+    void read(int64_t *values);
+
+    void beginEvent(int id);
+
+    void endEvent();
+
+    bool enabled_ = false;
+    bool opened_ = false;
+    int leader_fd_ = -1;
+    std::vector<int> fds_;
+
+    /// The index of each counter in the group, or -1 if it is not supported.
+    int indexes_[PERF_COUNTER_COUNT] = {-1, -1, -1, -1};
+
+    std::vector<Running> running_events_;
+    std::vector<PerfStats> stats_;
+    std::unordered_map<std::string, int> cached_ids_;
+
+    static std::unique_ptr<PerfCounters> &ptr();
+};
+
+}
+
+#endif
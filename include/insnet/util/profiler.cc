@@ -1,63 +1,157 @@
 #include <utility>
+#include <chrono>
+#include <deque>
+#include <fstream>
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <unistd.h>
 #include "fmt/core.h"
 #include "profiler.h"
 #if USE_GPU
 #include <cuda_runtime.h>
 #endif
 
+using std::string;
+using std::vector;
+using std::shared_ptr;
+using std::mutex;
+using std::lock_guard;
+
 namespace insnet {
 
+namespace {
+
+struct EventNames {
+    mutex names_mutex;
+    std::unordered_map<string, int> ids;
+    std::deque<string> names;
+};
+
+EventNames &eventNames() {
+    static EventNames *names = new EventNames;
+    return *names;
+}
+
+int64_t nowInNanoseconds() {
+    static const auto epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - epoch).count();
+}
+
+string escapeJson(const string &str) {
+    string result;
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            result += fmt::format("\\u{:04x}", static_cast<int>(c));
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+}
+
+std::unique_ptr<Profiler> &Profiler::ptr() {
+    static thread_local std::unique_ptr<Profiler> p;
+    return p;
+}
+
+vector<shared_ptr<Profiler::Timeline>> &Profiler::timelines() {
+    static auto *timelines = new vector<shared_ptr<Timeline>>;
+    return *timelines;
+}
+
+mutex &Profiler::timelinesMutex() {
+    static mutex *m = new mutex;
+    return *m;
+}
+
+Profiler::Profiler() : timeline_(std::make_shared<Timeline>()) {
+    lock_guard<mutex> guard(timelinesMutex());
+    timeline_->thread_index = timelines().size();
+    timelines().push_back(timeline_);
+}
+
 Profiler &Profiler::Ins() {
-    Profiler *&p = ProfilerPtr();
+    std::unique_ptr<Profiler> &p = ptr();
     if (p == nullptr) {
-        p = new Profiler;
+        p.reset(new Profiler);
     }
     return *p;
 }
 
 void Profiler::Reset() {
-    Profiler *&p = ProfilerPtr();
-    if (p != nullptr) {
-        delete p;
-        p = nullptr;
+    Profiler &profiler = Ins();
+    profiler.timeline_->records.clear();
+    profiler.timeline_->dropped_count = 0;
+    profiler.running_events_.clear();
+    profiler.totals_.clear();
+    profiler.root_id_ = -1;
+    profiler.enabled_ = false;
+}
+
+int Profiler::eventId(const string &name) {
+    EventNames &names = eventNames();
+    lock_guard<mutex> guard(names.names_mutex);
+    auto it = names.ids.find(name);
+    if (it != names.ids.end()) {
+        return it->second;
     }
-    Ins();
+    int id = names.names.size();
+    names.names.push_back(name);
+    names.ids.insert(std::make_pair(name, id));
+    return id;
 }
 
-void Profiler::BeginEvent(const std::string &name) {
-    if (!enabled_) return;
-    Elapsed elapsed;
-    elapsed.name = name;
-    running_events_.push(elapsed);
-    running_events_.top().begin = std::chrono::high_resolution_clock::now();
+const string &Profiler::eventName(int id) {
+    EventNames &names = eventNames();
+    lock_guard<mutex> guard(names.names_mutex);
+    return names.names.at(id);
 }
 
-void Profiler::EndEvent() {
+void Profiler::BeginEvent(const string &name) {
     if (!enabled_) return;
+    auto it = cached_ids_.find(name);
+    if (it == cached_ids_.end()) {
+        it = cached_ids_.insert(std::make_pair(name, eventId(name))).first;
+    }
+    beginEvent(it->second);
+}
+
+void Profiler::beginEvent(int id) {
+    running_events_.push_back({id, nowInNanoseconds()});
+}
+
+void Profiler::endEvent() {
+    int64_t end = nowInNanoseconds();
     if (running_events_.empty()) {
         std::cout << "running_events_ empty" << std::endl;
         abort();
     }
-    Elapsed &top = running_events_.top();
-    top.end = std::chrono::high_resolution_clock::now();
-    float time = std::chrono::duration_cast<std::chrono::nanoseconds>(
-            top.end - top.begin).count();
-    auto it = event_map_.find(top.name);
-    if (it == event_map_.end()) {
-        Event event(top.name, 1, time);
-        event_map_.insert(std::make_pair(event.name, event));
+    const Running &top = running_events_.back();
+    if (top.id >= totals_.size()) {
+        totals_.resize(top.id + 1);
+    }
+    Total &total = totals_.at(top.id);
+    ++total.count;
+    total.time += end - top.begin;
+
+    int depth = running_events_.size() - 1;
+    Timeline &timeline = *timeline_;
+    if (timeline.records.size() < timeline.capacity) {
+        timeline.records.push_back({top.id, depth, top.begin, end});
     } else {
-        Event &event = it->second;
-        event.count++;
-        event.total_time_in_nanoseconds += time;
+        ++timeline.dropped_count;
     }
-    if (running_events_.size() == 1) {
-        root_ = &event_map_.at(top.name);
+    if (depth == 0) {
+        root_id_ = top.id;
     }
-    running_events_.pop();
+    running_events_.pop_back();
 }
 
 void Profiler::EndCudaEvent() {
@@ -65,22 +159,28 @@ void Profiler::EndCudaEvent() {
 #if USE_GPU
     cudaDeviceSynchronize();
 #endif
-    EndEvent();
+    endEvent();
+}
+
+void Profiler::setTimelineCapacity(int64_t capacity) {
+    if (capacity < 0) {
+        std::cerr << fmt::format("Profiler setTimelineCapacity - capacity:{}\n", capacity);
+        abort();
+    }
+    timeline_->capacity = capacity;
 }
 
 void Profiler::Print() {
     while (!running_events_.empty()) {
-        std::cout << running_events_.top().name << std::endl;
-        running_events_.pop();
+        std::cout << eventName(running_events_.back().id) << std::endl;
+        running_events_.pop_back();
     }
-    if (!running_events_.empty()) {
-        std::cerr << "events empty" << std::endl;
-        abort();
-    }
-    std::vector<Event> events;
-    for (auto &it : event_map_) {
-        Event &event = it.second;
-        events.push_back(event);
+    vector<Event> events;
+    for (int i = 0; i < totals_.size(); ++i) {
+        const Total &total = totals_.at(i);
+        if (total.count > 0) {
+            events.push_back(Event(eventName(i), total.count, total.time));
+        }
     }
 
     std::sort(events.begin(), events.end(), [](const Event &a,
@@ -88,12 +188,56 @@ void Profiler::Print() {
             b.total_time_in_nanoseconds;});
     std::cout << "events count" << events.size() << std::endl;
 
+    float root_time = root_id_ >= 0 ? totals_.at(root_id_).time : 0;
     for (Event &event : events) {
         std::cout << "name:" << event.name << " count:" << event.count <<
             " total time:" << event.total_time_in_nanoseconds / 1000000000.0
             << " avg:" << event.total_time_in_nanoseconds / event.count /
-            1000000 << " ratio:" << event.total_time_in_nanoseconds /
-            root_->total_time_in_nanoseconds << std::endl;
+            1000000 << " ratio:" << event.total_time_in_nanoseconds / root_time << std::endl;
+    }
+    if (timeline_->dropped_count > 0) {
+        std::cout << fmt::format("{} events dropped from the timeline\n",
+                timeline_->dropped_count);
+    }
+}
+
+void Profiler::exportChromeTrace(const string &path) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << fmt::format("Profiler exportChromeTrace - failed to open {}\n", path);
+        abort();
+    }
+    vector<shared_ptr<Timeline>> snapshot;
+    {
+        lock_guard<mutex> guard(timelinesMutex());
+        snapshot = timelines();
+    }
+
+    int pid = getpid();
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    for (const shared_ptr<Timeline> &timeline : snapshot) {
+        if (timeline->records.empty()) {
+            continue;
+        }
+        out << (first ? "\n" : ",\n");
+        first = false;
+        out << fmt::format(
+                "{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":{},\"tid\":{},"
+                "\"args\":{{\"name\":\"thread {}\"}}}}", pid, timeline->thread_index,
+                timeline->thread_index);
+        for (const Record &record : timeline->records) {
+            out << fmt::format(
+                    ",\n{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":{},\"tid\":{},\"ts\":{:.3f},"
+                    "\"dur\":{:.3f},\"args\":{{\"depth\":{}}}}}",
+                    escapeJson(eventName(record.id)), pid, timeline->thread_index,
+                    record.begin / 1000.0, (record.end - record.begin) / 1000.0, record.depth);
+        }
+    }
+    out << "\n]}\n";
+    if (!out) {
+        std::cerr << fmt::format("Profiler exportChromeTrace - failed to write {}\n", path);
+        abort();
     }
 }
 
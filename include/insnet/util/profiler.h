@@ -1,10 +1,12 @@
 #ifndef INSNET_PROFILER_H
 #define INSNET_PROFILER_H
 
+#include <cstdint>
 #include <string>
-#include <map>
-#include <chrono>
-#include <stack>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 namespace insnet {
 
@@ -23,35 +25,56 @@ struct Event {
     Event(const Event &event) = default;
 };
 
-struct Elapsed {
-    typedef std::chrono::time_point<std::chrono::high_resolution_clock> Timestamp;
-    Timestamp begin;
-    Timestamp end;
-    std::string name;
-};
-
 enum ProfilerMode {
     ANALYSIS = 0,
     METRIC = 1
 };
 
-class Profiler;
-
-static Profiler*& ProfilerPtr() {
-    static Profiler* p;
-    return p;
-}
-
+/// \brief The profiler recording the nested events of a thread.
+///
+/// Event names are interned to integer IDs shared by all the threads, so frequent events should keep their IDs, e.g., in function-local static variables, and begin with BeginEvent(int), which neither allocates nor looks up names. When the profiler is disabled, BeginEvent and EndEvent return at once, so callers building event names should check isEnabled() first.
+///
+/// Each thread records to its own timeline buffer without locks. Print() shows the flat totals of the current thread, and exportChromeTrace writes the nested timelines of all the threads, which can be opened in chrome://tracing or Perfetto.
+///
+/// For example:
+/// \code{.cpp}
+/// Profiler &profiler = Profiler::Ins();
+/// profiler.SetEnabled(true);
+/// static const int id = Profiler::eventId("train_step");
+/// profiler.BeginEvent(id);
+/// // forward, backward and step ...
+/// profiler.EndEvent();
+/// Profiler::exportChromeTrace("trace.json");
+/// \endcode
 class Profiler {
 public:
+    /// Returns the profiler of the current thread. Each thread has its own profiler, which is disabled by default, so that graphs can run on multiple threads.
     static Profiler &Ins();
 
+    /// Discard the events of the current thread's profiler and disable it.
     static void Reset();
 
+    /// Returns the ID of the event *name*, interning it on the first call.
+    static int eventId(const std::string &name);
+
+    static const std::string &eventName(int id);
+
+    void BeginEvent(int id) {
+        if (enabled_) {
+            beginEvent(id);
+        }
+    }
+
+    /// Begin the event *name*, whose ID is cached by the current thread's profiler.
     void BeginEvent(const std::string &name);
 
-    void EndEvent();
+    void EndEvent() {
+        if (enabled_) {
+            endEvent();
+        }
+    }
 
+    /// End the event after waiting for the device to finish the launched kernels on GPU.
     void EndCudaEvent();
 
     void Print();
@@ -60,12 +83,62 @@ public:
         enabled_ = enabled;
     }
 
+    bool isEnabled() const {
+        return enabled_;
+    }
+
+    /// Set the maximal number of events kept in the current thread's timeline, beyond which the events are only counted in the totals. *The default value is 2^20.*
+    void setTimelineCapacity(int64_t capacity);
+
+    /// Write the timelines of all the threads to *path* in the Chrome trace event format.
+    ///
+    /// It reads the other threads' buffers without locks, so it should be called when no other thread is profiling, e.g., after hogwild returns.
+    static void exportChromeTrace(const std::string &path);
+
 private:
-    Profiler() = default;
-    std::map<std::string, Event> event_map_;
-    std::stack<Elapsed> running_events_;
-    Event *root_ = nullptr;
+    struct Record {
+        int32_t id;
+        int32_t depth;
+        int64_t begin;
+        int64_t end;
+    };
+
+    struct Timeline {
+        int thread_index;
+        std::vector<Record> records;
+        int64_t capacity = 1 << 20;
+        int64_t dropped_count = 0;
+    };
+
+    struct Total {
+        int64_t count = 0;
+        int64_t time = 0;
+    };
+
+    struct Running {
+        int id;
+        int64_t begin;
+    };
+
+    Profiler();
+
+    void beginEvent(int id);
+
+    void endEvent();
+
+    std::shared_ptr<Timeline> timeline_;
+    std::vector<Running> running_events_;
+    std::vector<Total> totals_;
+    std::unordered_map<std::string, int> cached_ids_;
+    int root_id_ = -1;
     bool enabled_ = false;
+
+    static std::unique_ptr<Profiler> &ptr();
+
+    /// Returns the timelines of all the threads that have used their profilers, which are kept after the threads exit.
+    static std::vector<std::shared_ptr<Timeline>> &timelines();
+
+    static std::mutex &timelinesMutex();
 };
 
 }
@@ -0,0 +1,97 @@
+#include "insnet/util/worker-pool.h"
+
+#include <algorithm>
+#include <iostream>
+#include "fmt/core.h"
+
+using std::function;
+using std::mutex;
+using std::unique_lock;
+using std::lock_guard;
+using std::cerr;
+
+namespace insnet {
+
+WorkerPool::WorkerPool(int thread_count) {
+    if (thread_count < 1) {
+        cerr << fmt::format("WorkerPool - thread_count:{}\n", thread_count);
+        abort();
+    }
+    workers_.reserve(thread_count - 1);
+    for (int i = 1; i < thread_count; ++i) {
+        workers_.emplace_back(&WorkerPool::work, this, i);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        lock_guard<mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    task_cv_.notify_all();
+    for (std::thread &worker : workers_) {
+        worker.join();
+    }
+}
+
+void WorkerPool::parallelFor(int count, int thread_count, const function<void(int, int)> &f) {
+    thread_count = std::max(1, std::min(thread_count, threadCount()));
+    int range = (count + thread_count - 1) / thread_count;
+    if (thread_count == 1 || range >= count) {
+        f(0, count);
+        return;
+    }
+
+    {
+        lock_guard<mutex> lock(mutex_);
+        task_ = &f;
+        count_ = count;
+        range_ = range;
+        pending_ = workers_.size();
+        ++generation_;
+    }
+    task_cv_.notify_all();
+    f(0, range);
+
+    unique_lock<mutex> lock(mutex_);
+    done_cv_.wait(lock, [this]() {
+        return pending_ == 0;
+    });
+    task_ = nullptr;
+}
+
+void WorkerPool::work(int index) {
+    int64_t generation = 0;
+    while (true) {
+        const function<void(int, int)> *task;
+        int begin, end;
+        {
+            unique_lock<mutex> lock(mutex_);
+            task_cv_.wait(lock, [this, generation]() {
+                return stopping_ || generation_ != generation;
+            });
+            if (stopping_) {
+                return;
+            }
+            generation = generation_;
+            task = task_;
+            begin = index * range_;
+            end = std::min(begin + range_, count_);
+        }
+
+        if (begin < end) {
+            (*task)(begin, end);
+        }
+
+        bool done;
+        {
+            lock_guard<mutex> lock(mutex_);
+            done = --pending_ == 0;
+        }
+        if (done) {
+            done_cv_.notify_one();
+        }
+    }
+}
+
+}
@@ -0,0 +1,50 @@
+#ifndef INSNET_WORKER_POOL_H
+#define INSNET_WORKER_POOL_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace insnet {
+
+/// \brief The persistent threads that run parallel loops together with the calling thread, so that a loop costs a wake-up instead of creating and joining threads.
+class WorkerPool {
+public:
+    /// Start *thread_count - 1* workers, the calling thread being the remaining one.
+    WorkerPool(int thread_count);
+
+    WorkerPool(const WorkerPool &) = delete;
+
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    ~WorkerPool();
+
+    int threadCount() const {
+        return workers_.size() + 1;
+    }
+
+    /// Call *f* with the contiguous ranges [begin, end) of [0, count) on at most *thread_count* threads including the calling one, and wait for them to finish.
+    ///
+    /// It should not be called concurrently.
+    void parallelFor(int count, int thread_count, const std::function<void(int, int)> &f);
+
+private:
+    void work(int index);
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable task_cv_, done_cv_;
+    const std::function<void(int, int)> *task_ = nullptr;
+    int count_ = 0;
+    int range_ = 0;
+    int pending_ = 0;
+    int64_t generation_ = 0;
+    bool stopping_ = false;
+};
+
+}
+
+#endif
@@ -0,0 +1,155 @@
+#include "test.h"
+#include "insnet/util/check-grad.h"
+
+using std::string;
+using std::vector;
+
+using namespace insnet;
+using namespace insnet::test;
+
+namespace {
+
+const int ROW = 4, COL = 7, HEAD_COUNT = 2, HEAD_DIM = ROW / HEAD_COUNT;
+
+/// The query, key and value matrices, each of which is ROW x COL.
+struct Inputs {
+    Param q, k, v;
+
+    Inputs() : q(string("q")), k(string("k")), v(string("v")) {
+        dtype phase = 0.1;
+        for (Param *p : {&q, &k, &v}) {
+            p->init(ROW * COL, 1);
+            fill(*p, phase);
+            phase += 0.4;
+        }
+    }
+
+    vector<BaseParam *> params() {
+        return {&q, &k, &v};
+    }
+};
+
+/// Returns the heads attended by dotAttention and concatenated, a ROW x COL matrix. It is the banded attention if *band* is not null, and the heads are strided views if *strided_view* is true.
+Node *attend(Graph &graph, Inputs &inputs, const AttentionBand *band, bool use_mask,
+        bool strided_view) {
+    vector<int> offsets;
+    for (int i = 0; i < HEAD_COUNT; ++i) {
+        offsets.push_back(i * HEAD_DIM);
+    }
+    BatchedNode *q = split(*param(graph, inputs.q), HEAD_DIM, offsets, COL, strided_view);
+    BatchedNode *k = split(*param(graph, inputs.k), HEAD_DIM, offsets, COL, strided_view);
+    BatchedNode *v = split(*param(graph, inputs.v), HEAD_DIM, offsets, COL, strided_view);
+    BatchedNode *attended = band == nullptr ?
+        dotAttention(*k, *v, *q, HEAD_DIM, use_mask).first :
+        dotAttention(*k, *v, *q, HEAD_DIM, *band, use_mask).first;
+    return cat(*attended, COL, strided_view);
+}
+
+/// Returns the element of the head at (r, c) of the ROW x COL matrix.
+dtype headElement(Param &p, int head, int r, int c) {
+    return p.val().v[c * ROW + head * HEAD_DIM + r];
+}
+
+/// The full attention whose scores outside *band* are masked explicitly.
+vector<dtype> maskedFullAttention(Inputs &inputs, const AttentionBand &band,
+        bool use_mask) {
+    vector<dtype> result(ROW * COL, 0);
+    for (int h = 0; h < HEAD_COUNT; ++h) {
+        for (int j = 0; j < COL; ++j) {
+            vector<dtype> scores(COL, -INFINITY);
+            int begin = band.begin(j);
+            for (int key = 0; key < COL; ++key) {
+                bool in_band = key >= begin && key < begin + band.width();
+                if (!in_band || (use_mask && key > j)) {
+                    continue;
+                }
+                dtype dot = 0;
+                for (int r = 0; r < HEAD_DIM; ++r) {
+                    dot += headElement(inputs.k, h, r, key) * headElement(inputs.q, h, r, j);
+                }
+                scores.at(key) = dot / std::sqrt(static_cast<dtype>(HEAD_DIM));
+            }
+            dtype max_score = *std::max_element(scores.begin(), scores.end());
+            dtype sum = 0;
+            for (dtype &score : scores) {
+                score = std::exp(score - max_score);
+                sum += score;
+            }
+            for (int key = 0; key < COL; ++key) {
+                for (int r = 0; r < HEAD_DIM; ++r) {
+                    result.at(j * ROW + h * HEAD_DIM + r) +=
+                        scores.at(key) / sum * headElement(inputs.v, h, r, key);
+                }
+            }
+        }
+    }
+    return result;
+}
+
+/// The banded attention is equal to the full attention with the band masked explicitly, and to the unmasked full attention if the band covers all the keys.
+void testForward(const AttentionBand &band, bool use_mask, bool strided_view) {
+    Inputs inputs;
+    Graph graph(ModelStage::INFERENCE);
+    Node *banded = attend(graph, inputs, &band, use_mask, strided_view);
+    AttentionBand all_keys = AttentionBand::slidingWindow(COL);
+    Node *covering = attend(graph, inputs, &all_keys, use_mask, strided_view);
+    Node *full = attend(graph, inputs, nullptr, use_mask, strided_view);
+    graph.forward();
+
+    vector<dtype> expected = maskedFullAttention(inputs, band, use_mask);
+    string name = fmt::format("band:{} mask:{} strided:{}", band.toString(), use_mask,
+            strided_view);
+    for (int i = 0; i < ROW * COL; ++i) {
+        expectNear(expected.at(i), banded->getVal()[i], fmt::format("{} [{}]", name, i));
+        expectNear(full->getVal()[i], covering->getVal()[i],
+                fmt::format("{} covering band [{}]", name, i));
+    }
+}
+
+/// CheckGrad on the query, key and value matrices through the banded attention.
+void testCheckGrad(const AttentionBand &band, bool use_mask) {
+    Inputs inputs;
+    auto loss = [&](const int &) {
+        for (BaseParam *p : inputs.params()) {
+            p->initAndZeroGrad();
+            p->zeroGrad();
+        }
+        Graph graph;
+        Node *attended = attend(graph, inputs, &band, use_mask, true);
+        graph.forward();
+        vector<Node *> outputs = {attended};
+        initAndZeroGrads(outputs);
+        dtype sum = 0;
+        for (int i = 0; i < attended->size(); ++i) {
+            dtype w = std::cos(0.3 * i);
+            sum += w * attended->getVal()[i];
+            attended->grad()[i] += w;
+        }
+        graph.backward();
+        return sum;
+    };
+    loss(0);
+
+    CheckGrad check_grad;
+    check_grad.init(inputs.params());
+    for (int i = 0; i < 8; ++i) {
+        expect(check_grad.check<int>(loss, {0}, "banded attention"),
+                fmt::format("CheckGrad band:{} mask:{}", band.toString(), use_mask));
+    }
+}
+
+}
+
+int main() {
+    for (const AttentionBand &band : {AttentionBand::slidingWindow(1),
+            AttentionBand::blockSparse(2, 1), AttentionBand::blockSparse(3, 0)}) {
+        for (bool use_mask : {false, true}) {
+            for (bool strided_view : {false, true}) {
+                testForward(band, use_mask, strided_view);
+            }
+            testCheckGrad(band, use_mask);
+        }
+    }
+    std::cout << "banded-attention-test passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include "test.h"
+
+using std::string;
+using std::vector;
+
+using namespace insnet;
+using namespace insnet::test;
+
+namespace {
+
+const string PATH = "checkpoint-resume-test.ckpt";
+
+struct Model {
+    Param w;
+    SparseParam table;
+
+    Model() : w(string("w")), table("table") {
+        w.init(5, 7);
+        table.init(3, 10);
+        fill(w, 0.1);
+        fill(table, 0.2);
+        w.initAndZeroGrad();
+    }
+
+    vector<BaseParam *> params() {
+        return {&w, &table};
+    }
+
+    /// Run an adam step with deterministic grads, touching a step-dependent subset of the table.
+    void step(int step) {
+        w.zeroGrad();
+        table.zeroGrad();
+        for (int i = 0; i < w.val().size; ++i) {
+            w.grad().v[i] = std::cos(step + 0.3 * i) * 1e-2;
+        }
+        for (int id : {step % 4, 5, 9 - step % 3}) {
+            dtype *grad = table.gradColumn(id);
+            for (int i = 0; i < table.val().row; ++i) {
+                grad[i] += std::sin(step + id + 0.5 * i) * 1e-2;
+            }
+        }
+        for (BaseParam *param : params()) {
+            param->adam(0.9, 0.999, 1e-2, 1e-4, 1e-8);
+        }
+    }
+};
+
+/// Training resumed from a checkpoint with optimizer states, including the step counters, matches the training without interruption.
+void testResume() {
+    const int total = 6, saved = 3;
+    Model straight;
+    for (int i = 0; i < total; ++i) {
+        straight.step(i);
+    }
+
+    Model resumed;
+    for (int i = 0; i < saved; ++i) {
+        resumed.step(i);
+    }
+    saveCheckpoint(PATH, resumed.params(), true);
+
+    Model loaded;
+    Checkpoint(PATH).load(loaded.params(), true);
+    expect(!loaded.w.isFrozen(), "resumed param not frozen");
+    for (int i = saved; i < total; ++i) {
+        loaded.step(i);
+    }
+
+    for (int i = 0; i < 2; ++i) {
+        const Tensor2D &expected = straight.params().at(i)->val();
+        const Tensor2D &actual = loaded.params().at(i)->val();
+        for (int j = 0; j < expected.size; ++j) {
+            expect(expected.v[j] == actual.v[j],
+                    fmt::format("resumed {} at {}", straight.params().at(i)->getParamName(), j));
+        }
+    }
+
+    // Inference params are loaded without initialization, allocating no tensor.
+    Param w(string("w"));
+    SparseParam table("table");
+    vector<BaseParam *> inference = {&w, &table};
+    MemoryTracker &tracker = MemoryTracker::Ins();
+    tracker.setEnabled(true);
+    tracker.beginStep();
+    Checkpoint(PATH).load(inference);
+    expect(tracker.total().allocated_bytes == 0, "loading allocating no tensor");
+    tracker.setEnabled(false);
+    for (int i = 0; i < 2; ++i) {
+        const Tensor2D &expected = resumed.params().at(i)->val();
+        expect(inference.at(i)->isFrozen(), "param aliasing the checkpoint frozen");
+        expect(inference.at(i)->val().row == expected.row &&
+                inference.at(i)->val().col == expected.col, "shape from the checkpoint");
+        for (int j = 0; j < expected.size; ++j) {
+            expect(expected.v[j] == inference.at(i)->val().v[j], "loaded value");
+        }
+    }
+    std::remove(PATH.c_str());
+}
+
+/// The manifest fields are validated as they are read, so corrupt checkpoints abort instead of being read out of bounds.
+void testCorruptManifest() {
+    Model model;
+    saveCheckpoint(PATH, model.params());
+    expect(!aborts([]() { Checkpoint checkpoint(PATH); }), "valid checkpoint");
+
+    // The header's manifest_offset and manifest_size are at 16 and 24.
+    int64_t manifest_offset;
+    {
+        std::ifstream inf(PATH, std::ios::binary);
+        inf.seekg(16);
+        inf.read(reinterpret_cast<char *>(&manifest_offset), sizeof(manifest_offset));
+    }
+    overwrite(PATH, 24, 9);
+    expect(aborts([]() { Checkpoint checkpoint(PATH); }), "truncated manifest");
+
+    // The first entry is the 32-bit name length, "w", the 32-bit row and column, and the offset.
+    saveCheckpoint(PATH, model.params());
+    overwrite(PATH, manifest_offset, -1);
+    expect(aborts([]() { Checkpoint checkpoint(PATH); }), "negative name length");
+
+    saveCheckpoint(PATH, model.params());
+    overwrite(PATH, manifest_offset + 13, 68);
+    expect(aborts([]() { Checkpoint checkpoint(PATH); }), "misaligned offset");
+
+    saveCheckpoint(PATH, model.params());
+    overwrite(PATH, manifest_offset + 13, -64);
+    expect(aborts([]() { Checkpoint checkpoint(PATH); }), "negative offset");
+
+    saveCheckpoint(PATH, model.params());
+    overwrite(PATH, manifest_offset + 5, (1 << 20) | (int64_t(1 << 10) << 32));
+    expect(aborts([]() { Checkpoint checkpoint(PATH); }), "blob beyond the file");
+    std::remove(PATH.c_str());
+}
+
+}
+
+int main() {
+    testResume();
+    testCorruptManifest();
+    std::cout << "checkpoint-resume-test passed" << std::endl;
+    return 0;
+}
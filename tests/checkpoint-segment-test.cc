@@ -0,0 +1,136 @@
+#include "test.h"
+#include <cstring>
+
+using std::string;
+using std::vector;
+
+using namespace insnet;
+using namespace insnet::test;
+
+namespace {
+
+const int DIM = 6, COL = 5, LAYER_COUNT = 3, SENTENCE_COUNT = 2;
+
+/// A stack of linear layers, each followed by the layer normalization and relu.
+struct Model {
+    vector<LinearParams *> linears;
+    vector<LayerNormParams *> norms;
+
+    Model() {
+        dtype phase = 0.1;
+        for (int i = 0; i < LAYER_COUNT; ++i) {
+            LinearParams *linear = new LinearParams(fmt::format("linear-{}", i));
+            linear->init(DIM, DIM);
+            LayerNormParams *norm = new LayerNormParams(fmt::format("norm-{}", i));
+            norm->init(DIM);
+            linears.push_back(linear);
+            norms.push_back(norm);
+        }
+        for (BaseParam *p : params()) {
+            fill(*p, phase);
+            phase += 0.3;
+        }
+    }
+
+    ~Model() {
+        for (int i = 0; i < LAYER_COUNT; ++i) {
+            delete linears.at(i);
+            delete norms.at(i);
+        }
+    }
+
+    vector<BaseParam *> params() {
+        vector<BaseParam *> results;
+        for (int i = 0; i < LAYER_COUNT; ++i) {
+            for (vector<BaseParam *> ps : {linears.at(i)->tunableParams(),
+                    norms.at(i)->tunableParams()}) {
+                results.insert(results.end(), ps.begin(), ps.end());
+            }
+        }
+        return results;
+    }
+};
+
+struct Result {
+    vector<dtype> outputs;
+    vector<vector<dtype>> grads;
+    int64_t live_bytes;
+    int64_t dropped_activations;
+};
+
+/// Run forward and backward, recording the live bytes after forward.
+Result run(Model &model, bool checkpoint) {
+    for (BaseParam *p : model.params()) {
+        p->initAndZeroGrad();
+        p->zeroGrad();
+    }
+    Result result;
+    MemoryTracker &tracker = MemoryTracker::Ins();
+    int64_t live_bytes = tracker.total().live_bytes;
+    {
+        Graph graph;
+        vector<Node *> outputs;
+        for (int s = 0; s < SENTENCE_COUNT; ++s) {
+            vector<dtype> input(DIM * COL);
+            for (int i = 0; i < input.size(); ++i) {
+                input.at(i) = std::cos(s + 0.4 * i);
+            }
+            Node *h = tensor(graph, input);
+            for (int i = 0; i < LAYER_COUNT; ++i) {
+                if (checkpoint) {
+                    graph.beginCheckpointSegment(fmt::format("layer-{}", i));
+                }
+                h = linear(*h, *model.linears.at(i));
+                h = layerNorm(*h, *model.norms.at(i));
+                h = relu(*h);
+                if (checkpoint) {
+                    graph.endCheckpointSegment();
+                }
+            }
+            outputs.push_back(h);
+        }
+        graph.forward();
+        result.live_bytes = tracker.total().live_bytes - live_bytes;
+        result.dropped_activations = graph.getDroppedActivations();
+
+        initAndZeroGrads(outputs);
+        for (Node *output : outputs) {
+            for (int i = 0; i < output->size(); ++i) {
+                result.outputs.push_back(output->getVal()[i]);
+                output->grad()[i] += std::sin(0.3 * result.outputs.size());
+            }
+        }
+        graph.backward();
+    }
+    for (BaseParam *p : model.params()) {
+        result.grads.push_back(vector<dtype>(p->grad().v, p->grad().v + p->grad().size));
+    }
+    return result;
+}
+
+bool equal(const vector<dtype> &a, const vector<dtype> &b) {
+    return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(dtype)) == 0;
+}
+
+}
+
+int main() {
+    MemoryTracker::Ins().setEnabled(true);
+    Model model;
+    Result kept = run(model, false);
+    Result dropped = run(model, true);
+
+    expect(kept.dropped_activations == 0, "no activations dropped without checkpointing");
+    expect(dropped.dropped_activations > 0, "activations dropped by checkpointing");
+    expect(kept.live_bytes - dropped.live_bytes ==
+            dropped.dropped_activations * static_cast<int64_t>(sizeof(dtype)),
+            fmt::format("the dropped activations are freed - kept:{} dropped:{} reported:{}",
+                kept.live_bytes, dropped.live_bytes, dropped.dropped_activations));
+    expect(equal(kept.outputs, dropped.outputs), "outputs bitwise equal");
+    for (int i = 0; i < kept.grads.size(); ++i) {
+        expect(equal(kept.grads.at(i), dropped.grads.at(i)),
+                fmt::format("grads of {} bitwise equal", model.params().at(i)->getParamName()));
+    }
+    std::cout << "checkpoint-segment-test passed" << std::endl;
+    return 0;
+}
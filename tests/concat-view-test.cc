@@ -0,0 +1,151 @@
+#include "test.h"
+
+using std::string;
+using std::vector;
+
+using namespace insnet;
+using namespace insnet::test;
+
+namespace {
+
+/// The weight of the linear loss at the index of an output.
+dtype weight(int output, int i) {
+    return std::cos(output + 0.3 * i);
+}
+
+/// cat aliases its inputs, one of which is also consumed by two batched operators and, like the concatenation itself, is an output receiving grad directly. The concatenation is in turn aliased by an outer one. Every path should contribute to the grad exactly once.
+void testSharedInputOfAliasingCat(int x_dim, int y_dim) {
+    Param a_param("a"), b_param("b");
+    a_param.init(x_dim, 1);
+    b_param.init(y_dim, 1);
+    fill(a_param, 0.1);
+    fill(b_param, 0.2);
+    a_param.initAndZeroGrad();
+    b_param.initAndZeroGrad();
+
+    Graph graph;
+    Node *a = param(graph, a_param);
+    Node *b = param(graph, b_param);
+    Node *x = mul(*a, 2);
+    Node *y = mul(*b, 3);
+    Node *r = cat({x, y});
+    Node *c1 = mul(*r, 1.5);
+    Node *c2 = mul(*x, 5);
+    Node *c3 = mul(*x, 5);
+    Node *z = mul(*b, 7);
+    Node *outer = cat({r, z});
+#if !TEST_CUDA
+    expect(x->getVal().isPlannedAsView() && y->getVal().isPlannedAsView() &&
+            r->getVal().isPlannedAsView(), "cat inputs planned as views");
+#endif
+
+    graph.forward();
+    for (int i = 0; i < x_dim; ++i) {
+        expectNear(3 * a_param.val().v[i], c1->getVal()[i], fmt::format("c1[{}]", i));
+        expectNear(10 * a_param.val().v[i], c2->getVal()[i], fmt::format("c2[{}]", i));
+        expectNear(10 * a_param.val().v[i], c3->getVal()[i], fmt::format("c3[{}]", i));
+        expectNear(2 * a_param.val().v[i], outer->getVal()[i], fmt::format("outer[{}]", i));
+    }
+    for (int i = 0; i < y_dim; ++i) {
+        expectNear(4.5 * b_param.val().v[i], c1->getVal()[x_dim + i],
+                fmt::format("c1[{}]", x_dim + i));
+    }
+
+    vector<Node *> outputs = {c1, c2, r, x, c3, outer};
+    initAndZeroGrads(outputs);
+    for (int o = 0; o < outputs.size(); ++o) {
+        for (int i = 0; i < outputs.at(o)->size(); ++i) {
+            outputs.at(o)->grad()[i] += weight(o, i);
+        }
+    }
+    graph.backward();
+
+    for (int i = 0; i < x_dim; ++i) {
+        dtype x_grad = 1.5 * weight(0, i) + 5 * weight(1, i) + weight(2, i) + weight(3, i) +
+            5 * weight(4, i) + weight(5, i);
+        expectNear(2 * x_grad, a_param.grad().v[i], fmt::format("a grad[{}]", i));
+    }
+    for (int i = 0; i < y_dim; ++i) {
+        dtype y_grad = 1.5 * weight(0, x_dim + i) + weight(2, x_dim + i) +
+            weight(5, x_dim + i);
+        expectNear(3 * y_grad + 7 * weight(5, x_dim + y_dim + i), b_param.grad().v[i],
+                fmt::format("b grad[{}]", i));
+    }
+}
+
+/// Returns the output vals and the param grads of the products of the heads of x and y concatenated. If *strided_view* is true, the heads and the products are planned as strided views, but they are also consumed by mul, which does not support strides, so the views are cancelled.
+vector<dtype> stridedHeadsWithNonMatmulConsumers(bool strided_view) {
+    Param x_param(string("x")), y_param(string("y"));
+    x_param.init(12, 1);
+    y_param.init(12, 1);
+    fill(x_param, 0.1);
+    fill(y_param, 0.2);
+    x_param.initAndZeroGrad();
+    y_param.initAndZeroGrad();
+
+    Graph graph;
+    Node *x = param(graph, x_param);
+    Node *y = param(graph, y_param);
+    BatchedNode *heads = split(*x, 2, {0, 2}, 3, strided_view);
+    BatchedNode *weights = split(*y, 3, {0, 3}, 2);
+    BatchedNode *products = matrixMulMatrix(*heads, *weights, 3);
+    Node *r = cat(*products, 2, strided_view);
+#if !TEST_CUDA
+    if (strided_view) {
+        for (BatchedNode *node : {heads, products}) {
+            for (Node *atom : node->batch()) {
+                expect(atom->getVal().isPlannedAsStridedView(),
+                        "the views only consumed by matmul are strided");
+            }
+        }
+    }
+#endif
+    BatchedNode *scaled_heads = mul(*heads, 2);
+    BatchedNode *scaled_products = mul(*products, 3);
+    for (BatchedNode *node : {heads, products}) {
+        for (Node *atom : node->batch()) {
+            expect(!atom->getVal().isPlannedAsView(), "the views consumed by mul are cancelled");
+        }
+    }
+
+    graph.forward();
+    vector<Node *> outputs = {r};
+    for (BatchedNode *node : {scaled_heads, scaled_products}) {
+        outputs.insert(outputs.end(), node->batch().begin(), node->batch().end());
+    }
+    vector<dtype> results;
+    for (Node *output : outputs) {
+        results.insert(results.end(), output->getVal().v,
+                output->getVal().v + output->size());
+    }
+    initAndZeroGrads(outputs);
+    for (int o = 0; o < outputs.size(); ++o) {
+        for (int i = 0; i < outputs.at(o)->size(); ++i) {
+            outputs.at(o)->grad()[i] += weight(o, i);
+        }
+    }
+    graph.backward();
+
+    results.insert(results.end(), x_param.grad().v, x_param.grad().v + 12);
+    results.insert(results.end(), y_param.grad().v, y_param.grad().v + 12);
+    return results;
+}
+
+/// The strided views consumed by non-matmul operators are cancelled, so the results equal those of copying.
+void testStridedViewsWithNonMatmulConsumers() {
+    vector<dtype> copied = stridedHeadsWithNonMatmulConsumers(false);
+    vector<dtype> viewed = stridedHeadsWithNonMatmulConsumers(true);
+    for (int i = 0; i < copied.size(); ++i) {
+        expectNear(copied.at(i), viewed.at(i), fmt::format("strided result[{}]", i));
+    }
+}
+
+}
+
+int main() {
+    testSharedInputOfAliasingCat(3, 5);
+    testSharedInputOfAliasingCat(4, 4);
+    testStridedViewsWithNonMatmulConsumers();
+    std::cout << "concat-view-test passed" << std::endl;
+    return 0;
+}
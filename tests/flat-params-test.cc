@@ -0,0 +1,58 @@
+#include "test.h"
+#include "insnet/param/flat-params.h"
+
+using std::string;
+using std::vector;
+
+using namespace insnet;
+using namespace insnet::test;
+
+namespace {
+
+/// Fill the grads of all the params as the backward would.
+void fillGrads(const vector<Param *> &params, int step) {
+    for (Param *param : params) {
+        for (int i = 0; i < param->val().size; ++i) {
+            param->grad().v[i] = std::cos(step + 0.3 * i) * 1e-2;
+        }
+    }
+}
+
+/// The fused updates on the worker pool are validated against the per-param Param::adagrad, Param::adam and Param::adamW, which aborts on the first element that is not bitwise equal. The weight is large enough to be split among the threads.
+void testOptimizer(const string &optimizer) {
+    Param w("w"), u("u");
+    BiasParam b("b");
+    w.init(512, 256);
+    u.init(3, 7);
+    b.initAsBias(13);
+    fill(w, 0.1);
+    fill(u, 0.2);
+    fill(b, 0.3);
+    vector<Param *> params = {&w, &b, &u};
+
+    FlatParams flat(params);
+    flat.setThreadCount(4);
+    flat.setValidation(true);
+    for (int step = 0; step < 3; ++step) {
+        flat.zeroGrad();
+        fillGrads(params, step);
+        dtype grad_scale = step == 1 ? 0.5 : 1;
+        if (optimizer == "adagrad") {
+            flat.adagrad(1e-2, 1e-4, 1e-8, grad_scale);
+        } else if (optimizer == "adam") {
+            flat.adam(0.9, 0.999, 1e-3, 1e-4, 1e-8, grad_scale);
+        } else {
+            flat.adamW(0.9, 0.999, 1e-3, 1e-2, 1e-8, grad_scale);
+        }
+    }
+}
+
+}
+
+int main() {
+    for (const string &optimizer : {"adagrad", "adam", "adamW"}) {
+        testOptimizer(optimizer);
+    }
+    std::cout << "flat-params-test passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,61 @@
+#include <fstream>
+#include "test.h"
+
+using std::ofstream;
+using std::string;
+using std::vector;
+
+using namespace insnet;
+using namespace insnet::test;
+
+namespace {
+
+/// A frozen table aliases the embedding file, and lookups through it skip the backward pass.
+void testFrozenEmbedding() {
+    const string text_path = "frozen-embedding-test.txt";
+    const string binary_path = "frozen-embedding-test.bin";
+    const vector<string> words = {"a", "bb", UNKNOWN_WORD, "ccc"};
+    const int dim = 3;
+    {
+        ofstream outf(text_path);
+        for (int i = 0; i < words.size(); ++i) {
+            outf << words.at(i);
+            for (int j = 0; j < dim; ++j) {
+                outf << " " << i * 10 + j;
+            }
+            outf << "\n";
+        }
+    }
+    convertTextEmbeddingFile(text_path, binary_path, 1);
+
+    auto file = std::make_shared<EmbeddingFile>(binary_path);
+    Embedding<Param> table;
+    table.initFrozen(file);
+    expect(table.E.isFrozen(), "frozen table");
+    expect(table.E.val().v == file->vec(0), "table aliasing the file");
+    expect(table.tunableComponents().empty(), "frozen table not tunable");
+
+    Graph graph;
+    Node *emb = embedding(graph, vector<string>{"ccc", "a", "missing"}, table);
+    graph.forward();
+    vector<Node *> outputs = {emb};
+    initAndZeroGrads(outputs);
+    for (int j = 0; j < dim; ++j) {
+        emb->grad()[j] = 1;
+        expectNear(30 + j, emb->getVal()[j], "ccc");
+        expectNear(j, emb->getVal()[dim + j], "a");
+        expectNear(20 + j, emb->getVal()[2 * dim + j], "unknown word");
+    }
+    graph.backward();
+
+    std::remove(text_path.c_str());
+    std::remove(binary_path.c_str());
+}
+
+}
+
+int main() {
+    testFrozenEmbedding();
+    std::cout << "frozen-embedding-test passed" << std::endl;
+    return 0;
+}
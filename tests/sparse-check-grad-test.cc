@@ -0,0 +1,57 @@
+#include "test.h"
+#include "insnet/util/check-grad.h"
+
+using std::string;
+using std::vector;
+
+using namespace insnet;
+using namespace insnet::test;
+
+namespace {
+
+/// CheckGrad on an embedding table whose grads are row-sparse, with a repeated ID so that the grads of a column accumulate.
+void testSparseEmbedding() {
+    const int dim = 4, vocab = 10;
+    SparseParam table("table");
+    table.init(dim, vocab);
+    fill(table, 0.5);
+    vector<int> ids = {1, 3, 1, 7};
+
+    // The loss is sum(w * x^2) / 2 over the looked up embeddings x.
+    auto loss = [&](const vector<int> &sample) {
+        table.zeroGrad();
+        Graph graph;
+        Node *emb = embedding(graph, sample, table);
+        graph.forward();
+        vector<Node *> outputs = {emb};
+        initAndZeroGrads(outputs);
+        dtype sum = 0;
+        for (int i = 0; i < emb->size(); ++i) {
+            dtype w = std::cos(0.3 * i);
+            dtype x = emb->getVal()[i];
+            sum += 0.5 * w * x * x;
+            emb->grad()[i] += w * x;
+        }
+        graph.backward();
+        return sum;
+    };
+    loss(ids);
+
+    CheckGrad check_grad;
+    check_grad.init({&table});
+    for (int i = 0; i < 8; ++i) {
+        expect(check_grad.check<vector<int>>(loss, {ids}, "sparse embedding"),
+                "CheckGrad on SparseParam");
+    }
+
+    expect(CheckGrad::computedGrad(table, 2, 0) == 0, "untouched column grad");
+    expect(table.touchedIds().size() == 3, "untouched column not assigned a slot");
+}
+
+}
+
+int main() {
+    testSparseEmbedding();
+    std::cout << "sparse-check-grad-test passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,67 @@
+#ifndef INSNET_TEST_H
+#define INSNET_TEST_H
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include "fmt/core.h"
+#include "insnet/insnet.h"
+
+namespace insnet {
+namespace test {
+
+/// Abort the test with the message if the condition does not hold.
+inline void expect(bool condition, const std::string &message) {
+    if (!condition) {
+        std::cerr << "FAILED: " << message << std::endl;
+        std::exit(1);
+    }
+}
+
+/// Abort the test if *actual* differs from *expected* by more than the relative tolerance.
+inline void expectNear(dtype expected, dtype actual, const std::string &message,
+        dtype tolerance = 1e-4) {
+    dtype diff = std::fabs(expected - actual);
+    if (!(diff <= tolerance * std::max<dtype>(1, std::fabs(expected)))) {
+        std::cerr << fmt::format("FAILED: {} - expected:{} actual:{}", message, expected,
+                actual) << std::endl;
+        std::exit(1);
+    }
+}
+
+/// Fill the param's value deterministically, so that tests do not depend on the random initialization.
+inline void fill(BaseParam &param, dtype phase) {
+    for (int i = 0; i < param.val().size; ++i) {
+        param.val().v[i] = std::sin(phase + 0.7 * i);
+    }
+}
+
+/// Returns whether *f* aborts, running it in a child process.
+inline bool aborts(const std::function<void()> &f) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        f();
+        _exit(0);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    return WIFSIGNALED(status);
+}
+
+/// Overwrite the 64-bit integer at *offset* of the file, e.g., to corrupt a header field.
+inline void overwrite(const std::string &path, int64_t offset, int64_t value) {
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(offset);
+    file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+}
+}
+
+#endif
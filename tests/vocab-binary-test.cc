@@ -0,0 +1,90 @@
+#include "test.h"
+
+using std::string;
+using std::vector;
+
+using namespace insnet;
+using namespace insnet::test;
+
+namespace {
+
+const string PATH = "vocab-binary-test.bin";
+
+/// Whether mapBinary aborts on the file.
+bool mapBinaryAborts(const string &path) {
+    return aborts([&]() {
+        Vocab vocab;
+        vocab.mapBinary(path);
+    });
+}
+
+void corrupt(int64_t offset, int64_t value) {
+    overwrite(PATH, offset, value);
+}
+
+void testRoundTrip(const vector<string> &words) {
+    Vocab vocab;
+    vocab.init(words);
+    vocab.writeBinary(PATH);
+    Vocab mapped;
+    mapped.mapBinary(PATH);
+    expect(mapped.size() == words.size(), "mapped size");
+    for (int i = 0; i < words.size(); ++i) {
+        expect(mapped.find(words.at(i)) == vocab.find(words.at(i)), "mapped id");
+        expect(mapped.from_id(vocab.find(words.at(i))) == words.at(i), "mapped word");
+    }
+    expect(mapped.find("missing") < 0, "missing word");
+}
+
+/// The header offsets of size, slot_count and arena_size in VocabFileHeader.
+const int64_t SIZE_FIELD = 8, SLOT_COUNT_FIELD = 16, ARENA_SIZE_FIELD = 48;
+
+void testInvalidHeaders() {
+    Vocab vocab;
+    vocab.init(vector<string>{"a", "bb", "ccc"});
+    vocab.writeBinary(PATH);
+    expect(!mapBinaryAborts(PATH), "valid file");
+
+    corrupt(SLOT_COUNT_FIELD, 24);
+    expect(mapBinaryAborts(PATH), "slot_count not a power of two");
+
+    vocab.writeBinary(PATH);
+    corrupt(SLOT_COUNT_FIELD, int64_t(1) << 40);
+    expect(mapBinaryAborts(PATH), "slots beyond the file");
+
+    vocab.writeBinary(PATH);
+    corrupt(SIZE_FIELD, int64_t(1) << 40);
+    expect(mapBinaryAborts(PATH), "offsets beyond the file");
+
+    vocab.writeBinary(PATH);
+    corrupt(ARENA_SIZE_FIELD, 1 << 20);
+    expect(mapBinaryAborts(PATH), "arena beyond the file");
+
+    // The offsets of "a", "bb" and "ccc" are 0, 1, 3 and 6, following the header.
+    vocab.writeBinary(PATH);
+    corrupt(sizeof(int64_t) * 9, 5);
+    expect(mapBinaryAborts(PATH), "decreasing offsets");
+
+    // The 16 slots follow the 4 offsets.
+    const int64_t slots_offset = sizeof(int64_t) * 12;
+    vocab.writeBinary(PATH);
+    corrupt(slots_offset, 3 | (int64_t(3) << 32));
+    expect(mapBinaryAborts(PATH), "slot of an id out of range");
+
+    vocab.writeBinary(PATH);
+    for (int i = 0; i < 16; i += 2) {
+        corrupt(slots_offset + i * sizeof(int), 0);
+    }
+    expect(mapBinaryAborts(PATH), "no empty slot");
+}
+
+}
+
+int main() {
+    testRoundTrip({});
+    testRoundTrip({"a", "bb", "ccc", "", "dddd"});
+    testInvalidHeaders();
+    std::remove(PATH.c_str());
+    std::cout << "vocab-binary-test passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,16 @@
+#include <iostream>
+#include <string>
+#include "insnet/nlp/embedding-file.h"
+
+using std::cerr;
+using std::stoi;
+
+int main(int argc, char *argv[]) {
+    if (argc < 3 || argc > 4) {
+        cerr << "usage: convert-embedding <text-file> <binary-file> [thread-count]\n";
+        return 1;
+    }
+    int thread_count = argc == 4 ? stoi(argv[3]) : 0;
+    insnet::convertTextEmbeddingFile(argv[1], argv[2], thread_count);
+    return 0;
+}